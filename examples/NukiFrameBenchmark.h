@@ -0,0 +1,257 @@
+/**
+ * Benchmark of the encrypted frame path (no lock needed)
+ * Measures the time per frame and the bytes copied to build an encrypted frame (sendEncryptedMessage)
+ * and to decrypt and check a received frame (USDIO branch of notifyCallback) for different payload sizes.
+ * The library frame functions are compared with the original implementation that used intermediate buffers.
+ * The crypto context is compared with the encode/decode helpers, including the rejection of a forged message.
+ * The crc implementations are checked against the CRC-16/CCITT-FALSE check value and their throughput is measured.
+ * To run, include this file in src/main.cpp instead of NukiSmartlockTest.h
+ */
+
+#include "Arduino.h"
+#include "NukiBle.h"
+#include "NukiUtils.h"
+#include "NukiCrc.h"
+#include "NukiCrypto.h"
+#include "NukiLockConstants.h"
+#include "sodium/crypto_secretbox.h"
+#include "sodium/randombytes.h"
+
+#define BENCHMARK_ITERATIONS 1000
+#define CRC_BENCHMARK_SIZE 1024
+
+//payload sizes from small commands up to a full log entry and the max Action payload
+const uint8_t payloadSizes[] = {0, 2, 8, 32, sizeof(NukiLock::LogEntry), sizeof(NukiLock::Action::payload)};
+
+unsigned char secretKey[crypto_secretbox_KEYBYTES];
+Nuki::CryptoContext crypto;
+unsigned char authorizationId[4] = {0x01, 0x02, 0x03, 0x04};
+uint32_t bytesCopied = 0;
+
+void benchCopy(void* dst, const void* src, size_t len) {
+  memcpy(dst, src, len);
+  bytesCopied += len;
+}
+
+/**
+ * original implementation of NukiBle::sendEncryptedMessage with intermediate buffers, returns the frame length
+ */
+uint16_t encodeFrameLegacy(unsigned char* frame, const unsigned char* payload, const uint8_t payloadLen) {
+  Nuki::Command commandIdentifier = Nuki::Command::RequestData;
+  unsigned char plainData[6 + payloadLen];
+  unsigned char plainDataWithCrc[8 + payloadLen];
+
+  benchCopy(&plainData[0], authorizationId, sizeof(authorizationId));
+  benchCopy(&plainData[4], &commandIdentifier, sizeof(commandIdentifier));
+  benchCopy(&plainData[6], payload, payloadLen);
+  uint16_t dataCrc = Nuki::calculateCrc((uint8_t*)plainData, 0, sizeof(plainData));
+  benchCopy(&plainDataWithCrc[0], plainData, sizeof(plainData));
+  benchCopy(&plainDataWithCrc[sizeof(plainData)], &dataCrc, sizeof(dataCrc));
+
+  unsigned char nonce[crypto_secretbox_NONCEBYTES];
+  randombytes_buf(nonce, sizeof(nonce));
+  unsigned char additionalData[30] = {};
+  benchCopy(&additionalData[0], nonce, sizeof(nonce));
+  benchCopy(&additionalData[24], authorizationId, sizeof(authorizationId));
+
+  unsigned char plainDataEncr[sizeof(plainDataWithCrc) + crypto_secretbox_MACBYTES];
+  Nuki::encode(plainDataEncr, plainDataWithCrc, sizeof(plainDataWithCrc), nonce, secretKey);
+  int16_t length = sizeof(plainDataEncr);
+  benchCopy(&additionalData[28], &length, 2);
+
+  benchCopy(&frame[0], additionalData, sizeof(additionalData));
+  benchCopy(&frame[30], plainDataEncr, sizeof(plainDataEncr));
+  return sizeof(additionalData) + sizeof(plainDataEncr);
+}
+
+/**
+ * original implementation of the USDIO branch of NukiBle::notifyCallback with intermediate buffers
+ */
+bool decodeFrameLegacy(unsigned char* recData) {
+  unsigned char recNonce[crypto_secretbox_NONCEBYTES];
+  unsigned char recAuthorizationId[4];
+  uint16_t encrMsgLen = 0;
+  benchCopy(recNonce, &recData[0], crypto_secretbox_NONCEBYTES);
+  benchCopy(recAuthorizationId, &recData[crypto_secretbox_NONCEBYTES], 4);
+  benchCopy(&encrMsgLen, &recData[crypto_secretbox_NONCEBYTES + 4], 2);
+  unsigned char encrData[encrMsgLen];
+  benchCopy(encrData, &recData[crypto_secretbox_NONCEBYTES + 6], encrMsgLen);
+
+  unsigned char decrData[encrMsgLen - crypto_secretbox_MACBYTES];
+  if (Nuki::decode(decrData, encrData, encrMsgLen, recNonce, secretKey) < 0) {
+    return false;
+  }
+  if (!Nuki::crcValid(decrData, sizeof(decrData))) {
+    return false;
+  }
+  unsigned char payload[sizeof(decrData) - 8];
+  benchCopy(payload, &decrData[6], sizeof(payload));
+  return true;
+}
+
+uint16_t encodeFrame(unsigned char* frame, const unsigned char* payload, const uint8_t payloadLen) {
+  unsigned char nonce[crypto_secretbox_NONCEBYTES];
+  randombytes_buf(nonce, sizeof(nonce));
+  //authorization id, command, payload and crc in the plain data + nonce, authorization id and length in the header
+  bytesCopied += 4 + 2 + payloadLen + 2 + crypto_secretbox_NONCEBYTES + 4 + 2;
+  return Nuki::buildEncryptedFrame(frame, MAX_FRAME_SIZE, authorizationId, Nuki::Command::RequestData,
+                                   payload, payloadLen, nonce, crypto);
+}
+
+bool decodeFrame(unsigned char* recData, const uint16_t frameLen) {
+  unsigned char plainData[MAX_FRAME_SIZE];
+  int16_t plainDataLen = Nuki::openEncryptedFrame(plainData, sizeof(plainData), recData, frameLen, crypto);
+  if (plainDataLen < 8) {
+    return false;
+  }
+  uint16_t returnCode = 0;
+  benchCopy(&returnCode, &plainData[4], 2);
+  return true;
+}
+
+void runBenchmark(const uint8_t payloadLen, const bool legacy) {
+  unsigned char payload[sizeof(NukiLock::Action::payload)];
+  unsigned char frame[MAX_FRAME_SIZE];
+  randombytes_buf(payload, sizeof(payload));
+
+  bytesCopied = 0;
+  uint16_t frameLen = 0;
+  uint32_t start = micros();
+  for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    frameLen = legacy ? encodeFrameLegacy(frame, payload, payloadLen) : encodeFrame(frame, payload, payloadLen);
+  }
+  uint32_t encodeTime = micros() - start;
+  uint32_t encodeCopied = bytesCopied / BENCHMARK_ITERATIONS;
+
+  bytesCopied = 0;
+  bool valid = true;
+  start = micros();
+  for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    valid &= legacy ? decodeFrameLegacy(frame) : decodeFrame(frame, frameLen);
+  }
+  uint32_t decodeTime = micros() - start;
+  uint32_t decodeCopied = bytesCopied / BENCHMARK_ITERATIONS;
+
+  start = micros();
+  uint32_t crc = 0;
+  for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    crc += Nuki::calculateCrc(payload, 0, payloadLen + 6);
+  }
+  uint32_t crcTime = micros() - start;
+
+  log_i("%s payload %3d frame %3d | encode %6d ns/frame %4d B copied | decode %6d ns/frame %4d B copied %s | crc %5d ns (%d)",
+        legacy ? "legacy " : "library", payloadLen, frameLen,
+        (uint32_t)((uint64_t)encodeTime * 1000 / BENCHMARK_ITERATIONS), encodeCopied,
+        (uint32_t)((uint64_t)decodeTime * 1000 / BENCHMARK_ITERATIONS), decodeCopied, valid ? "ok" : "INVALID",
+        (uint32_t)((uint64_t)crcTime * 1000 / BENCHMARK_ITERATIONS), crc & 1);
+}
+
+uint32_t nsPerIteration(const uint32_t startMicros) {
+  return (uint32_t)((uint64_t)(micros() - startMicros) * 1000 / BENCHMARK_ITERATIONS);
+}
+
+void runCryptoBenchmark(const uint8_t len) {
+  unsigned char nonce[crypto_secretbox_NONCEBYTES];
+  unsigned char plainData[MAX_FRAME_SIZE];
+  unsigned char cipherData[MAX_FRAME_SIZE + crypto_secretbox_MACBYTES];
+  unsigned char mac[crypto_secretbox_MACBYTES];
+  randombytes_buf(nonce, sizeof(nonce));
+  randombytes_buf(plainData, len);
+
+  uint32_t start = micros();
+  for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    Nuki::encode(cipherData, plainData, len, nonce, secretKey);
+  }
+  uint32_t helperEncrypt = nsPerIteration(start);
+
+  bool valid = true;
+  start = micros();
+  for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    valid &= Nuki::decode(plainData, cipherData, len + crypto_secretbox_MACBYTES, nonce, secretKey) >= 0;
+  }
+  uint32_t helperDecrypt = nsPerIteration(start);
+
+  start = micros();
+  for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    crypto.encrypt(cipherData, mac, plainData, len, nonce);
+  }
+  uint32_t contextEncrypt = nsPerIteration(start);
+
+  start = micros();
+  for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    valid &= crypto.decrypt(plainData, cipherData, mac, len, nonce);
+  }
+  uint32_t contextDecrypt = nsPerIteration(start);
+
+  mac[0] ^= 0x01;
+  bool rejected = true;
+  start = micros();
+  for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    rejected &= !crypto.decrypt(plainData, cipherData, mac, len, nonce);
+  }
+  uint32_t contextReject = nsPerIteration(start);
+
+  log_i("crypto len %3d | helpers encrypt %6d ns decrypt %6d ns | context encrypt %6d ns decrypt %6d ns %s | forged %6d ns %s",
+        len, helperEncrypt, helperDecrypt, contextEncrypt, contextDecrypt, valid ? "ok" : "INVALID",
+        contextReject, rejected ? "rejected" : "ACCEPTED");
+}
+
+/**
+ * bit by bit implementation, as done by the Crc16 library that was used before
+ */
+uint16_t crcBitwise(const uint8_t* data, const size_t length) {
+  uint16_t crc = CRC16_CCITT_FALSE_INIT;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+void runCrcBenchmark(const char* name, uint16_t (*crcFunction)(const uint8_t*, const size_t)) {
+  static uint8_t data[CRC_BENCHMARK_SIZE];
+  randombytes_buf(data, sizeof(data));
+
+  const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  bool valid = crcFunction(check, sizeof(check)) == CRC16_CCITT_FALSE_CHECK
+               && crcFunction(data, sizeof(data)) == crcBitwise(data, sizeof(data));
+
+  uint32_t crc = 0;
+  uint32_t start = micros();
+  for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    crc += crcFunction(data, sizeof(data));
+  }
+  uint32_t crcTime = micros() - start;
+
+  log_i("crc %-8s %s | %5d ns/kB %6d kB/s (%d)", name, valid ? "ok" : "INVALID",
+        (uint32_t)((uint64_t)crcTime * 1000 / BENCHMARK_ITERATIONS),
+        (uint32_t)((uint64_t)BENCHMARK_ITERATIONS * CRC_BENCHMARK_SIZE * 1000 / 1024 / (crcTime ? crcTime : 1)), crc & 1);
+}
+
+void setup() {
+  Serial.begin(115200);
+  log_i("Starting frame benchmark, %d iterations", BENCHMARK_ITERATIONS);
+  randombytes_buf(secretKey, sizeof(secretKey));
+  crypto.setKey(secretKey);
+  log_i("crc self test %s", Nuki::crc16SelfTest() ? "ok" : "FAILED");
+}
+
+void loop() {
+  for (uint8_t payloadLen : payloadSizes) {
+    runBenchmark(payloadLen, true);
+    runBenchmark(payloadLen, false);
+  }
+  for (uint8_t payloadLen : payloadSizes) {
+    runCryptoBenchmark(payloadLen + 8);
+  }
+  runCrcBenchmark("bitwise", crcBitwise);
+  runCrcBenchmark("table", [](const uint8_t* data, const size_t length) {
+    return Nuki::crc16CcittFalseTable(data, length);
+  });
+  runCrcBenchmark("library", [](const uint8_t* data, const size_t length) {
+    return Nuki::crc16CcittFalse(data, length);
+  });
+  delay(10000);
+}
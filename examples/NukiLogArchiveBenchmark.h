@@ -0,0 +1,121 @@
+/**
+ * Benchmark of the log archive on LittleFS (no lock needed)
+ * Measures the append throughput for different batch sizes, the index and time range query throughput and
+ * the time to load the archive with begin(), and checks that queries return exactly the appended entries.
+ * Uses its own directory and deletes it at the start of every run.
+ * To run, include this file in src/main.cpp instead of NukiSmartlockTest.h
+ */
+
+#include "Arduino.h"
+#include "LittleFS.h"
+#include "NukiLockConstants.h"
+#include "NukiLogArchive.h"
+
+#define ARCHIVE_BENCHMARK_DIRECTORY "/nukibench"
+#define ARCHIVE_BENCHMARK_ENTRIES 4096
+#define ARCHIVE_BENCHMARK_QUERIES 100
+#define ARCHIVE_BENCHMARK_QUERY_RANGE 50
+
+const uint16_t batchSizes[] = {1, 16, 256};
+
+Nuki::LogArchive<NukiLock::LogEntry> logArchive{LittleFS, ARCHIVE_BENCHMARK_DIRECTORY};
+
+/**
+ * entry number i, one entry every 10 minutes starting 2022-01-01
+ */
+NukiLock::LogEntry createEntry(const uint32_t i) {
+  NukiLock::LogEntry entry = {};
+  uint32_t minutes = i * 10;
+  entry.index = i + 1;
+  entry.timeStampYear = 2022;
+  entry.timeStampMonth = 1 + (minutes / (28 * 24 * 60)) % 12;
+  entry.timeStampDay = 1 + (minutes / (24 * 60)) % 28;
+  entry.timeStampHour = (minutes / 60) % 24;
+  entry.timeStampMinute = minutes % 60;
+  entry.authId = i % 8;
+  snprintf((char*)entry.name, sizeof(entry.name), "user %d", entry.authId);
+  entry.loggingType = NukiLock::LoggingType::LockAction;
+  return entry;
+}
+
+void runAppendBenchmark(const uint16_t batchSize) {
+  logArchive.clear();
+  std::vector<NukiLock::LogEntry> batch(batchSize);
+  uint32_t appended = 0;
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < ARCHIVE_BENCHMARK_ENTRIES; i += batchSize) {
+    for (uint16_t j = 0; j < batchSize; j++) {
+      batch[j] = createEntry(i + j);
+    }
+    appended += logArchive.appendAll(batch);
+  }
+  uint32_t durationUs = micros() - start;
+  log_i("append batch %3d: %d entries in %d ms, %d us/entry, %d entries/s", batchSize, appended, durationUs / 1000,
+        durationUs / appended, (uint32_t)((uint64_t)appended * 1000000 / durationUs));
+}
+
+void runQueryBenchmark() {
+  uint32_t firstIndex = logArchive.getFirstIndex();
+  uint32_t lastIndex = logArchive.getLastIndex();
+  uint32_t found = 0;
+  bool ordered = true;
+
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < ARCHIVE_BENCHMARK_QUERIES; i++) {
+    uint32_t from = firstIndex + (i * 997) % (lastIndex - firstIndex - ARCHIVE_BENCHMARK_QUERY_RANGE);
+    uint32_t expected = from;
+    found += logArchive.queryByIndex(from, from + ARCHIVE_BENCHMARK_QUERY_RANGE - 1, [&](const NukiLock::LogEntry& entry) {
+      ordered = ordered && entry.index == expected++;
+      return true;
+    });
+  }
+  uint32_t durationUs = micros() - start;
+  log_i("index query: %d queries of %d entries in %d ms, %d us/query, %s", ARCHIVE_BENCHMARK_QUERIES,
+        ARCHIVE_BENCHMARK_QUERY_RANGE, durationUs / 1000, durationUs / ARCHIVE_BENCHMARK_QUERIES,
+        found == ARCHIVE_BENCHMARK_QUERIES * ARCHIVE_BENCHMARK_QUERY_RANGE && ordered ? "ok" : "WRONG RESULT");
+
+  //one day of entries
+  uint32_t from = Nuki::toLogTimestamp(2022, 1, 3, 0, 0, 0);
+  uint32_t to = Nuki::toLogTimestamp(2022, 1, 3, 23, 59, 59);
+  found = 0;
+  start = micros();
+  for (uint32_t i = 0; i < ARCHIVE_BENCHMARK_QUERIES; i++) {
+    found += logArchive.queryByTime(from, to, [](const NukiLock::LogEntry& entry) {
+      return true;
+    });
+  }
+  durationUs = micros() - start;
+  log_i("time query: %d queries of one day in %d ms, %d us/query, %s", ARCHIVE_BENCHMARK_QUERIES, durationUs / 1000,
+        durationUs / ARCHIVE_BENCHMARK_QUERIES, found == ARCHIVE_BENCHMARK_QUERIES * 24 * 6 ? "ok" : "WRONG RESULT");
+}
+
+void runLoadBenchmark() {
+  uint32_t records = logArchive.size();
+  uint32_t start = micros();
+  logArchive.begin();
+  uint32_t durationUs = micros() - start;
+  log_i("begin: %d segments, %d records loaded in %d ms, %s", logArchive.getStats().segments, logArchive.size(),
+        durationUs / 1000, logArchive.size() == records ? "ok" : "WRONG RESULT");
+}
+
+void setup() {
+  Serial.begin(115200);
+  if (!LittleFS.begin(true)) {
+    log_e("LittleFS could not be mounted");
+    return;
+  }
+  log_i("Starting log archive benchmark, %d entries of %d bytes, LittleFS %d of %d bytes used", ARCHIVE_BENCHMARK_ENTRIES,
+        sizeof(NukiLock::LogEntry), LittleFS.usedBytes(), LittleFS.totalBytes());
+  logArchive.begin();
+}
+
+void loop() {
+  for (uint16_t batchSize : batchSizes) {
+    runAppendBenchmark(batchSize);
+  }
+  runQueryBenchmark();
+  runLoadBenchmark();
+  Nuki::LogArchiveStats stats = logArchive.getStats();
+  log_i("segments: %d, rotated: %d, corrupt records: %d", stats.segments, stats.segmentsRotated, stats.corruptRecords);
+  delay(10000);
+}
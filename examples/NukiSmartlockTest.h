@@ -15,7 +15,6 @@ BleScanner::Scanner scanner;
 
 NukiLock::KeyTurnerState retrievedKeyTurnerState;
 NukiLock::BatteryReport _batteryReport;
-std::list<NukiLock::LogEntry> requestedLogEntries;
 std::list<Nuki::KeypadEntry> requestedKeypadEntries;
 std::list<Nuki::AuthorizationEntry> requestedAuthorizationEntries;
 std::list<NukiLock::TimeControlEntry> requestedTimeControlEntries;
@@ -71,12 +70,9 @@ bool keyTurnerState() {
 void requestLogEntries() {
   uint8_t result = nukiLock.retrieveLogEntries(0, 10, 0, true);
   if (result == 1) {
-    delay(5000);
-    nukiLock.getLogEntries(&requestedLogEntries);
-    std::list<NukiLock::LogEntry>::iterator it = requestedLogEntries.begin();
-    while (it != requestedLogEntries.end()) {
-      log_d("Log[%d] %d-%d-%d %d:%d:%d", it->index, it->timeStampYear, it->timeStampMonth, it->timeStampDay, it->timeStampHour, it->timeStampMinute, it->timeStampSecond);
-      it++;
+    //read the entries in place, without copying them to a list
+    for (const NukiLock::LogEntry& logEntry : nukiLock.getLogEntryBuffer()) {
+      log_d("Log[%d] %d-%d-%d %d:%d:%d", logEntry.index, logEntry.timeStampYear, logEntry.timeStampMonth, logEntry.timeStampDay, logEntry.timeStampHour, logEntry.timeStampMinute, logEntry.timeStampSecond);
     }
   } else {
     log_d("get log failed: %d", result);
@@ -86,7 +82,6 @@ void requestLogEntries() {
 void requestKeyPadEntries() {
   uint8_t result = nukiLock.retrieveKeypadEntries(0, 10);
   if (result == 1) {
-    delay(5000);
     nukiLock.getKeypadEntries(&requestedKeypadEntries);
     std::list<Nuki::KeypadEntry>::iterator it = requestedKeypadEntries.begin();
     while (it != requestedKeypadEntries.end()) {
@@ -101,7 +96,6 @@ void requestKeyPadEntries() {
 void requestAuthorizationEntries() {
   uint8_t result = nukiLock.retrieveAuthorizationEntries(0, 10);
   if (result == 1) {
-    delay(5000);
     nukiLock.getAuthorizationEntries(&requestedAuthorizationEntries);
     std::list<Nuki::AuthorizationEntry>::iterator it = requestedAuthorizationEntries.begin();
     while (it != requestedAuthorizationEntries.end()) {
@@ -136,7 +130,6 @@ void addTimeControl(uint8_t weekdays, uint8_t hour, uint8_t minute, NukiLock::Lo
 void requestTimeControlEntries() {
   Nuki::CmdResult result = nukiLock.retrieveTimeControlEntries();
   if (result == Nuki::CmdResult::Success) {
-    delay(5000);
     nukiLock.getTimeControlEntries(&requestedTimeControlEntries);
     std::list<NukiLock::TimeControlEntry>::iterator it = requestedTimeControlEntries.begin();
     while (it != requestedTimeControlEntries.end()) {
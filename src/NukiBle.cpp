@@ -19,7 +19,6 @@
 #include "sodium/crypto_auth_hmacsha256.h"
 #include "sodium/crypto_secretbox.h"
 #include "sodium/crypto_box.h"
-#include "NimBLEBeacon.h"
 
 #define NUKI_SEMAPHORE_TIMEOUT 1000
 
@@ -41,6 +40,16 @@ NukiBle::NukiBle(const std::string& deviceName,
     gdioUUID(gdioUUID),
     userDataUUID(userDataUUID),
     preferencesId(preferencedId) {
+  //service uuid as it appears in the iBeacon proximity uuid, so advertisements can be matched without conversions
+  std::string serviceUUID = deviceServiceUUID.toString();
+  uint8_t nrOfNibbles = 0;
+  for (char c : serviceUUID) {
+    if (isxdigit(c) && nrOfNibbles < 2 * sizeof(deviceServiceUuidBytes)) {
+      uint8_t nibble = isdigit(c) ? c - '0' : tolower(c) - 'a' + 10;
+      deviceServiceUuidBytes[nrOfNibbles / 2] = (deviceServiceUuidBytes[nrOfNibbles / 2] << 4) | nibble;
+      nrOfNibbles++;
+    }
+  }
 }
 
 NukiBle::~NukiBle() {
@@ -48,6 +57,25 @@ NukiBle::~NukiBle() {
     bleScanner->unsubscribe(this);
     bleScanner = nullptr;
   }
+  if (asyncTaskHandle != nullptr) {
+    //let the worker finish the running command, so it does not die holding the semaphore or a queue turn
+    asyncTaskStopping = true;
+    xSemaphoreGive(asyncCommandsAvailable);
+    if (asyncTaskHandle == xTaskGetCurrentTaskHandle()) {
+      log_e("NukiBle deleted from its own async callback");
+    } else {
+      xSemaphoreTake(asyncTaskStopped, portMAX_DELAY);
+    }
+    asyncTaskHandle = nullptr;
+  }
+  if (!asyncCommands.empty()) {
+    log_w("%d async commands dropped", asyncCommands.size());
+  }
+  vSemaphoreDelete(asyncTaskStopped);
+  vSemaphoreDelete(asyncCommandsAvailable);
+  vSemaphoreDelete(asyncQueueSemaphore);
+  vEventGroupDelete(nukiBleEvents);
+  vSemaphoreDelete(nukiBleSemaphore);
 }
 
 void NukiBle::initialize() {
@@ -61,6 +89,9 @@ void NukiBle::initialize() {
   pClient->setConnectTimeout(connectTimeoutSec);
 
   isPaired = retrieveCredentials();
+  if (deviceManager) {
+    deviceManager->updateDeviceAddress(this);
+  }
 }
 
 void NukiBle::registerBleScanner(BleScanner::Publisher* bleScanner) {
@@ -68,6 +99,17 @@ void NukiBle::registerBleScanner(BleScanner::Publisher* bleScanner) {
   bleScanner->subscribe(this);
 }
 
+void NukiBle::registerDeviceManager(DeviceManager* deviceManager) {
+  this->deviceManager = deviceManager;
+  registerBleScanner(deviceManager);
+}
+
+#ifdef NUKI_INSTRUMENTATION
+Nuki::Instrumentation& NukiBle::getInstrumentation() {
+  return instrumentation;
+}
+#endif
+
 PairingResult NukiBle::pairNuki(AuthorizationIdType idType) {
   authorizationIdType = idType;
 
@@ -76,6 +118,9 @@ PairingResult NukiBle::pairNuki(AuthorizationIdType idType) {
     log_d("Allready paired");
     #endif
     isPaired = true;
+    if (deviceManager) {
+      deviceManager->updateDeviceAddress(this);
+    }
     return PairingResult::Success;
   }
   PairingResult result = PairingResult::Pairing;
@@ -113,12 +158,18 @@ PairingResult NukiBle::pairNuki(AuthorizationIdType idType) {
   #endif
 
   isPaired = (result == PairingResult::Success);
+  if (deviceManager) {
+    deviceManager->updateDeviceAddress(this);
+  }
   return result;
 }
 
 void NukiBle::unPairNuki() {
   deleteCredentials();
   isPaired = false;
+  if (deviceManager) {
+    deviceManager->updateDeviceAddress(this);
+  }
   #ifdef DEBUG_NUKI_CONNECT
   log_d("[%s] Credentials deleted", deviceName.c_str());
   #endif
@@ -132,28 +183,62 @@ bool NukiBle::connectBle(const BLEAddress bleAddress) {
     log_d("connecting within: %s", pcTaskGetTaskName(xTaskGetCurrentTaskHandle()));
     #endif
 
+    NUKI_TRACE(ConnectStart);
+    //with several devices on one ESP32 only one at a time sets up a connection
+    if (deviceManager) {
+      deviceManager->beginConnect();
+    }
     uint8_t connectRetry = 0;
+    uint32_t connectStart = millis();
     pClient->setConnectTimeout(connectTimeoutSec);
     while (connectRetry < connectRetries) {
       #ifdef DEBUG_NUKI_CONNECT
       log_d("connection attemnpt %d", connectRetry);
       #endif
-      if (pClient->connect(bleAddress, true)) {
+      //the GATT table of a paired device does not change, keep the discovered services/characteristics
+      //of the previous connection so no service discovery is needed
+      bool reuseGatt = gattCached && cachedGattAddress == bleAddress;
+      if (!reuseGatt) {
+        invalidateGattCache();
+      }
+      if (pClient->connect(bleAddress, !reuseGatt)) {
+        NUKI_TRACE(Connected);
         if (pClient->isConnected() && registerOnGdioChar() && registerOnUsdioChar()) {  //doublecheck if is connected otherwise registiring gdio crashes esp
+          NUKI_TRACE(ServicesRegistered);
+          gattCached = true;
+          cachedGattAddress = bleAddress;
+          uint32_t connectDuration = millis() - connectStart;
+          avgConnectDuration = avgConnectDuration == 0 ? connectDuration
+                               : (avgConnectDuration * (ADAPTIVE_DISCONNECT_WEIGHT - 1) + connectDuration) / ADAPTIVE_DISCONNECT_WEIGHT;
+          #ifdef DEBUG_NUKI_CONNECT
+          log_d("connected in %d ms", connectDuration);
+          #endif
+          if (deviceManager) {
+            deviceManager->endConnect();
+          }
           bleScanner->enableScanning(true);
           connecting = false;
           return true;
         } else {
           log_w("BLE register on pairing or data Service/Char failed");
+          if (reuseGatt) {
+            //fall back to full discovery on the next attempt
+            invalidateGattCache();
+            pClient->disconnect();
+          }
         }
       } else {
         pClient->disconnect();
         log_w("BLE Connect failed, %d retries left", connectRetries - connectRetry - 1);
       }
+      NUKI_TRACE(ConnectRetry);
       connectRetry++;
       esp_task_wdt_reset();
       delay(10);
     }
+    if (deviceManager) {
+      deviceManager->endConnect();
+    }
   } else {
     bleScanner->enableScanning(true);
     connecting = false;
@@ -170,7 +255,7 @@ void NukiBle::updateConnectionState() {
     lastStartTimeout = 0;
   }
 
-  if (lastStartTimeout != 0 && (millis() - lastStartTimeout > timeoutDuration)) {
+  if (lastStartTimeout != 0 && (millis() - lastStartTimeout > getIdleDisconnectTimeout())) {
     if (pClient && pClient->isConnected()) {
       pClient->disconnect();
       #ifdef DEBUG_NUKI_CONNECT
@@ -196,53 +281,81 @@ void NukiBle::extendDisonnectTimeout() {
   lastStartTimeout = millis();
 }
 
+void NukiBle::enableAdaptiveDisconnect(const bool enable) {
+  adaptiveDisconnect = enable;
+}
+
+Nuki::ConnectionStats NukiBle::getConnectionStats() const {
+  return {connectionHits, connectionMisses, avgCommandGap, avgConnectDuration, getIdleDisconnectTimeout()};
+}
+
+void NukiBle::trackCommandStart() {
+  uint32_t now = millis();
+  if (pClient && pClient->isConnected()) {
+    connectionHits++;
+  } else {
+    connectionMisses++;
+  }
+
+  if (lastCommandStart != 0) {
+    //gaps longer than the max timeout can never be bridged, count them as the max
+    uint32_t gap = now - lastCommandStart;
+    if (gap > 2 * ADAPTIVE_DISCONNECT_MAX_TIMEOUT) {
+      gap = 2 * ADAPTIVE_DISCONNECT_MAX_TIMEOUT;
+    }
+    avgCommandGap = avgCommandGap == 0 ? gap
+                    : (avgCommandGap * (ADAPTIVE_DISCONNECT_WEIGHT - 1) + gap) / ADAPTIVE_DISCONNECT_WEIGHT;
+  }
+  lastCommandStart = now;
+}
+
+uint32_t NukiBle::getIdleDisconnectTimeout() const {
+  if (!adaptiveDisconnect || avgCommandGap == 0) {
+    return timeoutDuration;
+  }
+
+  //keeping the link is only worth it if the next command is expected before the lock drops it,
+  //otherwise the reconnect is paid anyway and a stale connection only keeps the lock busy
+  uint32_t keepAlive = avgCommandGap + avgCommandGap / 2;
+  if (keepAlive > ADAPTIVE_DISCONNECT_MAX_TIMEOUT || keepAlive <= timeoutDuration) {
+    return timeoutDuration;
+  }
+  return keepAlive;
+}
+
 void NukiBle::onResult(BLEAdvertisedDevice* advertisedDevice) {
   if (isPaired) {
     if (bleAddress == advertisedDevice->getAddress()) {
       rssi = advertisedDevice->getRSSI();
       lastReceivedBeaconTs = millis();
 
-      std::string manufacturerData = advertisedDevice->getManufacturerData();
-      uint8_t* manufacturerDataPtr = (uint8_t*)manufacturerData.data();
-      char* pHex = BLEUtils::buildHexData(nullptr, manufacturerDataPtr, manufacturerData.length());
-
-      bool isKeyTurnerUUID = true;
-      std::string serviceUUID = deviceServiceUUID.toString();
-      size_t len = serviceUUID.length();
-      int offset = 0;
-      for (int i = 0; i < len; i++) {
-        if (serviceUUID[i + offset] == '-') {
-          ++offset;
-          --len;
-        }
-
-        if (pHex[i + 8] != serviceUUID.at(i + offset)) {
-          isKeyTurnerUUID = false;
+      /*
+      iBeacon manufacturer data, matched directly in the raw advertisement payload
+      #  company id  #  type  #  length  #  proximity uuid  #  major  #  minor  #  power  #
+      #  4C 00       #  02    #  15      #  16 byte         #  2 byte #  2 byte #  1 byte #
+      */
+      const uint8_t* manufacturerData = nullptr;
+      //getPayload() returns a copy, the read-only iterator gives access to the stored payload
+      size_t payloadLength = advertisedDevice->getPayloadLength();
+      const uint8_t* payload = payloadLength > 0 ? &*advertisedDevice->begin() : nullptr;
+      for (size_t i = 0; i + 1 < payloadLength && payload[i] > 0; i += payload[i] + 1) {
+        if (payload[i + 1] == 0xFF && payload[i] == 26 && i + 26 < payloadLength) {
+          manufacturerData = &payload[i + 2];
+          break;
         }
       }
-      free(pHex);
 
-      if (isKeyTurnerUUID) {
+      if (manufacturerData != nullptr && manufacturerData[0] == 0x4C && manufacturerData[1] == 0x00
+          && memcmp(&manufacturerData[4], deviceServiceUuidBytes, sizeof(deviceServiceUuidBytes)) == 0) {
+        int8_t signalPower = (int8_t)manufacturerData[24];
         #ifdef DEBUG_NUKI_CONNECT
-        log_d("Nuki Advertising: %s", advertisedDevice->toString().c_str());
+        log_d("iBeacon Major: %d Minor: %d Power: %d", ((uint16_t)manufacturerData[20] << 8) | manufacturerData[21],
+              ((uint16_t)manufacturerData[22] << 8) | manufacturerData[23], signalPower);
         #endif
-
-        uint8_t cManufacturerData[100];
-        manufacturerData.copy((char*)cManufacturerData, manufacturerData.length(), 0);
-
-        if (manufacturerData.length() == 25 && cManufacturerData[0] == 0x4C && cManufacturerData[1] == 0x00) {
-          BLEBeacon oBeacon = BLEBeacon();
-          oBeacon.setData(manufacturerData);
-          #ifdef DEBUG_NUKI_CONNECT
-          log_d("iBeacon ID: %04X Major: %d Minor: %d UUID: %s Power: %d\n", oBeacon.getManufacturerId(),
-                ENDIAN_CHANGE_U16(oBeacon.getMajor()), ENDIAN_CHANGE_U16(oBeacon.getMinor()),
-                oBeacon.getProximityUUID().toString().c_str(), oBeacon.getSignalPower());
-          #endif
-          lastHeartbeat = millis();
-          if ((oBeacon.getSignalPower() & 0x01) > 0) {
-            if (eventHandler) {
-              eventHandler->notify(EventType::KeyTurnerStatusUpdated);
-            }
+        lastHeartbeat = millis();
+        if ((signalPower & 0x01) > 0) {
+          if (eventHandler) {
+            eventHandler->notify(EventType::KeyTurnerStatusUpdated);
           }
         }
       }
@@ -273,35 +386,14 @@ Nuki::CmdResult NukiBle::retrieveKeypadEntries(const uint16_t offset, const uint
   memcpy(action.payload, &payload, sizeof(payload));
   action.payloadLen = sizeof(payload);
 
-  listOfKeyPadEntries.clear();
+  keypadEntryBuffer.clear();
   nrOfReceivedKeypadCodes = 0;
   keypadCodeCountReceived = false;
 
-  uint32_t timeNow = millis();
-  Nuki::CmdResult result = executeAction(action);
+  //completes after Keypad Code Count (0x0044) and Keypad Codes (0x0045) are received
+  Nuki::CmdResult result = executeAction(action, {Command::KeypadCode, count, offset});
 
   if (result == Nuki::CmdResult::Success) {
-    //wait for return of Keypad Code Count (0x0044)
-    while (!keypadCodeCountReceived) {
-      if (millis() - timeNow > GENERAL_TIMEOUT) {
-        log_w("Receive keypad count timeout");
-        return CmdResult::TimeOut;
-      }
-      delay(10);
-    }
-    #ifdef DEBUG_NUKI_COMMAND
-    log_d("Keypad code count %d", getKeypadEntryCount());
-    #endif
-
-    //wait for return of Keypad Codes (0x0045)
-    timeNow = millis();
-    while (nrOfReceivedKeypadCodes < getKeypadEntryCount()) {
-      if (millis() - timeNow > GENERAL_TIMEOUT) {
-        log_w("Receive keypadcodes timeout");
-        return CmdResult::TimeOut;
-      }
-      delay(10);
-    }
     #ifdef DEBUG_NUKI_COMMAND
     log_d("%d codes received", nrOfReceivedKeypadCodes);
     #endif
@@ -351,15 +443,28 @@ Nuki::CmdResult NukiBle::updateKeypadEntry(UpdatedKeypadEntry updatedKeyPadEntry
   return result;
 }
 
+uint32_t NukiBle::retrieveKeypadEntriesAsync(const uint16_t offset, const uint16_t count,
+    AsyncPayloadCallback<KeypadEntryBuffer> callback) {
+  return executeAsync([this, offset, count, callback]() {
+    Nuki::CmdResult result = retrieveKeypadEntries(offset, count);
+    if (callback) {
+      callback(runningAsyncHandle, result, keypadEntryBuffer);
+    }
+    return result;
+  });
+}
+
 void NukiBle::getKeypadEntries(std::list<KeypadEntry>* requestedKeypadCodes) {
   requestedKeypadCodes->clear();
-  std::list<KeypadEntry>::iterator it = listOfKeyPadEntries.begin();
-  while (it != listOfKeyPadEntries.end()) {
-    requestedKeypadCodes->push_back(*it);
-    it++;
+  for (const KeypadEntry& entry : keypadEntryBuffer) {
+    requestedKeypadCodes->push_back(entry);
   }
 }
 
+const KeypadEntryBuffer& NukiBle::getKeypadEntryBuffer() const {
+  return keypadEntryBuffer;
+}
+
 uint16_t NukiBle::getKeypadEntryCount() {
   return nrOfKeypadCodes;
 }
@@ -377,6 +482,245 @@ CmdResult NukiBle::deleteKeypadEntry(uint16_t id) {
   return executeAction(action);
 }
 
+Nuki::CmdResult NukiBle::syncKeypadMirror(const bool forceReload) {
+  loadKeypadMirror();
+
+  //the lock has no change counter for its keypad codes, every entry is compared with the mirror
+  std::map<uint16_t, KeypadEntry> reloaded;
+  bool changed = forceReload || keypadMirrorStale;
+  Nuki::CmdResult result;
+  uint16_t offset = 0;
+  do {
+    //read in chunks of the size of the entry buffer
+    result = retrieveKeypadEntries(offset, KEYPAD_ENTRIES_BUFFER_SIZE);
+    if (result != Nuki::CmdResult::Success) {
+      return result;
+    }
+    if (nrOfKeypadCodes > KEYPAD_MIRROR_MAX_ENTRIES) {
+      log_w("Lock has %d keypad codes, the mirror holds max %d", nrOfKeypadCodes, KEYPAD_MIRROR_MAX_ENTRIES);
+      keypadMirrorStale = true;
+      return Nuki::CmdResult::Failed;
+    }
+    for (const KeypadEntry& entry : keypadEntryBuffer) {
+      if (!changed) {
+        auto it = keypadMirror.find(entry.codeId);
+        UpdatedKeypadEntry mirrored;
+        if (it != keypadMirror.end()) {
+          createUpdatedKeypadEntry(it->second, &mirrored);
+        }
+        changed = it == keypadMirror.end() || !isSameKeypadEntry(entry, mirrored);
+      }
+      reloaded[entry.codeId] = entry;
+    }
+    offset += keypadEntryBuffer.size();
+  } while (keypadEntryBuffer.full() && offset < nrOfKeypadCodes);
+  changed = changed || reloaded.size() != keypadMirror.size();
+
+  //last active date and lock count change with every use, they are only stored with a real change
+  keypadMirror.swap(reloaded);
+  keypadMirrorStale = false;
+  if (changed) {
+    saveKeypadMirror();
+  }
+  #ifdef DEBUG_NUKI_COMMUNICATION
+  log_d("Keypad mirror %s, %d codes", changed ? "reloaded" : "up to date", keypadMirror.size());
+  #endif
+  return result;
+}
+
+void NukiBle::getKeypadMirror(std::list<KeypadEntry>* entries) {
+  loadKeypadMirror();
+  entries->clear();
+  for (const auto& mirrored : keypadMirror) {
+    entries->push_back(mirrored.second);
+  }
+}
+
+std::vector<KeypadPlanEntry> NukiBle::planKeypadChanges(const std::vector<UpdatedKeypadEntry>& wantedEntries,
+    const bool removeUnlisted) {
+  loadKeypadMirror();
+  std::vector<KeypadPlanEntry> plan;
+  std::map<uint16_t, bool> wantedIds;
+
+  for (const UpdatedKeypadEntry& wanted : wantedEntries) {
+    auto it = keypadMirror.end();
+    if (wanted.codeId != 0) {
+      it = keypadMirror.find(wanted.codeId);
+    } else {
+      for (it = keypadMirror.begin(); it != keypadMirror.end() && it->second.code != wanted.code; it++);
+    }
+
+    if (it == keypadMirror.end()) {
+      KeypadPlanEntry add = {KeypadOperation::Add, wanted};
+      add.entry.codeId = 0;
+      plan.push_back(add);
+      continue;
+    }
+    wantedIds[it->first] = true;
+    if (!isSameKeypadEntry(it->second, wanted)) {
+      KeypadPlanEntry update = {KeypadOperation::Update, wanted};
+      update.entry.codeId = it->first;
+      plan.push_back(update);
+    }
+  }
+
+  if (removeUnlisted) {
+    for (const auto& mirrored : keypadMirror) {
+      if (wantedIds.find(mirrored.first) == wantedIds.end()) {
+        KeypadPlanEntry remove = {KeypadOperation::Remove, {}};
+        createUpdatedKeypadEntry(mirrored.second, &remove.entry);
+        plan.push_back(remove);
+      }
+    }
+  }
+  return plan;
+}
+
+std::vector<KeypadPlanResult> NukiBle::applyKeypadPlan(const std::vector<KeypadPlanEntry>& plan) {
+  loadKeypadMirror();
+  std::vector<KeypadPlanResult> results;
+  //all operations over one connection, without the bulk each operation waits in the queue on its own
+  bool bulk = !plan.empty() && retrieveCredentials() && beginBulk(Nuki::CommandPriority::Low);
+
+  for (const KeypadPlanEntry& planEntry : plan) {
+    if (bulk && !results.empty()) {
+      bulk = yieldBulk();
+    }
+    const UpdatedKeypadEntry& entry = planEntry.entry;
+    KeypadPlanResult planResult = {planEntry.operation, entry.codeId, entry.code, Nuki::CmdResult::Failed};
+
+    switch (planEntry.operation) {
+      case KeypadOperation::Add: {
+        //same fields, without code id and enabled
+        NewKeypadEntry newEntry;
+        memcpy(&newEntry.code, &entry.code, sizeof(newEntry.code) + sizeof(newEntry.name));
+        memcpy(&newEntry.timeLimited, &entry.timeLimited, sizeof(NewKeypadEntry) - offsetof(NewKeypadEntry, timeLimited));
+        lastKeypadCodeId = 0;
+        planResult.result = addKeypadEntry(newEntry);
+        if (planResult.result == Nuki::CmdResult::Success) {
+          planResult.codeId = lastKeypadCodeId;
+          if (lastKeypadCodeId != 0) {
+            KeypadEntry added = {};
+            memcpy(&added, &entry, offsetof(KeypadEntry, enabled));
+            added.codeId = lastKeypadCodeId;
+            added.enabled = 1;
+            memcpy(&added.timeLimited, &entry.timeLimited, sizeof(KeypadEntry) - offsetof(KeypadEntry, timeLimited));
+            keypadMirror[lastKeypadCodeId] = added;
+          } else {
+            //id of the new code unknown, reload all entries on the next sync
+            keypadMirrorStale = true;
+          }
+        }
+        break;
+      }
+      case KeypadOperation::Update: {
+        planResult.result = updateKeypadEntry(entry);
+        auto it = keypadMirror.find(entry.codeId);
+        if (planResult.result == Nuki::CmdResult::Success && it != keypadMirror.end()) {
+          memcpy(&it->second, &entry, offsetof(KeypadEntry, enabled) + sizeof(it->second.enabled));
+          memcpy(&it->second.timeLimited, &entry.timeLimited, sizeof(KeypadEntry) - offsetof(KeypadEntry, timeLimited));
+        }
+        break;
+      }
+      case KeypadOperation::Remove: {
+        planResult.result = deleteKeypadEntry(entry.codeId);
+        if (planResult.result == Nuki::CmdResult::Success) {
+          keypadMirror.erase(entry.codeId);
+        }
+        break;
+      }
+    }
+    if (planResult.result != Nuki::CmdResult::Success) {
+      log_w("Keypad %s of code id %d failed: %d", planEntry.operation == KeypadOperation::Add ? "add"
+            : planEntry.operation == KeypadOperation::Update ? "update" : "remove", entry.codeId, planResult.result);
+    }
+    results.push_back(planResult);
+  }
+  endBulk();
+
+  saveKeypadMirror();
+  return results;
+}
+
+void NukiBle::loadKeypadMirror() {
+  if (keypadMirrorLoaded) {
+    return;
+  }
+  if (takeNukiBleSemaphore("load keypad")) {
+    size_t len = preferences.getBytesLength(KEYPAD_MIRROR_STORE_NAME);
+    uint16_t count = len / sizeof(KeypadEntry);
+    if (count > 0 && count <= KEYPAD_MIRROR_MAX_ENTRIES && len == count * sizeof(KeypadEntry)) {
+      std::vector<KeypadEntry> entries(count);
+      preferences.getBytes(KEYPAD_MIRROR_STORE_NAME, entries.data(), len);
+      for (const KeypadEntry& entry : entries) {
+        keypadMirror[entry.codeId] = entry;
+      }
+    } else {
+      //nothing stored yet, make sure the first sync retrieves all entries
+      keypadMirrorStale = true;
+    }
+    keypadMirrorLoaded = true;
+    giveNukiBleSemaphore();
+  }
+}
+
+void NukiBle::saveKeypadMirror() {
+  std::vector<KeypadEntry> entries;
+  for (const auto& mirrored : keypadMirror) {
+    entries.push_back(mirrored.second);
+  }
+  if (takeNukiBleSemaphore("save keypad")) {
+    if (entries.empty()) {
+      preferences.remove(KEYPAD_MIRROR_STORE_NAME);
+    } else if (preferences.putBytes(KEYPAD_MIRROR_STORE_NAME, entries.data(), entries.size() * sizeof(KeypadEntry))
+               != entries.size() * sizeof(KeypadEntry)) {
+      log_w("Unable to store keypad mirror");
+    }
+    giveNukiBleSemaphore();
+  }
+}
+
+bool NukiBle::getStoredUInt(const char* key, const uint32_t defaultValue, uint32_t* value) {
+  if (!takeNukiBleSemaphore("get stored")) {
+    return false;
+  }
+  *value = preferences.getUInt(key, defaultValue);
+  giveNukiBleSemaphore();
+  return true;
+}
+
+bool NukiBle::storeUInt(const char* key, const uint32_t value) {
+  if (!takeNukiBleSemaphore("store")) {
+    return false;
+  }
+  bool result = preferences.putUInt(key, value) == sizeof(value);
+  giveNukiBleSemaphore();
+  return result;
+}
+
+bool NukiBle::removeStoredValue(const char* key) {
+  if (!takeNukiBleSemaphore("remove stored")) {
+    return false;
+  }
+  preferences.remove(key);
+  giveNukiBleSemaphore();
+  return true;
+}
+
+void NukiBle::createUpdatedKeypadEntry(const KeypadEntry& entry, UpdatedKeypadEntry* updatedEntry) {
+  //same fields, without creation/last active dates and lock count
+  memcpy(updatedEntry, &entry, offsetof(KeypadEntry, enabled) + sizeof(entry.enabled));
+  memcpy(&updatedEntry->timeLimited, &entry.timeLimited, sizeof(KeypadEntry) - offsetof(KeypadEntry, timeLimited));
+}
+
+bool NukiBle::isSameKeypadEntry(const KeypadEntry& entry, const UpdatedKeypadEntry& updatedEntry) {
+  UpdatedKeypadEntry current;
+  createUpdatedKeypadEntry(entry, &current);
+  //code ids are compared by the caller
+  current.codeId = updatedEntry.codeId;
+  return memcmp(&current, &updatedEntry, sizeof(UpdatedKeypadEntry)) == 0;
+}
+
 Nuki::CmdResult NukiBle::retrieveAuthorizationEntries(const uint16_t offset, const uint16_t count) {
   NukiLock::Action action;
   unsigned char payload[4] = {0};
@@ -388,20 +732,22 @@ Nuki::CmdResult NukiBle::retrieveAuthorizationEntries(const uint16_t offset, con
   memcpy(action.payload, &payload, sizeof(payload));
   action.payloadLen = sizeof(payload);
 
-  listOfAuthorizationEntries.clear();
+  authorizationEntryBuffer.clear();
 
-  return executeAction(action);
+  return executeAction(action, {Command::AuthorizationEntry, count, offset});
 }
 
 void NukiBle::getAuthorizationEntries(std::list<AuthorizationEntry>* requestedAuthorizationEntries) {
   requestedAuthorizationEntries->clear();
-  std::list<AuthorizationEntry>::iterator it = listOfAuthorizationEntries.begin();
-  while (it != listOfAuthorizationEntries.end()) {
-    requestedAuthorizationEntries->push_back(*it);
-    it++;
+  for (const AuthorizationEntry& entry : authorizationEntryBuffer) {
+    requestedAuthorizationEntries->push_back(entry);
   }
 }
 
+const AuthorizationEntryBuffer& NukiBle::getAuthorizationEntryBuffer() const {
+  return authorizationEntryBuffer;
+}
+
 Nuki::CmdResult NukiBle::addAuthorizationEntry(NewAuthorizationEntry newAuthorizationEntry) {
   //TODO verify data validity
   NukiLock::Action action;
@@ -446,6 +792,135 @@ Nuki::CmdResult NukiBle::updateAuthorizationEntry(UpdatedAuthorizationEntry upda
   return result;
 }
 
+std::vector<Nuki::CmdResult> NukiBle::executeBulk(const std::vector<BulkOperation>& operations, const BulkErrorPolicy policy,
+    const CommandPriority priority) {
+  std::vector<Nuki::CmdResult> results;
+  if (operations.empty()) {
+    return results;
+  }
+  if (!retrieveCredentials()) {
+    results.assign(operations.size(), Nuki::CmdResult::NotPaired);
+    return results;
+  }
+  if (!beginBulk(priority)) {
+    results.assign(operations.size(), Nuki::CmdResult::Failed);
+    return results;
+  }
+
+  //every operation still needs its own challenge: the nonce of a challenge is only valid for the next command,
+  //so the next one can only be requested after the status of the previous command has been received
+  #ifdef DEBUG_NUKI_COMMUNICATION
+  uint32_t startTs = millis();
+  #endif
+  for (const BulkOperation& operation : operations) {
+    if (!results.empty() && !yieldBulk()) {
+      log_w("Bulk stopped after %d of %d operations, turn not taken again", results.size(), operations.size());
+      results.resize(operations.size(), Nuki::CmdResult::Failed);
+      break;
+    }
+    Nuki::CmdResult result = executeBulkOperation(operation);
+    results.push_back(result);
+    if (result != Nuki::CmdResult::Success) {
+      log_w("Bulk operation %d of %d (type %d) failed: %d", results.size(), operations.size(), operation.type, result);
+      if (policy == BulkErrorPolicy::StopOnError) {
+        break;
+      }
+    }
+  }
+  endBulk();
+
+  #ifdef DEBUG_NUKI_COMMUNICATION
+  log_d("Bulk of %d operations done in %d ms", results.size(), millis() - startTs);
+  #endif
+  return results;
+}
+
+Nuki::CmdResult NukiBle::executeBulkOperation(const BulkOperation& operation) {
+  Nuki::CmdResult result = Nuki::CmdResult::Failed;
+  switch (operation.type) {
+    case BulkOperationType::AddKeypadEntry:
+      result = addKeypadEntry(operation.newKeypadEntry);
+      break;
+    case BulkOperationType::UpdateKeypadEntry:
+      result = updateKeypadEntry(operation.updatedKeypadEntry);
+      break;
+    case BulkOperationType::DeleteKeypadEntry:
+      result = deleteKeypadEntry(operation.keypadCodeId);
+      break;
+    case BulkOperationType::AddAuthorizationEntry:
+      return addAuthorizationEntry(operation.newAuthorizationEntry);
+    case BulkOperationType::UpdateAuthorizationEntry:
+      return updateAuthorizationEntry(operation.updatedAuthorizationEntry);
+    default:
+      log_w("Unknown bulk operation type %d", operation.type);
+      return Nuki::CmdResult::Failed;
+  }
+  //keypad changes made outside applyKeypadPlan() are picked up by the next syncKeypadMirror()
+  if (result == Nuki::CmdResult::Success) {
+    keypadMirrorStale = true;
+  }
+  return result;
+}
+
+bool NukiBle::enterCommand(const Nuki::CommandPriority priority) {
+  //commands of a bulk run use the queue turn and the radio held for the whole run
+  if (isBulkTask()) {
+    return true;
+  }
+  if (!commandQueue.enter(priority)) {
+    return false;
+  }
+  //with several devices on one ESP32 only one at a time uses the radio
+  if (deviceManager && !deviceManager->acquireRadio(this)) {
+    commandQueue.leave();
+    return false;
+  }
+  return true;
+}
+
+void NukiBle::leaveCommand() {
+  if (isBulkTask()) {
+    return;
+  }
+  if (deviceManager) {
+    deviceManager->releaseRadio(this);
+  }
+  commandQueue.leave();
+}
+
+bool NukiBle::isBulkTask() {
+  return bulkTask != nullptr && bulkTask == xTaskGetCurrentTaskHandle();
+}
+
+bool NukiBle::beginBulk(const Nuki::CommandPriority priority) {
+  if (!enterCommand(priority)) {
+    log_w("Bulk not started, queue timeout, queue full or radio busy");
+    return false;
+  }
+  bulkPriority = priority;
+  bulkTask = xTaskGetCurrentTaskHandle();
+  return true;
+}
+
+void NukiBle::endBulk() {
+  if (!isBulkTask()) {
+    return;
+  }
+  bulkTask = nullptr;
+  leaveCommand();
+}
+
+bool NukiBle::yieldBulk() {
+  if (!isBulkTask() || commandQueue.getDepth() == 0) {
+    return true;
+  }
+  //let the waiting commands in, the run continues in its own lane after them (low priority behind all waiting
+  //commands, high priority behind the waiting lock actions); the connection stays open as it was just used
+  Nuki::CommandPriority priority = bulkPriority;
+  endBulk();
+  return beginBulk(priority);
+}
+
 uint16_t NukiBle::getLogEntryCount() {
   return logEntryCount;
 }
@@ -575,12 +1050,18 @@ void NukiBle::saveCredentials() {
     printBuffer(authorizationId, sizeof(authorizationId), false, AUTH_ID_STORE_NAME);
     log_d("pincode: %d", pinCode);
     #endif
+    crypto.setKey(secretKeyK);
+    credentialsCached = true;
   } else {
     log_w("ERROR saving credentials");
+    credentialsCached = false;
   }
 }
 
 uint16_t NukiBle::getSecurityPincode() {
+  if (credentialsCached) {
+    return pinCode;
+  }
 
   if (takeNukiBleSemaphore("retr pincode cred")) {
     uint16_t storedPincode = 0000;
@@ -609,6 +1090,11 @@ bool NukiBle::retrieveCredentials() {
   //TODO check on empty (invalid) credentials?
   unsigned char buff[6];
 
+  //credentials are kept in memory once read or saved, only read NVS again after they are deleted
+  if (credentialsCached) {
+    return true;
+  }
+
   if (takeNukiBleSemaphore("retr cred")) {
     if ((preferences.getBytes(BLE_ADDRESS_STORE_NAME, buff, 6) > 0)
         && (preferences.getBytes(SECURITY_PINCODE_STORE_NAME, &pinCode, 2) > 0)
@@ -633,6 +1119,8 @@ bool NukiBle::retrieveCredentials() {
       if (pinCode == 0) {
         log_w("Pincode is 000000, probably not defined");
       }
+      crypto.setKey(secretKeyK);
+      credentialsCached = true;
 
     } else {
       log_e("Error getting data from NVS");
@@ -646,6 +1134,8 @@ bool NukiBle::retrieveCredentials() {
 }
 
 void NukiBle::deleteCredentials() {
+  credentialsCached = false;
+  crypto.clear();
   if (takeNukiBleSemaphore("del cred")) {
     unsigned char emptySecretKeyK[32] = {0x00};
     unsigned char emptyAuthorizationId[4] = {0x00};
@@ -653,7 +1143,15 @@ void NukiBle::deleteCredentials() {
     preferences.putBytes(AUTH_ID_STORE_NAME, emptyAuthorizationId, 4);
     // preferences.remove(SECRET_KEY_STORE_NAME);
     // preferences.remove(AUTH_ID_STORE_NAME);
+    memset(secretKeyK, 0, sizeof(secretKeyK));
+    memset(authorizationId, 0, sizeof(authorizationId));
+    //the mirror belongs to the lock that was paired
+    preferences.remove(KEYPAD_MIRROR_STORE_NAME);
+    keypadMirror.clear();
+    keypadMirrorLoaded = true;
     giveNukiBleSemaphore();
+    //the device type stores its data through the guarded helpers, the semaphore must be released first
+    onCredentialsDeleted();
   }
   #ifdef DEBUG_NUKI_CONNECT
   log_d("Credentials deleted");
@@ -820,60 +1318,21 @@ PairingState NukiBle::pairStateMachine(const PairingState nukiPairingState) {
 }
 
 bool NukiBle::sendEncryptedMessage(Command commandIdentifier, const unsigned char* payload, const uint8_t payloadLen) {
-  /*
-  #     ADDITIONAL DATA (not encr)      #                    PLAIN DATA (encr)                             #
-  #  nonce  # auth identifier # msg len # authorization identifier # command identifier # payload #  crc   #
-  # 24 byte #    4 byte       # 2 byte  #      4 byte              #       2 byte       #  n byte # 2 byte #
-  */
-
-  //compose plain data
-  unsigned char plainData[6 + payloadLen] = {};
-  unsigned char plainDataWithCrc[8 + payloadLen] = {};
-
-  memcpy(&plainData[0], &authorizationId, sizeof(authorizationId));
-  memcpy(&plainData[4], &commandIdentifier, sizeof(commandIdentifier));
-  memcpy(&plainData[6], payload, payloadLen);
-
-  //get crc over plain data
-  uint16_t dataCrc = calculateCrc((uint8_t*)plainData, 0, sizeof(plainData));
-
-  memcpy(&plainDataWithCrc[0], &plainData, sizeof(plainData));
-  memcpy(&plainDataWithCrc[sizeof(plainData)], &dataCrc, sizeof(dataCrc));
-
-  #ifdef DEBUG_NUKI_HEX_DATA
-  log_d("payloadlen: %d", payloadLen);
-  log_d("sizeof(plainData): %d", sizeof(plainData));
-  log_d("CRC: %0.2x", dataCrc);
-  #endif
-  printBuffer((byte*)plainDataWithCrc, sizeof(plainDataWithCrc), false, "Plain data with CRC: ");
-
-  //compose additional data
-  unsigned char additionalData[30] = {};
-  generateNonce(sentNonce, sizeof(sentNonce));
-
-  memcpy(&additionalData[0], sentNonce, sizeof(sentNonce));
-  memcpy(&additionalData[24], authorizationId, sizeof(authorizationId));
-
-  //Encrypt plain data
-  unsigned char plainDataEncr[ sizeof(plainDataWithCrc) + crypto_secretbox_MACBYTES] = {0};
-  int encrMsgLen = encode(plainDataEncr, plainDataWithCrc, sizeof(plainDataWithCrc), sentNonce, secretKeyK);
-
-  if (encrMsgLen >= 0) {
-    int16_t length = sizeof(plainDataEncr);
-    memcpy(&additionalData[28], &length, 2);
-
-    printBuffer((byte*)additionalData, 30, false, "Additional data: ");
+  generateMessageNonce(sentNonce);
+
+  //frame is laid out once in the send buffer and encrypted in place
+  uint16_t frameLen = buildEncryptedFrame(sendFrame, sizeof(sendFrame), authorizationId, commandIdentifier,
+                                          payload, payloadLen, sentNonce, crypto);
+  if (frameLen > 0) {
+    #ifdef DEBUG_NUKI_HEX_DATA
+    log_d("payloadlen: %d", payloadLen);
+    #endif
+    printBuffer((byte*)sendFrame, ENCRYPTED_FRAME_HEADER_SIZE, false, "Additional data: ");
     printBuffer((byte*)secretKeyK, sizeof(secretKeyK), false, "Encryption key (secretKey): ");
-    printBuffer((byte*)plainDataEncr, sizeof(plainDataEncr), false, "Plain data encrypted: ");
-
-    //compose complete message
-    unsigned char dataToSend[sizeof(additionalData) + sizeof(plainDataEncr)] = {};
-    memcpy(&dataToSend[0], additionalData, sizeof(additionalData));
-    memcpy(&dataToSend[30], plainDataEncr, sizeof(plainDataEncr));
 
     if (connectBle(bleAddress)) {
-      printBuffer((byte*)dataToSend, sizeof(dataToSend), false, "Sending encrypted message");
-      return pUsdioCharacteristic->writeValue((uint8_t*)dataToSend, sizeof(dataToSend), true);
+      printBuffer((byte*)sendFrame, frameLen, false, "Sending encrypted message");
+      return pUsdioCharacteristic->writeValue((uint8_t*)sendFrame, frameLen, true);
     } else {
       log_w("Send encr msg failed due to unable to connect");
     }
@@ -913,73 +1372,105 @@ bool NukiBle::sendPlainMessage(Command commandIdentifier, const unsigned char* p
 }
 
 bool NukiBle::registerOnGdioChar() {
-  // Obtain a reference to the KeyTurner Pairing service
-  pKeyturnerPairingService = pClient->getService(pairingServiceUUID);
-  if (pKeyturnerPairingService != nullptr) {
+  if (!gattCached) {
+    // Obtain a reference to the KeyTurner Pairing service
+    pKeyturnerPairingService = pClient->getService(pairingServiceUUID);
+    if (pKeyturnerPairingService == nullptr) {
+      log_w("Unable to get keyturner pairing service");
+      return false;
+    }
     //Obtain reference to GDIO char
     pGdioCharacteristic = pKeyturnerPairingService->getCharacteristic(gdioUUID);
-    if (pGdioCharacteristic != nullptr) {
-      if (pGdioCharacteristic->canIndicate()) {
-
-        using namespace std::placeholders;
-        notify_callback callback = std::bind(&NukiBle::notifyCallback, this, _1, _2, _3, _4);
-        pGdioCharacteristic->subscribe(false, callback, true); //false = indication, true = notification
-        #ifdef DEBUG_NUKI_COMMUNICATION
-        log_d("GDIO characteristic registered");
-        #endif
-        delay(100);
-        return true;
-      } else {
-        #ifdef DEBUG_NUKI_COMMUNICATION
-        log_d("GDIO characteristic canIndicate false, stop connecting");
-        #endif
-        return false;
-      }
-    } else {
+    if (pGdioCharacteristic == nullptr) {
       log_w("Unable to get GDIO characteristic");
       return false;
     }
+  }
+
+  if (pGdioCharacteristic->canIndicate()) {
+    using namespace std::placeholders;
+    notify_callback callback = std::bind(&NukiBle::notifyCallback, this, _1, _2, _3, _4);
+    //subscribe waits for the lock to acknowledge the descriptor write, no need for an extra delay
+    if (!pGdioCharacteristic->subscribe(false, callback, true)) { //false = indication, true = notification
+      log_w("Unable to subscribe on GDIO characteristic");
+      return false;
+    }
+    #ifdef DEBUG_NUKI_COMMUNICATION
+    log_d("GDIO characteristic registered");
+    #endif
+    return true;
   } else {
-    log_w("Unable to get keyturner pairing service");
+    #ifdef DEBUG_NUKI_COMMUNICATION
+    log_d("GDIO characteristic canIndicate false, stop connecting");
+    #endif
     return false;
   }
-  return false;
 }
 
 bool NukiBle::registerOnUsdioChar() {
-  // Obtain a reference to the KeyTurner service
-  pKeyturnerDataService = pClient->getService(deviceServiceUUID);
-  if (pKeyturnerDataService != nullptr) {
+  if (!gattCached) {
+    // Obtain a reference to the KeyTurner service
+    pKeyturnerDataService = pClient->getService(deviceServiceUUID);
+    if (pKeyturnerDataService == nullptr) {
+      log_w("Unable to get keyturner data service");
+      return false;
+    }
     //Obtain reference to NDIO char
     pUsdioCharacteristic = pKeyturnerDataService->getCharacteristic(userDataUUID);
-    if (pUsdioCharacteristic != nullptr) {
-      if (pUsdioCharacteristic->canIndicate()) {
-
-        using namespace std::placeholders;
-        notify_callback callback = std::bind(&NukiBle::notifyCallback, this, _1, _2, _3, _4);
-
-        pUsdioCharacteristic->subscribe(false, callback, true); //false = indication, true = notification
-        #ifdef DEBUG_NUKI_COMMUNICATION
-        log_d("USDIO characteristic registered");
-        #endif
-        delay(100);
-        return true;
-      } else {
-        #ifdef DEBUG_NUKI_COMMUNICATION
-        log_d("USDIO characteristic canIndicate false, stop connecting");
-        #endif
-        return false;
-      }
-    } else {
+    if (pUsdioCharacteristic == nullptr) {
       log_w("Unable to get USDIO characteristic");
       return false;
     }
+  }
+
+  if (pUsdioCharacteristic->canIndicate()) {
+    using namespace std::placeholders;
+    notify_callback callback = std::bind(&NukiBle::notifyCallback, this, _1, _2, _3, _4);
+    if (!pUsdioCharacteristic->subscribe(false, callback, true)) { //false = indication, true = notification
+      log_w("Unable to subscribe on USDIO characteristic");
+      return false;
+    }
+    #ifdef DEBUG_NUKI_COMMUNICATION
+    log_d("USDIO characteristic registered");
+    #endif
+    return true;
   } else {
-    log_w("Unable to get keyturner data service");
+    #ifdef DEBUG_NUKI_COMMUNICATION
+    log_d("USDIO characteristic canIndicate false, stop connecting");
+    #endif
     return false;
   }
+}
 
-  return false;
+void NukiBle::invalidateGattCache() {
+  gattCached = false;
+  pKeyturnerPairingService = nullptr;
+  pGdioCharacteristic = nullptr;
+  pKeyturnerDataService = nullptr;
+  pUsdioCharacteristic = nullptr;
+}
+
+void NukiBle::generateMessageNonce(unsigned char* nonce) {
+  /*
+  #  counter  #  random  #
+  #  8 byte   #  16 byte #
+  */
+  //the counter never repeats, not even across reboots: the stored value is the first counter not yet handed out
+  //and is moved NONCE_COUNTER_RESERVE ahead before that block of counters is used
+  if (!nonceCounterLoaded) {
+    nonceCounter = preferences.getULong64(NONCE_COUNTER_STORE_NAME, 0);
+    nonceCounterReserved = nonceCounter;
+    nonceCounterLoaded = true;
+  }
+  if (nonceCounter >= nonceCounterReserved) {
+    nonceCounterReserved = nonceCounter + NONCE_COUNTER_RESERVE;
+    if (preferences.putULong64(NONCE_COUNTER_STORE_NAME, nonceCounterReserved) != sizeof(nonceCounterReserved)) {
+      log_w("Unable to store nonce counter");
+    }
+  }
+  memcpy(nonce, &nonceCounter, sizeof(nonceCounter));
+  generateNonce(&nonce[sizeof(nonceCounter)], crypto_secretbox_NONCEBYTES - sizeof(nonceCounter));
+  nonceCounter++;
 }
 
 void NukiBle::notifyCallback(BLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* recData, size_t length, bool isNotify) {
@@ -992,43 +1483,29 @@ void NukiBle::notifyCallback(BLERemoteCharacteristic* pBLERemoteCharacteristic,
   if (pBLERemoteCharacteristic->getUUID() == gdioUUID) {
     //handle not encrypted msg
     uint16_t returnCode = ((uint16_t)recData[1] << 8) | recData[0];
-    crcCheckOke = crcValid(recData, length);
+    crcCheckOke = length >= 4 && crcValid(recData, length);
     if (crcCheckOke) {
-      unsigned char plainData[200];
-      memcpy(plainData, &recData[2], length - 4);
-      handleReturnMessage((Command)returnCode, plainData, length - 4);
+      //payload is handed over as a view into the received data
+      handleReturnMessage((Command)returnCode, &recData[2], length - 4);
+      collectListFrame((Command)returnCode, &recData[2], length - 4);
+      xEventGroupSetBits(nukiBleEvents, NUKI_EVENT_MESSAGE_RECEIVED);
     }
   } else if (pBLERemoteCharacteristic->getUUID() == userDataUUID) {
-    //handle encrypted msg
-    unsigned char recNonce[crypto_secretbox_NONCEBYTES];
-    unsigned char recAuthorizationId[4];
-    unsigned char recMsgLen[2];
-    memcpy(recNonce, &recData[0], crypto_secretbox_NONCEBYTES);
-    memcpy(recAuthorizationId, &recData[crypto_secretbox_NONCEBYTES], 4);
-    memcpy(recMsgLen, &recData[crypto_secretbox_NONCEBYTES + 4], 2);
-    uint16_t encrMsgLen = 0;
-    memcpy(&encrMsgLen, recMsgLen, 2);
-    unsigned char encrData[encrMsgLen];
-    memcpy(&encrData, &recData[crypto_secretbox_NONCEBYTES + 6], encrMsgLen);
-
-    unsigned char decrData[encrMsgLen - crypto_secretbox_MACBYTES];
-    decode(decrData, encrData, encrMsgLen, recNonce, secretKeyK);
+    //handle encrypted msg, decrypted directly from the received data into the receive buffer
+    int16_t plainDataLen = openEncryptedFrame(receivedPlainData, sizeof(receivedPlainData), recData, length, crypto);
 
     #ifdef DEBUG_NUKI_COMMUNICATION
-    log_d("Received encrypted msg, len: %d", encrMsgLen);
+    log_d("Received encrypted msg, len: %d", length);
     #endif
-    printBuffer(recNonce, sizeof(recNonce), false, "received nonce");
-    printBuffer(recAuthorizationId, sizeof(recAuthorizationId), false, "Received AuthorizationId");
-    printBuffer(encrData, sizeof(encrData), false, "Rec encrypted data");
-    printBuffer(decrData, sizeof(decrData), false, "Decrypted data");
 
-    crcCheckOke = crcValid(decrData, sizeof(decrData));
+    crcCheckOke = plainDataLen >= 8;
     if (crcCheckOke) {
       uint16_t returnCode = 0;
-      memcpy(&returnCode, &decrData[4], 2);
-      unsigned char payload[sizeof(decrData) - 8];
-      memcpy(&payload, &decrData[6], sizeof(payload));
-      handleReturnMessage((Command)returnCode, payload, sizeof(payload));
+      memcpy(&returnCode, &receivedPlainData[4], 2);
+      //payload is handed over as a view into the receive buffer
+      handleReturnMessage((Command)returnCode, &receivedPlainData[6], plainDataLen - 8);
+      collectListFrame((Command)returnCode, &receivedPlainData[6], plainDataLen - 8);
+      xEventGroupSetBits(nukiBleEvents, NUKI_EVENT_MESSAGE_RECEIVED);
     }
   }
 }
@@ -1073,7 +1550,12 @@ void NukiBle::handleReturnMessage(Command returnCode, unsigned char* data, uint1
       printBuffer((byte*)data, dataLen, false, "authorizationEntry");
       AuthorizationEntry authEntry;
       memcpy(&authEntry, data, sizeof(authEntry));
-      listOfAuthorizationEntries.push_back(authEntry);
+      if (entrySink) {
+        entrySink->onAuthorizationEntry(authEntry);
+      }
+      if (!authorizationEntryBuffer.tryPush(authEntry) && !entrySink) {
+        log_w("Authorization entry buffer full (%d entries), entry dropped", AUTHORIZATION_ENTRIES_BUFFER_SIZE);
+      }
       #ifdef DEBUG_NUKI_READABLE_DATA
       NukiLock::logAuthorizationEntry(authEntry);
       #endif
@@ -1133,6 +1615,7 @@ void NukiBle::handleReturnMessage(Command returnCode, unsigned char* data, uint1
       break;
     }
     case Command::KeypadCodeId : {
+      memcpy(&lastKeypadCodeId, data, sizeof(lastKeypadCodeId));
       printBuffer((byte*)data, dataLen, false, "keypadCodeId");
       break;
     }
@@ -1151,7 +1634,12 @@ void NukiBle::handleReturnMessage(Command returnCode, unsigned char* data, uint1
     case Command::KeypadCode : {
       KeypadEntry keypadEntry;
       memcpy(&keypadEntry, data, sizeof(KeypadEntry));
-      listOfKeyPadEntries.push_back(keypadEntry);
+      if (entrySink) {
+        entrySink->onKeypadEntry(keypadEntry);
+      }
+      if (!keypadEntryBuffer.tryPush(keypadEntry) && !entrySink) {
+        log_w("Keypad entry buffer full (%d entries), entry dropped", KEYPAD_ENTRIES_BUFFER_SIZE);
+      }
       nrOfReceivedKeypadCodes++;
 
       printBuffer((byte*)data, dataLen, false, "keypadCode");
@@ -1176,6 +1664,10 @@ void NukiBle::onConnect(BLEClient*) {
 };
 
 void NukiBle::onDisconnect(BLEClient*) {
+  NUKI_TRACE(Disconnected);
+  if (deviceManager) {
+    deviceManager->onLinkClosed(this);
+  }
   #ifdef DEBUG_NUKI_CONNECT
   log_d("BLE disconnected");
   #endif
@@ -1185,6 +1677,10 @@ void NukiBle::setEventHandler(SmartlockEventHandler* handler) {
   eventHandler = handler;
 }
 
+void NukiBle::setEntrySink(EntrySink* sink) {
+  entrySink = sink;
+}
+
 const bool NukiBle::isPairedWithLock() const {
   return isPaired;
 };
@@ -1206,6 +1702,105 @@ void NukiBle::giveNukiBleSemaphore() {
   xSemaphoreGive(nukiBleSemaphore);
 }
 
+bool NukiBle::waitForMessage(const uint32_t timeoutMs) {
+  EventBits_t bits = xEventGroupWaitBits(nukiBleEvents, NUKI_EVENT_MESSAGE_RECEIVED, pdTRUE, pdFALSE, timeoutMs / portTICK_PERIOD_MS);
+  return (bits & NUKI_EVENT_MESSAGE_RECEIVED) != 0;
+}
+
+void NukiBle::beginListRetrieval(const ListRequest& listRequest) {
+  listOffset = listRequest.offset;
+  listExpectedCount = listRequest.count;
+  listReceivedCount = 0;
+  listEndsWithStatus = listRequest.endsWithStatus;
+  listFailed = false;
+  listComplete = false;
+  lastListFrame = millis();
+  listEntryCommand = listRequest.entryCommand;
+}
+
+Nuki::CmdResult NukiBle::waitForListRetrieval() {
+  while (!listComplete) {
+    if (millis() - lastListFrame > GENERAL_TIMEOUT) {
+      log_w("List retrieval timeout, %d of %d entries received", listReceivedCount, listExpectedCount);
+      endListRetrieval();
+      return Nuki::CmdResult::TimeOut;
+    }
+    esp_task_wdt_reset();
+    waitForMessage(RESPONSE_WAIT_SLICE);
+  }
+  endListRetrieval();
+
+  #ifdef DEBUG_NUKI_COMMUNICATION
+  log_d("List retrieval complete, %d entries received", listReceivedCount);
+  #endif
+  return listFailed ? Nuki::CmdResult::Failed : Nuki::CmdResult::Success;
+}
+
+void NukiBle::endListRetrieval() {
+  listEntryCommand = Command::Empty;
+}
+
+void NukiBle::collectListFrame(Command returnCode, unsigned char* data, uint16_t dataLen) {
+  if (listEntryCommand == Command::Empty || listComplete) {
+    return;
+  }
+  lastListFrame = millis();
+  //a long list must not be cut by the idle disconnect
+  extendDisonnectTimeout();
+
+  //number of entries available on the device, sent before the entries
+  int32_t availableCount = -1;
+  switch (returnCode) {
+    case Command::AuthorizationEntryCount:
+    case Command::KeypadCodeCount:
+      if (dataLen >= 2) {
+        availableCount = data[0] | (data[1] << 8);
+      }
+      break;
+    case Command::TimeControlEntryCount:
+      if (dataLen >= 1) {
+        availableCount = data[0];
+      }
+      break;
+    case Command::LogEntryCount:
+      if (dataLen >= 3) {
+        availableCount = data[1] | (data[2] << 8);
+      }
+      break;
+    case Command::Status:
+      //a trailing status complete ends the list, whatever the number of entries
+      if (dataLen >= 1 && data[0] == (uint8_t)CommandStatus::Complete) {
+        listComplete = true;
+      }
+      return;
+    case Command::ErrorReport:
+      listFailed = true;
+      listComplete = true;
+      return;
+    default:
+      if (returnCode == listEntryCommand) {
+        listReceivedCount++;
+      }
+      break;
+  }
+
+  if (availableCount >= 0) {
+    uint16_t remaining = availableCount > listOffset ? availableCount - listOffset : 0;
+    if (remaining < listExpectedCount) {
+      listExpectedCount = remaining;
+    }
+  }
+  if (!listEndsWithStatus && listReceivedCount >= listExpectedCount) {
+    listComplete = true;
+  }
+}
+
+bool NukiBle::isAwaitingMessage() const {
+  return nukiCommandState == CommandState::ChallengeSent
+         || nukiCommandState == CommandState::CmdSent
+         || nukiCommandState == CommandState::CmdAccepted;
+}
+
 int NukiBle::getRssi() const {
   return rssi;
 }
@@ -1222,4 +1817,99 @@ const BLEAddress NukiBle::getBleAddress() const {
   return bleAddress;
 }
 
+uint32_t NukiBle::executeAsync(std::function<Nuki::CmdResult()> command, AsyncCmdCallback callback,
+                               const CommandPriority priority) {
+  if (!command) {
+    return 0;
+  }
+
+  uint32_t handle = 0;
+  if (xSemaphoreTake(asyncQueueSemaphore, NUKI_SEMAPHORE_TIMEOUT / portTICK_PERIOD_MS) == pdTRUE) {
+    if (asyncTaskHandle == nullptr
+        && xTaskCreate(&NukiBle::asyncTask, "nukiAsync", NUKI_ASYNC_TASK_STACK_SIZE, this,
+                       NUKI_ASYNC_TASK_PRIORITY, &asyncTaskHandle) != pdPASS) {
+      log_e("Unable to start async task");
+      asyncTaskHandle = nullptr;
+    } else if (asyncCommands.size() >= NUKI_ASYNC_QUEUE_SIZE) {
+      log_w("Async command queue full");
+    } else {
+      handle = nextAsyncHandle++;
+      if (nextAsyncHandle == 0) {
+        nextAsyncHandle = 1;
+      }
+      //high priority commands go before the first queued low priority command
+      auto it = asyncCommands.begin();
+      if (priority == CommandPriority::High) {
+        while (it != asyncCommands.end() && it->priority == CommandPriority::High) {
+          it++;
+        }
+      } else {
+        it = asyncCommands.end();
+      }
+      asyncCommands.insert(it, {handle, priority, command, callback});
+    }
+    xSemaphoreGive(asyncQueueSemaphore);
+  }
+
+  if (handle != 0) {
+    xSemaphoreGive(asyncCommandsAvailable);
+    #ifdef DEBUG_NUKI_COMMUNICATION
+    log_d("Async command %d queued", handle);
+    #endif
+  }
+  return handle;
+}
+
+uint8_t NukiBle::getPendingAsyncCommands() {
+  uint8_t pending = 0;
+  if (xSemaphoreTake(asyncQueueSemaphore, NUKI_SEMAPHORE_TIMEOUT / portTICK_PERIOD_MS) == pdTRUE) {
+    pending = asyncCommands.size();
+    xSemaphoreGive(asyncQueueSemaphore);
+  }
+  return pending;
+}
+
+uint8_t NukiBle::getCommandQueueDepth() {
+  return commandQueue.getDepth();
+}
+
+CommandQueueLaneStats NukiBle::getCommandQueueStats(const CommandPriority priority) {
+  return commandQueue.getStats(priority);
+}
+
+void NukiBle::asyncTask(void* pvParameters) {
+  NukiBle* nukiBle = static_cast<NukiBle*>(pvParameters);
+  while (!nukiBle->asyncTaskStopping) {
+    if (xSemaphoreTake(nukiBle->asyncCommandsAvailable, portMAX_DELAY) == pdTRUE && !nukiBle->asyncTaskStopping) {
+      nukiBle->runNextAsyncCommand();
+    }
+  }
+  xSemaphoreGive(nukiBle->asyncTaskStopped);
+  vTaskDelete(NULL);
+}
+
+void NukiBle::runNextAsyncCommand() {
+  AsyncCommand asyncCommand;
+  if (xSemaphoreTake(asyncQueueSemaphore, portMAX_DELAY) != pdTRUE) {
+    return;
+  }
+  if (asyncCommands.empty()) {
+    xSemaphoreGive(asyncQueueSemaphore);
+    return;
+  }
+  asyncCommand = asyncCommands.front();
+  asyncCommands.pop_front();
+  xSemaphoreGive(asyncQueueSemaphore);
+
+  #ifdef DEBUG_NUKI_COMMUNICATION
+  log_d("Executing async command %d", asyncCommand.handle);
+  #endif
+  runningAsyncHandle = asyncCommand.handle;
+  Nuki::CmdResult result = asyncCommand.command();
+  if (asyncCommand.callback) {
+    asyncCommand.callback(asyncCommand.handle, result);
+  }
+  runningAsyncHandle = 0;
+}
+
 } // namespace Nuki
@@ -14,18 +14,66 @@
 #include "NimBLEDevice.h"
 #include "NukiConstants.h"
 #include "NukiDataTypes.h"
+#include "NukiCommandQueue.h"
+#include "NukiCrypto.h"
+#include "NukiDeviceManager.h"
+#include "NukiInstrumentation.h"
+#include "NukiRingBuffer.h"
 #include "Arduino.h"
 #include <Preferences.h>
 #include <esp_task_wdt.h>
+#include "freertos/event_groups.h"
 #include <BleInterfaces.h>
+#include <deque>
+#include <map>
+#include <vector>
 #include "sodium/crypto_secretbox.h"
 
 #define GENERAL_TIMEOUT 3000
 #define CMD_TIMEOUT 5000
 #define PAIRING_TIMEOUT 30000
 #define HEARTBEAT_TIMEOUT 30000
+#define RESPONSE_WAIT_SLICE 100
+#define MAX_FRAME_SIZE 200
+#define NONCE_COUNTER_RESERVE 1000  //message nonces reserved per NVS write of the nonce counter
+
+#define NUKI_EVENT_MESSAGE_RECEIVED (1 << 0)
+
+#define ADAPTIVE_DISCONNECT_MAX_TIMEOUT 15000 //stay below the ~20 sec after which the lock disconnects itself
+#define ADAPTIVE_DISCONNECT_WEIGHT 4          //weight of history in the average command gap and connect duration
+
+#ifndef KEYPAD_MIRROR_MAX_ENTRIES
+#define KEYPAD_MIRROR_MAX_ENTRIES 200
+#endif
+
+//capacity of the buffers holding retrieved entries, can be changed with a build flag.
+//The buffers are part of the lock/opener object, entries received beyond the capacity are dropped and counted
+//in the dropped() of the buffer
+#ifndef KEYPAD_ENTRIES_BUFFER_SIZE
+#define KEYPAD_ENTRIES_BUFFER_SIZE 50
+#endif
+#ifndef AUTHORIZATION_ENTRIES_BUFFER_SIZE
+#define AUTHORIZATION_ENTRIES_BUFFER_SIZE 32
+#endif
+#ifndef LOG_ENTRIES_BUFFER_SIZE
+#define LOG_ENTRIES_BUFFER_SIZE 50
+#endif
+#ifndef TIME_CONTROL_ENTRIES_BUFFER_SIZE
+#define TIME_CONTROL_ENTRIES_BUFFER_SIZE 20
+#endif
+
+#define NUKI_ASYNC_QUEUE_SIZE 10
+#define NUKI_ASYNC_TASK_STACK_SIZE 8192
+#define NUKI_ASYNC_TASK_PRIORITY 1
 
 namespace Nuki {
+
+typedef RingBuffer<KeypadEntry, KEYPAD_ENTRIES_BUFFER_SIZE> KeypadEntryBuffer;
+typedef RingBuffer<AuthorizationEntry, AUTHORIZATION_ENTRIES_BUFFER_SIZE> AuthorizationEntryBuffer;
+
+template <typename TLogEntry>
+class LogSync;
+
 class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
   public:
     NukiBle(const std::string& deviceName,
@@ -44,6 +92,14 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
      */
     void setEventHandler(Nuki::SmartlockEventHandler* handler);
 
+    /**
+     * @brief Set the sink receiving every keypad and authorization entry as soon as it is received.
+     * The entries are still stored in the entry buffers, entries beyond the buffer size only go to the sink
+     *
+     * @param sink sink for the entries, nullptr to remove it
+     */
+    void setEntrySink(Nuki::EntrySink* sink);
+
     /**
      * @brief Checks if credentials are stored in preferences, if not initiate pairing
      *
@@ -76,6 +132,22 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
      */
     void setDisonnectTimeout(uint32_t timeoutMs);
 
+    /**
+     * @brief Enable/disable the adaptive disconnect timeout (enabled by default).
+     * When enabled the idle gap between commands is learned and the connection is kept alive for
+     * the expected gap when a reconnect would be needed otherwise, but never longer than
+     * ADAPTIVE_DISCONNECT_MAX_TIMEOUT. The timeout set by setDisonnectTimeout() is the minimum.
+     *
+     * @param enable
+     */
+    void enableAdaptiveDisconnect(const bool enable);
+
+    /**
+     * @brief Returns how often commands found a live connection, the learned command gap
+     * and the resulting idle disconnect timeout
+     */
+    Nuki::ConnectionStats getConnectionStats() const;
+
     /**
      * @brief Set the BLE Connect Timeout in seconds.
      *
@@ -141,6 +213,13 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
      */
     void getKeypadEntries(std::list<KeypadEntry>* requestedKeyPadEntries);
 
+    /**
+     * @brief Read-only view of the Keypad Entries stored on the esp, without copying them.
+     * Iterate with a range based for loop or forEach(), valid until the next retrieveKeypadEntries().
+     * dropped() is the number of entries beyond KEYPAD_ENTRIES_BUFFER_SIZE that were received but not stored
+     */
+    const Nuki::KeypadEntryBuffer& getKeypadEntryBuffer() const;
+
     /**
     * @brief Delete a Keypad Entry
     *
@@ -148,6 +227,43 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
     */
     CmdResult deleteKeypadEntry(uint16_t id);
 
+    /**
+     * @brief Brings the local mirror of the keypad entries up to date with the lock. All entries are retrieved and
+     * compared with the mirror, which is kept in the preferences and updated by applyKeypadPlan(). The preferences
+     * are only written when an entry was changed on the lock.
+     *
+     * @param forceReload store the retrieved entries even if they match the mirror
+     * @return Failed if the lock has more than KEYPAD_MIRROR_MAX_ENTRIES codes, the mirror is then incomplete
+     * and must not be used to plan changes
+     */
+    Nuki::CmdResult syncKeypadMirror(const bool forceReload = false);
+
+    /**
+     * @brief Get the keypad entries of the local mirror, ordered by code id
+     *
+     * @param entries list to store the keypad entries
+     */
+    void getKeypadMirror(std::list<KeypadEntry>* entries);
+
+    /**
+     * @brief Compares the wanted keypad entries with the local mirror (call syncKeypadMirror() first) and returns
+     * the operations needed to get the lock there. Entries with a code id are compared with the mirrored entry with
+     * that id, entries without code id (0) are matched on their code.
+     *
+     * @param wantedEntries the keypad entries that should be on the lock
+     * @param removeUnlisted remove entries on the lock that are not in wantedEntries
+     */
+    std::vector<Nuki::KeypadPlanEntry> planKeypadChanges(const std::vector<UpdatedKeypadEntry>& wantedEntries,
+                                                         const bool removeUnlisted = true);
+
+    /**
+     * @brief Executes the operations of a plan made with planKeypadChanges() and updates the local mirror
+     *
+     * @param plan operations to execute
+     * @return result per operation
+     */
+    std::vector<Nuki::KeypadPlanResult> applyKeypadPlan(const std::vector<Nuki::KeypadPlanEntry>& plan);
+
     /**
      * @brief Request the lock via BLE to send the existing authorizationentries
      *
@@ -163,6 +279,13 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
      */
     void getAuthorizationEntries(std::list<AuthorizationEntry>* requestedAuthorizationEntries);
 
+    /**
+     * @brief Read-only view of the Authorization Entries stored on the esp, without copying them.
+     * Valid until the next retrieveAuthorizationEntries().
+     * dropped() is the number of entries beyond AUTHORIZATION_ENTRIES_BUFFER_SIZE that were received but not stored
+     */
+    const Nuki::AuthorizationEntryBuffer& getAuthorizationEntryBuffer() const;
+
     /**
      * @brief Sends a new authorization entry to the lock via BLE
      *
@@ -177,6 +300,21 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
      */
     Nuki::CmdResult updateAuthorizationEntry(UpdatedAuthorizationEntry updatedAuthorizationEntry);
 
+    /**
+     * @brief Executes a list of keypad and authorization operations over one connection, e.g. to provision the
+     * codes of a whole office. The queue turn and the radio are held for the whole run so the connection is not
+     * closed or taken over in between, commands waiting in the queue are still let in between two operations.
+     *
+     * @param operations operations to execute, in order
+     * @param policy stop at the first failed operation or continue with the next one
+     * @param priority queue lane the run waits in, also after letting waiting commands in
+     * @return result per executed operation, with StopOnError shorter than operations if one failed.
+     * If the turn can not be taken again after letting other commands in, the remaining operations are Failed
+     */
+    std::vector<Nuki::CmdResult> executeBulk(const std::vector<Nuki::BulkOperation>& operations,
+                                             const Nuki::BulkErrorPolicy policy = Nuki::BulkErrorPolicy::StopOnError,
+                                             const Nuki::CommandPriority priority = Nuki::CommandPriority::Low);
+
     /**
      * @brief Sends an calibration (mechanical) request to the lock via BLE
      */
@@ -252,6 +390,21 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
      */
     void registerBleScanner(BleScanner::Publisher* bleScanner);
 
+    /**
+     * @brief Lets the device be managed by a device manager, used by DeviceManager::addDevice()
+     * Advertisements are then received through the manager and the radio is taken from the manager for every command
+     *
+     * @param deviceManager the device manager
+     */
+    void registerDeviceManager(DeviceManager* deviceManager);
+
+    #ifdef NUKI_INSTRUMENTATION
+    /**
+     * @brief Returns the timing of the protocol phases of the executed commands (only with NUKI_INSTRUMENTATION defined)
+     */
+    Nuki::Instrumentation& getInstrumentation();
+    #endif
+
     /**
     * @brief Returns the RSSI of the last received ble beacon broadcast
     *
@@ -280,12 +433,66 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
     */
     uint32_t getLastHeartbeat();
 
+    /**
+     * @brief Queues a command to be executed by the NukiBle worker task and returns immediately.
+     * The worker task is started on first use and executes the queued commands one by one.
+     * On destruction the command being executed is finished and the commands still queued are dropped.
+     * Any blocking command can be made non-blocking this way, e.g.
+     * `nukiLock.executeAsync([]() { return nukiLock.requestReboot(); }, callback);`
+     *
+     * @param command the blocking command to execute
+     * @param callback optional, called from the worker task when the command has finished
+     * @param priority high priority commands are executed before any queued low priority command
+     * @return handle identifying the queued command, 0 if the command could not be queued
+     */
+    uint32_t executeAsync(std::function<Nuki::CmdResult()> command, Nuki::AsyncCmdCallback callback = nullptr,
+                          const Nuki::CommandPriority priority = Nuki::CommandPriority::Low);
+
+    /**
+     * @brief Returns the number of async commands waiting to be executed by the worker task
+     */
+    uint8_t getPendingAsyncCommands();
+
+    /**
+     * @brief Non-blocking version of retrieveKeypadEntries()
+     *
+     * @param offset The start offset to be read.
+     * @param count The number of entries to be read, starting at the specified offset.
+     * @param callback called from the worker task with the retrieved keypad entries
+     * @return handle identifying the queued command, 0 if the command could not be queued
+     */
+    uint32_t retrieveKeypadEntriesAsync(const uint16_t offset, const uint16_t count,
+                                        Nuki::AsyncPayloadCallback<Nuki::KeypadEntryBuffer> callback);
+
+    /**
+     * @brief Returns the number of commands waiting for their turn to communicate with the device
+     * (blocking commands from all tasks, including the async worker task)
+     */
+    uint8_t getCommandQueueDepth();
+
+    /**
+     * @brief Returns the depth, wait times and rejects of a command queue lane.
+     * Lock and keypad actions are executed in the high priority lane, all other commands in the low priority lane.
+     *
+     * @param priority the lane
+     */
+    Nuki::CommandQueueLaneStats getCommandQueueStats(const Nuki::CommandPriority priority);
+
   protected:
     bool connectBle(const BLEAddress bleAddress);
     void extendDisonnectTimeout();
+    void trackCommandStart();
+    uint32_t getIdleDisconnectTimeout() const;
+
+    /**
+     * @brief Executes action on the device. When listRequest is given the command only completes after the
+     * requested entries are received, the whole list is received within the command's turn.
+     */
+    template <typename TDeviceAction>
+    Nuki::CmdResult executeAction(const TDeviceAction action, const Nuki::ListRequest listRequest = {});
 
     template <typename TDeviceAction>
-    Nuki::CmdResult executeAction(const TDeviceAction action);
+    Nuki::CmdResult stepStateMachine(const TDeviceAction action);
 
     template <typename TDeviceAction>
     Nuki::CmdResult cmdStateMachine(const TDeviceAction action);
@@ -296,21 +503,99 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
     template <typename TDeviceAction>
     Nuki::CmdResult cmdChallAccStateMachine(const TDeviceAction action);
 
+    /**
+     * @brief Blocks until a message from the lock has been handled by notifyCallback() or the timeout expires
+     *
+     * @param timeoutMs max time to wait
+     * @return true if a message has been received
+     */
+    bool waitForMessage(const uint32_t timeoutMs);
+
+    /**
+     * @brief Returns true if the running command state machine can only advance after a reply of the lock
+     */
+    bool isAwaitingMessage() const;
+
   protected:
     virtual void handleReturnMessage(Command returnCode, unsigned char* data, uint16_t dataLen);
     virtual void logErrorCode(uint8_t errorCode) = 0;
+    /**
+     * @brief Called by deleteCredentials() to forget the data of the device type that belongs to the unpaired device
+     */
+    virtual void onCredentialsDeleted() {};
+
+    /**
+     * @brief Reads a value from the preferences of the device, guarded by the Nuki semaphore
+     *
+     * @param key preferences key
+     * @param defaultValue stored in value when the key does not exist
+     * @param value receives the stored value
+     * @return false if the semaphore could not be taken, value is not changed then
+     */
+    bool getStoredUInt(const char* key, const uint32_t defaultValue, uint32_t* value);
+
+    /**
+     * @brief Writes a value to the preferences of the device, guarded by the Nuki semaphore
+     */
+    bool storeUInt(const char* key, const uint32_t value);
+
+    /**
+     * @brief Removes a value from the preferences of the device, guarded by the Nuki semaphore
+     *
+     * @return false if the semaphore could not be taken
+     */
+    bool removeStoredValue(const char* key);
+
     uint8_t errorCode;
     Command lastMsgCodeReceived = Command::Empty;
+    Preferences preferences;
+    uint32_t runningAsyncHandle = 0;  //handle of the async command being executed by the worker task
 
   private:
+    friend class DeviceManager;
+    template <typename TLogEntry> friend class LogSync;
+
     SemaphoreHandle_t nukiBleSemaphore = xSemaphoreCreateMutex();
+    EventGroupHandle_t nukiBleEvents = xEventGroupCreate();
     bool takeNukiBleSemaphore(std::string taker);
+    Nuki::CommandQueue commandQueue;
+    TaskHandle_t bulkTask = nullptr;
+    Nuki::CommandPriority bulkPriority = Nuki::CommandPriority::Low;
+    bool enterCommand(const Nuki::CommandPriority priority);
+    void leaveCommand();
+    bool isBulkTask();
+    bool beginBulk(const Nuki::CommandPriority priority);
+    void endBulk();
+    bool yieldBulk();
+    Nuki::CmdResult executeBulkOperation(const Nuki::BulkOperation& operation);
+
+    struct AsyncCommand {
+      uint32_t handle;
+      Nuki::CommandPriority priority;
+      std::function<Nuki::CmdResult()> command;
+      Nuki::AsyncCmdCallback callback;
+    };
+    std::deque<AsyncCommand> asyncCommands;
+    SemaphoreHandle_t asyncQueueSemaphore = xSemaphoreCreateMutex();
+    SemaphoreHandle_t asyncCommandsAvailable = xSemaphoreCreateCounting(NUKI_ASYNC_QUEUE_SIZE, 0);
+    TaskHandle_t asyncTaskHandle = nullptr;
+    SemaphoreHandle_t asyncTaskStopped = xSemaphoreCreateBinary();
+    volatile bool asyncTaskStopping = false;
+    uint32_t nextAsyncHandle = 1;
+    static void asyncTask(void* pvParameters);
+    void runNextAsyncCommand();
     std::string owner = "free";
     void giveNukiBleSemaphore();
 
     bool connecting = false;
     uint32_t lastStartTimeout = 0;
     uint16_t timeoutDuration = 1000;
+    bool adaptiveDisconnect = true;
+    uint32_t lastCommandStart = 0;
+    uint32_t avgCommandGap = 0;
+    uint32_t avgConnectDuration = 0;
+    uint32_t connectionHits = 0;
+    uint32_t connectionMisses = 0;
     uint8_t connectTimeoutSec = 1;
     uint8_t connectRetries = 5;
 
@@ -319,11 +604,33 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
     void onResult(BLEAdvertisedDevice* advertisedDevice) override;
     bool registerOnGdioChar();
     bool registerOnUsdioChar();
+    void invalidateGattCache();
 
     bool sendPlainMessage(Command commandIdentifier, const unsigned char* payload, const uint8_t payloadLen);
     bool sendEncryptedMessage(Command commandIdentifier, const unsigned char* payload, const uint8_t payloadLen);
+    void generateMessageNonce(unsigned char* nonce);
 
     void notifyCallback(BLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify);
+    void collectListFrame(Command returnCode, unsigned char* data, uint16_t dataLen);
+
+    /**
+     * @brief Starts collecting the frames of a list retrieval (log/keypad/authorization/time control entries),
+     * called by executeAction() before the request is sent.
+     */
+    void beginListRetrieval(const Nuki::ListRequest& listRequest);
+
+    /**
+     * @brief Blocks until the list retrieval started by beginListRetrieval() is complete: all expected entries or
+     * a trailing Status frame are received. Times out if no frame is received for GENERAL_TIMEOUT ms.
+     *
+     * @return Success, Failed if the device sent an error report or TimeOut
+     */
+    Nuki::CmdResult waitForListRetrieval();
+
+    /**
+     * @brief Stops collecting list frames
+     */
+    void endListRetrieval();
     void saveCredentials();
     bool retrieveCredentials();
     void deleteCredentials();
@@ -331,7 +638,6 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
     Nuki::PairingState nukiPairingResultState = Nuki::PairingState::InitPairing;
 
     unsigned char authenticator[32];
-    Preferences preferences;
 
     BLEAddress bleAddress = BLEAddress("");
     bool pairingServiceAvailable = false;
@@ -343,6 +649,7 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
     const NimBLEUUID pairingServiceUUID;
 //Keyturner Service
     const NimBLEUUID deviceServiceUUID;
+    uint8_t deviceServiceUuidBytes[16] = {0x00};
 //Keyturner pairing Data Input Output characteristic
     const NimBLEUUID gdioUUID;
 //User-Specific Data Input Output characteristic
@@ -354,6 +661,8 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
     BLERemoteCharacteristic* pGdioCharacteristic = nullptr;
     BLERemoteService* pKeyturnerDataService = nullptr;
     BLERemoteCharacteristic* pUsdioCharacteristic = nullptr;
+    bool gattCached = false;
+    BLEAddress cachedGattAddress = BLEAddress("");
 
     Nuki::CommandState nukiCommandState = Nuki::CommandState::Idle;
 
@@ -361,9 +670,16 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
     uint32_t lastHeartbeat = 0;
 
     BleScanner::Publisher* bleScanner = nullptr;
+    DeviceManager* deviceManager = nullptr;
+
+    #ifdef NUKI_INSTRUMENTATION
+    Nuki::Instrumentation instrumentation;
+    Command instrumentedCommand = Command::Empty;
+    #endif
     bool isPaired = false;
 
     Nuki::SmartlockEventHandler* eventHandler;
+    Nuki::EntrySink* entrySink = nullptr;
 
     uint8_t receivedStatus;
     bool crcCheckOke;
@@ -374,19 +690,44 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
     unsigned char myPublicKey[32] = {0x00};
     unsigned char myPrivateKey[32] = {0x00};
     uint16_t pinCode = 0000;
+    bool credentialsCached = false;
     unsigned char secretKeyK[32] = {0x00};
+    CryptoContext crypto;
 
     unsigned char sentNonce[crypto_secretbox_NONCEBYTES] = {};
+    uint64_t nonceCounter = 0;
+    uint64_t nonceCounterReserved = 0;
+    bool nonceCounterLoaded = false;
+    unsigned char sendFrame[MAX_FRAME_SIZE];
+    unsigned char receivedPlainData[MAX_FRAME_SIZE];
 
     uint16_t nrOfKeypadCodes = 0;
-    uint8_t nrOfReceivedKeypadCodes = 0;
+    uint16_t nrOfReceivedKeypadCodes = 0;
     bool keypadCodeCountReceived = false;
+    uint16_t lastKeypadCodeId = 0;
+
+    std::map<uint16_t, KeypadEntry> keypadMirror;
+    bool keypadMirrorLoaded = false;
+    bool keypadMirrorStale = false;
+    void loadKeypadMirror();
+    void saveKeypadMirror();
+    void createUpdatedKeypadEntry(const KeypadEntry& entry, UpdatedKeypadEntry* updatedEntry);
+    bool isSameKeypadEntry(const KeypadEntry& entry, const UpdatedKeypadEntry& updatedEntry);
     uint16_t logEntryCount = 0;
+
+    Command listEntryCommand = Command::Empty;
+    uint16_t listOffset = 0;
+    uint16_t listExpectedCount = 0;
+    uint16_t listReceivedCount = 0;
+    bool listComplete = false;
+    bool listEndsWithStatus = false;
+    bool listFailed = false;
+    uint32_t lastListFrame = 0;
     bool loggingEnabled = false;
     int rssi = 0;
     unsigned long lastReceivedBeaconTs = 0;
-    std::list<KeypadEntry> listOfKeyPadEntries;
-    std::list<AuthorizationEntry> listOfAuthorizationEntries;
+    Nuki::KeypadEntryBuffer keypadEntryBuffer;
+    Nuki::AuthorizationEntryBuffer authorizationEntryBuffer;
     AuthorizationIdType authorizationIdType = AuthorizationIdType::Bridge;
 
 };
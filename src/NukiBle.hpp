@@ -3,7 +3,7 @@
 
 namespace Nuki {
 template<typename TDeviceAction>
-Nuki::CmdResult NukiBle::executeAction(const TDeviceAction action) {
+Nuki::CmdResult NukiBle::executeAction(const TDeviceAction action, const Nuki::ListRequest listRequest) {
   if (millis() - lastHeartbeat > HEARTBEAT_TIMEOUT) {
     log_e("Lock Heartbeat timeout, command failed");
     return Nuki::CmdResult::Error;
@@ -23,62 +23,68 @@ Nuki::CmdResult NukiBle::executeAction(const TDeviceAction action) {
     return Nuki::CmdResult::NotPaired;
   }
 
+  //lock actions are let in before queued background commands
+  if (!enterCommand(getCommandPriority(action.command))) {
+    log_w("Command %02x not executed, queue timeout, queue full or radio busy", action.command);
+    return Nuki::CmdResult::Failed;
+  }
+  trackCommandStart();
+  NUKI_TRACE_START(action.command);
+
   if (takeNukiBleSemaphore("exec Action")) {
     #ifdef DEBUG_NUKI_COMMUNICATION
     log_d("Start executing: %02x ", action.command);
     #endif
-    if (action.cmdType == Nuki::CommandType::Command) {
-      while (1) {
-        Nuki::CmdResult result = cmdStateMachine(action);
-        if (result != Nuki::CmdResult::Working) {
-          giveNukiBleSemaphore();
-          extendDisonnectTimeout();
-          return result;
-        }
-        esp_task_wdt_reset();
-        delay(10);
-      }
-    } else if (action.cmdType == Nuki::CommandType::CommandWithChallenge) {
-      while (1) {
-        Nuki::CmdResult result = cmdChallStateMachine(action);
-        if (result != Nuki::CmdResult::Working) {
-          giveNukiBleSemaphore();
-          extendDisonnectTimeout();
-          return result;
-        }
-        esp_task_wdt_reset();
-        delay(10);
-      }
-    } else if (action.cmdType == Nuki::CommandType::CommandWithChallengeAndAccept) {
-      while (1) {
-        Nuki::CmdResult result = cmdChallAccStateMachine(action);
-        if (result != Nuki::CmdResult::Working) {
-          giveNukiBleSemaphore();
-          extendDisonnectTimeout();
-          return result;
+    //drop notifications of messages that arrived before this command
+    xEventGroupClearBits(nukiBleEvents, NUKI_EVENT_MESSAGE_RECEIVED);
+    bool listRetrieval = listRequest.entryCommand != Command::Empty;
+    if (listRetrieval) {
+      beginListRetrieval(listRequest);
+    }
+    while (1) {
+      Nuki::CmdResult result = stepStateMachine(action);
+      if (result != Nuki::CmdResult::Working) {
+        //the list is received before the turn is given to the next command, so no other reply is mixed into it
+        if (listRetrieval && result == Nuki::CmdResult::Success) {
+          result = waitForListRetrieval();
+        } else if (listRetrieval) {
+          endListRetrieval();
         }
-        esp_task_wdt_reset();
-        delay(10);
+        NUKI_TRACE_END(result);
+        giveNukiBleSemaphore();
+        leaveCommand();
+        extendDisonnectTimeout();
+        return result;
       }
-    } else if (action.cmdType == Nuki::CommandType::CommandWithChallengeAndPin) {
-      while (1) {
-        Nuki::CmdResult result = cmdChallStateMachine(action, true);
-        if (result != Nuki::CmdResult::Working) {
-          giveNukiBleSemaphore();
-          extendDisonnectTimeout();
-          return result;
-        }
-        esp_task_wdt_reset();
-        delay(10);
+      esp_task_wdt_reset();
+      if (isAwaitingMessage()) {
+        //woken up by notifyCallback as soon as the lock replies
+        waitForMessage(RESPONSE_WAIT_SLICE);
       }
-    } else {
-      log_w("Unknown cmd type");
     }
-    giveNukiBleSemaphore();
   }
+  NUKI_TRACE_END(Nuki::CmdResult::Failed);
+  leaveCommand();
   return Nuki::CmdResult::Failed;
 }
 
+template <typename TDeviceAction>
+Nuki::CmdResult NukiBle::stepStateMachine(const TDeviceAction action) {
+  switch (action.cmdType) {
+    case Nuki::CommandType::Command:
+      return cmdStateMachine(action);
+    case Nuki::CommandType::CommandWithChallenge:
+      return cmdChallStateMachine(action);
+    case Nuki::CommandType::CommandWithChallengeAndAccept:
+      return cmdChallAccStateMachine(action);
+    case Nuki::CommandType::CommandWithChallengeAndPin:
+      return cmdChallStateMachine(action, true);
+    default:
+      log_w("Unknown cmd type");
+      return Nuki::CmdResult::Failed;
+  }
+}
+
 template <typename TDeviceAction>
 Nuki::CmdResult NukiBle::cmdStateMachine(const TDeviceAction action) {
   switch (nukiCommandState) {
@@ -89,6 +95,7 @@ Nuki::CmdResult NukiBle::cmdStateMachine(const TDeviceAction action) {
       lastMsgCodeReceived = Command::Empty;
 
       if (sendEncryptedMessage(Command::RequestData, action.payload, action.payloadLen)) {
+        NUKI_TRACE(CommandSent);
         timeNow = millis();
         nukiCommandState = CommandState::CmdSent;
       } else {
@@ -150,6 +157,7 @@ Nuki::CmdResult NukiBle::cmdChallStateMachine(const TDeviceAction action, const
       unsigned char payload[sizeof(Command)] = {0x04, 0x00};  //challenge
 
       if (sendEncryptedMessage(Command::RequestData, payload, sizeof(Command))) {
+        NUKI_TRACE(ChallengeSent);
         timeNow = millis();
         nukiCommandState = CommandState::ChallengeSent;
       } else {
@@ -171,6 +179,7 @@ Nuki::CmdResult NukiBle::cmdChallStateMachine(const TDeviceAction action, const
         nukiCommandState = CommandState::Idle;
         return Nuki::CmdResult::TimeOut;
       } else if (lastMsgCodeReceived == Command::Challenge) {
+        NUKI_TRACE(ChallengeReceived);
         nukiCommandState = CommandState::ChallengeRespReceived;
         lastMsgCodeReceived = Command::Empty;
       }
@@ -195,6 +204,7 @@ Nuki::CmdResult NukiBle::cmdChallStateMachine(const TDeviceAction action, const
       }
 
       if (sendEncryptedMessage(action.command, payload, payloadLen)) {
+        NUKI_TRACE(CommandSent);
         timeNow = millis();
         nukiCommandState = CommandState::CmdSent;
       } else {
@@ -257,6 +267,7 @@ Nuki::CmdResult NukiBle::cmdChallAccStateMachine(const TDeviceAction action) {
       unsigned char payload[sizeof(Command)] = {0x04, 0x00};  //challenge
 
       if (sendEncryptedMessage(Command::RequestData, payload, sizeof(Command))) {
+        NUKI_TRACE(ChallengeSent);
         timeNow = millis();
         nukiCommandState = CommandState::ChallengeSent;
       } else {
@@ -278,6 +289,7 @@ Nuki::CmdResult NukiBle::cmdChallAccStateMachine(const TDeviceAction action) {
         nukiCommandState = CommandState::Idle;
         return Nuki::CmdResult::TimeOut;
       } else if (lastMsgCodeReceived == Command::Challenge) {
+        NUKI_TRACE(ChallengeReceived);
         nukiCommandState = CommandState::ChallengeRespReceived;
         lastMsgCodeReceived = Command::Empty;
       }
@@ -295,6 +307,7 @@ Nuki::CmdResult NukiBle::cmdChallAccStateMachine(const TDeviceAction action) {
       memcpy(&payload[action.payloadLen], challengeNonceK, sizeof(challengeNonceK));
 
       if (sendEncryptedMessage(action.command, payload, action.payloadLen + sizeof(challengeNonceK))) {
+        NUKI_TRACE(CommandSent);
         timeNow = millis();
         nukiCommandState = CommandState::CmdSent;
       } else {
@@ -316,6 +329,7 @@ Nuki::CmdResult NukiBle::cmdChallAccStateMachine(const TDeviceAction action) {
         nukiCommandState = CommandState::Idle;
         return Nuki::CmdResult::TimeOut;
       } else if (lastMsgCodeReceived == Command::Status && (CommandStatus)receivedStatus == CommandStatus::Accepted) {
+        NUKI_TRACE(AcceptReceived);
         timeNow = millis();
         nukiCommandState = CommandState::CmdAccepted;
         lastMsgCodeReceived = Command::Empty;
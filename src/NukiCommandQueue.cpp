@@ -0,0 +1,130 @@
+#include "NukiCommandQueue.h"
+
+namespace Nuki {
+
+CommandPriority getCommandPriority(const Command command) {
+  switch (command) {
+    case Command::LockAction:
+    case Command::KeypadAction:
+    case Command::SimpleLockAction:
+    case Command::ContinuousModeAction:
+      return CommandPriority::High;
+    default:
+      return CommandPriority::Low;
+  }
+}
+
+CommandQueue::CommandQueue() {}
+
+CommandQueue::~CommandQueue() {
+  vSemaphoreDelete(queueSemaphore);
+}
+
+bool CommandQueue::enter(const CommandPriority priority, const uint32_t timeout) {
+  if (xSemaphoreTake(queueSemaphore, portMAX_DELAY) != pdTRUE) {
+    return false;
+  }
+
+  CommandQueueLaneStats& stats = laneStats(priority);
+  if (!busy && highLane.empty() && lowLane.empty()) {
+    busy = true;
+    stats.lastWaitMs = 0;
+    xSemaphoreGive(queueSemaphore);
+    return true;
+  }
+
+  std::deque<Waiter*>& waiters = lane(priority);
+  if (waiters.size() >= CMD_QUEUE_LANE_SIZE) {
+    stats.rejected++;
+    xSemaphoreGive(queueSemaphore);
+    log_w("Command queue lane %d full, command rejected", (int)priority);
+    return false;
+  }
+
+  Waiter waiter = {xSemaphoreCreateBinary(), false};
+  if (waiter.turn == nullptr) {
+    xSemaphoreGive(queueSemaphore);
+    log_e("Unable to create command queue waiter");
+    return false;
+  }
+  waiters.push_back(&waiter);
+  stats.enqueued++;
+  stats.depth = waiters.size();
+  xSemaphoreGive(queueSemaphore);
+
+  uint32_t startTime = millis();
+  bool gotTurn = xSemaphoreTake(waiter.turn, timeout / portTICK_PERIOD_MS) == pdTRUE;
+  uint32_t waited = millis() - startTime;
+
+  xSemaphoreTake(queueSemaphore, portMAX_DELAY);
+  if (!gotTurn && waiter.granted) {
+    //turn was handed over right after the timeout expired
+    xSemaphoreTake(waiter.turn, 0);
+    gotTurn = true;
+  }
+  if (gotTurn) {
+    stats.lastWaitMs = waited;
+    stats.totalWaitMs += waited;
+    if (waited > stats.maxWaitMs) {
+      stats.maxWaitMs = waited;
+    }
+  } else {
+    removeWaiter(waiters, &waiter);
+    stats.depth = waiters.size();
+    stats.timedOut++;
+    log_w("Command queue lane %d timeout after %d ms", (int)priority, waited);
+  }
+  xSemaphoreGive(queueSemaphore);
+
+  vSemaphoreDelete(waiter.turn);
+  return gotTurn;
+}
+
+void CommandQueue::leave() {
+  xSemaphoreTake(queueSemaphore, portMAX_DELAY);
+  std::deque<Waiter*>& waiters = !highLane.empty() ? highLane : lowLane;
+  if (waiters.empty()) {
+    busy = false;
+  } else {
+    //hand over the turn directly so nobody can get in between
+    Waiter* next = waiters.front();
+    waiters.pop_front();
+    (&waiters == &highLane ? highStats : lowStats).depth = waiters.size();
+    next->granted = true;
+    xSemaphoreGive(next->turn);
+  }
+  xSemaphoreGive(queueSemaphore);
+}
+
+uint8_t CommandQueue::getDepth() {
+  xSemaphoreTake(queueSemaphore, portMAX_DELAY);
+  uint8_t depth = highLane.size() + lowLane.size();
+  xSemaphoreGive(queueSemaphore);
+  return depth;
+}
+
+CommandQueueLaneStats CommandQueue::getStats(const CommandPriority priority) {
+  xSemaphoreTake(queueSemaphore, portMAX_DELAY);
+  CommandQueueLaneStats stats = laneStats(priority);
+  xSemaphoreGive(queueSemaphore);
+  return stats;
+}
+
+std::deque<CommandQueue::Waiter*>& CommandQueue::lane(const CommandPriority priority) {
+  return priority == CommandPriority::High ? highLane : lowLane;
+}
+
+CommandQueueLaneStats& CommandQueue::laneStats(const CommandPriority priority) {
+  return priority == CommandPriority::High ? highStats : lowStats;
+}
+
+void CommandQueue::removeWaiter(std::deque<Waiter*>& waiters, Waiter* waiter) {
+  for (auto it = waiters.begin(); it != waiters.end(); it++) {
+    if (*it == waiter) {
+      waiters.erase(it);
+      return;
+    }
+  }
+}
+
+} // namespace Nuki
@@ -0,0 +1,94 @@
+#pragma once
+
+/**
+ * @file NukiCommandQueue.h
+ * Bounded command queue with priority lanes, placed in front of the BLE communication with a Nuki device
+ *
+ * Created on: 2022
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * This library implements the communication from an ESP32 via BLE to a Nuki smart lock.
+ * Based on the Nuki Smart Lock API V2.2.1
+ * https://developer.nuki.io/page/nuki-smart-lock-api-2/2/
+ *
+ */
+
+#include "Arduino.h"
+#include "NukiConstants.h"
+#include <deque>
+
+#define CMD_QUEUE_LANE_SIZE 8
+#define CMD_QUEUE_TIMEOUT 30000
+
+namespace Nuki {
+
+enum class CommandPriority : uint8_t {
+  High  = 0,  // user facing actions (lock/keypad actions)
+  Low   = 1   // background work (state/config reads, log/keypad/auth retrieval, ...)
+};
+
+struct CommandQueueLaneStats {
+  uint8_t depth;          // commands currently waiting in this lane
+  uint32_t enqueued;      // commands that had to wait in this lane
+  uint32_t rejected;      // commands rejected because the lane was full
+  uint32_t timedOut;      // commands that gave up waiting
+  uint32_t lastWaitMs;
+  uint32_t maxWaitMs;
+  uint32_t totalWaitMs;
+};
+
+/**
+ * @brief Returns the queue lane a command is executed in
+ */
+CommandPriority getCommandPriority(const Command command);
+
+class CommandQueue {
+  public:
+    CommandQueue();
+    ~CommandQueue();
+
+    /**
+     * @brief Waits until it is the callers turn to communicate with the device.
+     * Waiting high priority commands are always let in before waiting low priority commands,
+     * within a lane the commands are let in in order of arrival.
+     *
+     * @param priority lane to wait in
+     * @param timeout max time in ms to wait for the turn
+     * @return true if it is the callers turn, leave() must then be called when done
+     */
+    bool enter(const CommandPriority priority, const uint32_t timeout = CMD_QUEUE_TIMEOUT);
+
+    /**
+     * @brief Ends the turn of the caller and lets in the next waiting command (if any)
+     */
+    void leave();
+
+    /**
+     * @brief Returns the total number of commands waiting in all lanes
+     */
+    uint8_t getDepth();
+
+    /**
+     * @brief Returns the statistics of the given lane
+     */
+    CommandQueueLaneStats getStats(const CommandPriority priority);
+
+  private:
+    struct Waiter {
+      SemaphoreHandle_t turn;
+      bool granted;
+    };
+
+    std::deque<Waiter*>& lane(const CommandPriority priority);
+    CommandQueueLaneStats& laneStats(const CommandPriority priority);
+    void removeWaiter(std::deque<Waiter*>& waiters, Waiter* waiter);
+
+    SemaphoreHandle_t queueSemaphore = xSemaphoreCreateMutex();
+    std::deque<Waiter*> highLane;
+    std::deque<Waiter*> lowLane;
+    CommandQueueLaneStats highStats = {};
+    CommandQueueLaneStats lowStats = {};
+    bool busy = false;
+};
+
+} // namespace Nuki
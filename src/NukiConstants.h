@@ -20,6 +20,9 @@ const char BLE_ADDRESS_STORE_NAME[]       = "bleAddress";
 const char SECURITY_PINCODE_STORE_NAME[]  = "securityPinCode";
 const char SECRET_KEY_STORE_NAME[]        = "secretKeyK";
 const char AUTH_ID_STORE_NAME[]           = "authorizationId";
+const char LOG_SYNC_INDEX_STORE_NAME[]    = "logSyncIndex";
+const char NONCE_COUNTER_STORE_NAME[]     = "nonceCounter";
+const char KEYPAD_MIRROR_STORE_NAME[]     = "keypadMirror";
 
 enum class DoorSensorState : uint8_t {
   Unavailable       = 0x00,
@@ -0,0 +1,70 @@
+#include "NukiCrc.h"
+
+#if defined(ESP_PLATFORM) && !defined(NUKI_CRC_TABLE)
+#include "esp_rom_crc.h"
+#define NUKI_CRC_ROM
+#endif
+
+namespace Nuki {
+
+namespace {
+
+struct CrcTables {
+  // table[k][i] is the crc contribution of byte i followed by k zero bytes
+  uint16_t table[4][256];
+
+  CrcTables() {
+    for (uint16_t i = 0; i < 256; i++) {
+      uint16_t crc = i << 8;
+      for (uint8_t bit = 0; bit < 8; bit++) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+      }
+      table[0][i] = crc;
+    }
+    for (uint16_t i = 0; i < 256; i++) {
+      for (uint8_t k = 1; k < 4; k++) {
+        table[k][i] = (table[k - 1][i] << 8) ^ table[0][table[k - 1][i] >> 8];
+      }
+    }
+  }
+};
+
+const CrcTables& crcTables() {
+  static const CrcTables tables;
+  return tables;
+}
+
+} // namespace
+
+uint16_t crc16CcittFalseTable(const uint8_t* data, const size_t length, const uint16_t crc) {
+  const uint16_t (*table)[256] = crcTables().table;
+  uint16_t result = crc;
+  size_t remaining = length;
+
+  while (remaining >= 4) {
+    result = table[3][data[0] ^ (result >> 8)] ^ table[2][data[1] ^ (result & 0xff)] ^ table[1][data[2]] ^ table[0][data[3]];
+    data += 4;
+    remaining -= 4;
+  }
+  while (remaining--) {
+    result = (result << 8) ^ table[0][*data++ ^ (result >> 8)];
+  }
+  return result;
+}
+
+uint16_t crc16CcittFalse(const uint8_t* data, const size_t length, const uint16_t crc) {
+  #ifdef NUKI_CRC_ROM
+  // the rom routine inverts the crc on entry and exit, CCITT-FALSE has no inversion
+  return (uint16_t)~esp_rom_crc16_be((uint16_t)~crc, data, length);
+  #else
+  return crc16CcittFalseTable(data, length, crc);
+  #endif
+}
+
+bool crc16SelfTest() {
+  const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  return crc16CcittFalse(check, sizeof(check)) == CRC16_CCITT_FALSE_CHECK
+         && crc16CcittFalseTable(check, sizeof(check)) == CRC16_CCITT_FALSE_CHECK;
+}
+
+} // namespace Nuki
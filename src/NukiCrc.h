@@ -0,0 +1,50 @@
+#pragma once
+
+/**
+ * @file NukiCrc.h
+ * CRC-16/CCITT-FALSE as used in every message exchanged with a Nuki device
+ * width=16 poly=0x1021 init=0xffff refin=false refout=false xorout=0x0000 check=0x29b1
+ *
+ * On the ESP32 the CRC routine in ROM is used, define NUKI_CRC_TABLE to use the portable
+ * slice-by-4 table implementation instead (also used on other platforms)
+ *
+ * Created on: 2022
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * This library implements the communication from an ESP32 via BLE to a Nuki smart lock.
+ * Based on the Nuki Smart Lock API V2.2.1
+ * https://developer.nuki.io/page/nuki-smart-lock-api-2/2/
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CRC16_CCITT_FALSE_INIT 0xffff
+#define CRC16_CCITT_FALSE_CHECK 0x29b1  //crc of the ascii string "123456789"
+
+namespace Nuki {
+
+/**
+ * @brief Calculates the CRC-16/CCITT-FALSE of data, can be continued over multiple buffers
+ * by passing the result of the previous call as crc
+ *
+ * @param data data to calculate the crc of
+ * @param length length of data
+ * @param crc crc of the preceding data, CRC16_CCITT_FALSE_INIT for the first buffer
+ */
+uint16_t crc16CcittFalse(const uint8_t* data, const size_t length, const uint16_t crc = CRC16_CCITT_FALSE_INIT);
+
+/**
+ * @brief Portable slice-by-4 table implementation of crc16CcittFalse, available on all platforms
+ */
+uint16_t crc16CcittFalseTable(const uint8_t* data, const size_t length, const uint16_t crc = CRC16_CCITT_FALSE_INIT);
+
+/**
+ * @brief Checks the crc implementation against the check value of the algorithm
+ *
+ * @return true if the crc of "123456789" equals CRC16_CCITT_FALSE_CHECK
+ */
+bool crc16SelfTest();
+
+} // namespace Nuki
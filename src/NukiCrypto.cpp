@@ -0,0 +1,53 @@
+#include "NukiCrypto.h"
+#include "Arduino.h"
+#include "sodium/utils.h"
+
+namespace Nuki {
+
+CryptoContext::CryptoContext() {
+  sodium_memzero(key, sizeof(key));
+}
+
+CryptoContext::~CryptoContext() {
+  clear();
+}
+
+void CryptoContext::setKey(const unsigned char* newKey) {
+  memcpy(key, newKey, sizeof(key));
+  keySet = true;
+}
+
+void CryptoContext::clear() {
+  sodium_memzero(key, sizeof(key));
+  keySet = false;
+}
+
+bool CryptoContext::hasKey() const {
+  return keySet;
+}
+
+bool CryptoContext::encrypt(unsigned char* cipherData, unsigned char* mac, const unsigned char* plainData, const uint16_t len,
+                            const unsigned char* nonce) const {
+  if (!keySet) {
+    log_w("Encryption failed, no key set");
+    return false;
+  }
+  if (crypto_secretbox_detached(cipherData, mac, plainData, len, nonce, key) != 0) {
+    log_w("Encryption failed (length %i)", len);
+    return false;
+  }
+  return true;
+}
+
+bool CryptoContext::decrypt(unsigned char* plainData, const unsigned char* cipherData, const unsigned char* mac, const uint16_t len,
+                            const unsigned char* nonce) const {
+  if (!keySet) {
+    log_w("Decryption failed, no key set");
+    return false;
+  }
+  //the tag is verified over the cipher text before anything is decrypted or written to plainData,
+  //not logged here as forged or corrupted messages are reported by the caller
+  return crypto_secretbox_open_detached(plainData, cipherData, mac, len, nonce, key) == 0;
+}
+
+} // namespace Nuki
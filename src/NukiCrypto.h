@@ -0,0 +1,75 @@
+#pragma once
+
+/**
+ * @file NukiCrypto.h
+ * Holds the shared secret key of a paired Nuki device and encrypts/decrypts messages with it
+ * (crypto_secretbox, XSalsa20-Poly1305)
+ *
+ * Created on: 2022
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * This library implements the communication from an ESP32 via BLE to a Nuki smart lock.
+ * Based on the Nuki Smart Lock API V2.2.1
+ * https://developer.nuki.io/page/nuki-smart-lock-api-2/2/
+ *
+ */
+
+#include <stdint.h>
+#include "sodium/crypto_secretbox.h"
+
+namespace Nuki {
+
+class CryptoContext {
+  public:
+    CryptoContext();
+    ~CryptoContext();
+
+    CryptoContext(const CryptoContext&) = delete;
+    CryptoContext& operator=(const CryptoContext&) = delete;
+
+    /**
+     * @brief Copies the shared secret key (crypto_secretbox_KEYBYTES) into the context
+     */
+    void setKey(const unsigned char* key);
+
+    /**
+     * @brief Wipes the key, encrypt() and decrypt() fail until a new key is set
+     */
+    void clear();
+
+    bool hasKey() const;
+
+    /**
+     * @brief Encrypts plainData, the cipher text and the authentication tag are written to separate buffers.
+     * cipherData may be the same buffer as plainData (encryption in place)
+     *
+     * @param cipherData buffer of len bytes the cipher text is written to
+     * @param mac buffer of crypto_secretbox_MACBYTES the tag is written to
+     * @param plainData data to encrypt
+     * @param len length of plainData
+     * @param nonce nonce to encrypt with (crypto_secretbox_NONCEBYTES)
+     * @return true if encrypted
+     */
+    bool encrypt(unsigned char* cipherData, unsigned char* mac, const unsigned char* plainData, const uint16_t len,
+                 const unsigned char* nonce) const;
+
+    /**
+     * @brief Verifies the authentication tag and only then decrypts cipherData, plainData is left untouched
+     * when the tag is wrong. plainData may be the same buffer as cipherData (decryption in place)
+     *
+     * @param plainData buffer of len bytes the plain data is written to
+     * @param cipherData data to decrypt
+     * @param mac received tag (crypto_secretbox_MACBYTES)
+     * @param len length of cipherData
+     * @param nonce received nonce (crypto_secretbox_NONCEBYTES)
+     * @return true if the tag is valid and the data is decrypted
+     */
+    bool decrypt(unsigned char* plainData, const unsigned char* cipherData, const unsigned char* mac, const uint16_t len,
+                 const unsigned char* nonce) const;
+
+  private:
+    unsigned char key[crypto_secretbox_KEYBYTES];
+    bool keySet = false;
+};
+
+} // namespace Nuki
@@ -14,6 +14,7 @@
 
 #include "Arduino.h"
 #include "NukiConstants.h"
+#include <functional>
 
 namespace Nuki {
 
@@ -27,6 +28,18 @@ class SmartlockEventHandler {
     virtual void notify(EventType eventType) = 0;
 };
 
+/**
+ * @brief Receives keypad and authorization entries one by one while they are downloaded, e.g. to forward them to
+ * MQTT or flash. Also called for the downloads done by the library itself (e.g. syncKeypadMirror()).
+ * Called from the BLE receive task: return quickly and DO NOT execute any BLE actions from it
+ */
+class EntrySink {
+  public:
+    virtual ~EntrySink() {};
+    virtual void onKeypadEntry(const KeypadEntry& entry) {};
+    virtual void onAuthorizationEntry(const AuthorizationEntry& entry) {};
+};
+
 enum CmdResult : uint8_t {
   Success   = 1,
   Failed    = 2,
@@ -37,6 +50,82 @@ enum CmdResult : uint8_t {
   Error     = 99
 };
 
+struct ConnectionStats {
+  uint32_t hits;              // commands that found a live BLE connection
+  uint32_t misses;            // commands that had to (re)connect first
+  uint32_t avgCommandGapMs;   // learned average idle time between commands
+  uint32_t avgConnectMs;      // measured average duration of connect + subscribe
+  uint32_t idleTimeoutMs;     // idle time after which updateConnectionState() disconnects
+};
+
+/**
+ * @brief Called from the NukiBle worker task when an async command has finished
+ *
+ * @param handle the handle returned when the command was queued
+ * @param result the result of the command
+ */
+typedef std::function<void(uint32_t handle, CmdResult result)> AsyncCmdCallback;
+
+enum class KeypadOperation : uint8_t {
+  Add,
+  Update,
+  Remove
+};
+
+struct KeypadPlanEntry {
+  KeypadOperation operation;
+  UpdatedKeypadEntry entry;   // codeId is the id on the lock, 0 for Add
+};
+
+struct KeypadPlanResult {
+  KeypadOperation operation;
+  uint16_t codeId;            // for Add the id assigned by the lock, 0 if the lock did not report it
+  uint32_t code;
+  CmdResult result;
+};
+
+enum class BulkOperationType : uint8_t {
+  AddKeypadEntry,
+  UpdateKeypadEntry,
+  DeleteKeypadEntry,
+  AddAuthorizationEntry,
+  UpdateAuthorizationEntry
+};
+
+struct BulkOperation {
+  BulkOperationType type;
+  union {
+    NewKeypadEntry newKeypadEntry;
+    UpdatedKeypadEntry updatedKeypadEntry;
+    uint16_t keypadCodeId;                    // DeleteKeypadEntry
+    NewAuthorizationEntry newAuthorizationEntry;
+    UpdatedAuthorizationEntry updatedAuthorizationEntry;
+  };
+};
+
+enum class BulkErrorPolicy : uint8_t {
+  StopOnError,      // the operations after the first failed one are not executed
+  ContinueOnError
+};
+
+/**
+ * @brief List of entries sent by the device after a request command, e.g. the log entries after Request Log Entries
+ */
+struct ListRequest {
+  Command entryCommand = Command::Empty;  // command of the entry frames, e.g. Command::LogEntry
+  uint16_t count = 0;                     // number of requested entries, lowered when the device reports less
+  uint16_t offset = 0;                    // offset of the first requested entry, used together with the reported count
+  bool endsWithStatus = false;            // only the trailing status complete ends the list, for lists where the
+                                          // reported count does not tell how many entries follow (log entries)
+};
+
+/**
+ * @brief Called from the NukiBle worker task when an async command has finished, with the handle returned
+ * when the command was queued and the data retrieved from the lock (only valid if result is Success)
+ */
+template <typename TPayload>
+using AsyncPayloadCallback = std::function<void(uint32_t handle, CmdResult result, const TPayload& payload)>;
+
 enum class PairingResult : uint8_t {
   Pairing,
   Success,
@@ -0,0 +1,488 @@
+#include "NukiDeviceManager.h"
+#include "NukiBle.h"
+#include <memory>
+
+namespace Nuki {
+
+DeviceManager::DeviceManager() {}
+
+DeviceManager::~DeviceManager() {
+  if (bleScanner != nullptr) {
+    bleScanner->unsubscribe(this);
+    bleScanner = nullptr;
+  }
+  vSemaphoreDelete(managerSemaphore);
+  vSemaphoreDelete(dispatchSemaphore);
+  vSemaphoreDelete(radioSlots);
+  vSemaphoreDelete(connectSemaphore);
+}
+
+void DeviceManager::registerBleScanner(BleScanner::Publisher* bleScanner) {
+  this->bleScanner = bleScanner;
+  bleScanner->subscribe(this);
+}
+
+void DeviceManager::addDevice(NukiBle* device) {
+  xSemaphoreTake(managerSemaphore, portMAX_DELAY);
+  if (findDevice(device) == nullptr) {
+    devices.push_back({device, {}, false, 0, false, false});
+  }
+  xSemaphoreGive(managerSemaphore);
+  device->registerDeviceManager(this);
+  updateDeviceAddress(device);
+}
+
+void DeviceManager::removeDevice(NukiBle* device) {
+  unsubscribe(device);
+  if (device->deviceManager == this) {
+    device->deviceManager = nullptr;
+    device->bleScanner = nullptr;
+  }
+}
+
+void DeviceManager::updateDeviceAddress(const NukiBle* device) {
+  xSemaphoreTake(managerSemaphore, portMAX_DELAY);
+  removeDeviceAddress(device);
+  if (findDevice(device) != nullptr && device->isPaired) {
+    devicesByAddress[addressKey(device->bleAddress)] = const_cast<NukiBle*>(device);
+  }
+  xSemaphoreGive(managerSemaphore);
+}
+
+void DeviceManager::updateConnectionState() {
+  std::vector<NukiBle*> managedDevices;
+  xSemaphoreTake(managerSemaphore, portMAX_DELAY);
+  for (ManagedDevice& managedDevice : devices) {
+    managedDevices.push_back(managedDevice.device);
+  }
+  xSemaphoreGive(managerSemaphore);
+
+  for (NukiBle* device : managedDevices) {
+    device->updateConnectionState();
+  }
+}
+
+void DeviceManager::setConcurrentConnections(const uint8_t connections) {
+  uint8_t target = constrain(connections, 1, DEVICE_MANAGER_MAX_CONNECTIONS);
+  while (concurrentConnections < target) {
+    xSemaphoreGive(radioSlots);
+    concurrentConnections++;
+  }
+  while (concurrentConnections > target) {
+    //waits for a device to release its slot, idle connections are closed for it
+    if (takeRadioSlot(nullptr, RADIO_ACQUIRE_TIMEOUT)) {
+      concurrentConnections--;
+    }
+  }
+}
+
+uint8_t DeviceManager::connectAll() {
+  std::vector<NukiBle*> pairedDevices;
+  xSemaphoreTake(managerSemaphore, portMAX_DELAY);
+  for (ManagedDevice& managedDevice : devices) {
+    if (managedDevice.device->isPairedWithLock()) {
+      pairedDevices.push_back(managedDevice.device);
+    }
+  }
+  xSemaphoreGive(managerSemaphore);
+
+  uint8_t connected = 0;
+  for (NukiBle* device : pairedDevices) {
+    //takes the queue turn and the radio like any other command of the device
+    if (!device->enterCommand(CommandPriority::Low)) {
+      continue;
+    }
+    if (device->takeNukiBleSemaphore("connect all")) {
+      if (device->connectBle(device->bleAddress)) {
+        device->extendDisonnectTimeout();
+        connected++;
+      }
+      device->giveNukiBleSemaphore();
+    }
+    device->leaveCommand();
+  }
+  return connected;
+}
+
+std::vector<CmdResult> DeviceManager::executeOnAll(std::function<CmdResult(NukiBle*)> command, const uint32_t timeout) {
+  //shared with the callbacks, which may still come in after a timeout
+  struct Scene {
+    SemaphoreHandle_t done;
+    SemaphoreHandle_t resultSemaphore = xSemaphoreCreateMutex();
+    std::vector<CmdResult> results;
+    std::vector<uint32_t> latencies;
+    ~Scene() {
+      vSemaphoreDelete(done);
+      vSemaphoreDelete(resultSemaphore);
+    }
+  };
+
+  std::vector<NukiBle*> sceneDevices;
+  xSemaphoreTake(managerSemaphore, portMAX_DELAY);
+  for (ManagedDevice& managedDevice : devices) {
+    sceneDevices.push_back(managedDevice.device);
+  }
+  xSemaphoreGive(managerSemaphore);
+
+  std::shared_ptr<Scene> scene = std::make_shared<Scene>();
+  scene->done = xSemaphoreCreateCounting(sceneDevices.size() + 1, 0);
+  scene->results.assign(sceneDevices.size(), CmdResult::TimeOut);
+  scene->latencies.assign(sceneDevices.size(), 0);
+
+  uint32_t startTime = millis();
+  uint8_t dispatched = 0;
+  for (size_t i = 0; i < sceneDevices.size(); i++) {
+    NukiBle* device = sceneDevices[i];
+    if (!device->isPairedWithLock()) {
+      scene->results[i] = CmdResult::NotPaired;
+      continue;
+    }
+    //every device runs the command on its own worker task, so the exchanges with the devices overlap
+    uint32_t handle = device->executeAsync([device, command]() {
+      return command(device);
+    }, [scene, i, startTime](uint32_t handle, CmdResult result) {
+      xSemaphoreTake(scene->resultSemaphore, portMAX_DELAY);
+      scene->results[i] = result;
+      scene->latencies[i] = millis() - startTime;
+      xSemaphoreGive(scene->resultSemaphore);
+      xSemaphoreGive(scene->done);
+    }, CommandPriority::High);
+
+    if (handle == 0) {
+      scene->results[i] = CmdResult::Failed;
+    } else {
+      dispatched++;
+    }
+  }
+
+  uint8_t finished = 0;
+  while (finished < dispatched) {
+    uint32_t elapsed = millis() - startTime;
+    if (elapsed >= timeout || xSemaphoreTake(scene->done, (timeout - elapsed) / portTICK_PERIOD_MS) != pdTRUE) {
+      log_w("Scene timeout, %d of %d devices finished", finished, dispatched);
+      break;
+    }
+    finished++;
+  }
+  uint32_t duration = millis() - startTime;
+
+  xSemaphoreTake(scene->resultSemaphore, portMAX_DELAY);
+  std::vector<CmdResult> results = scene->results;
+  std::vector<uint32_t> latencies = scene->latencies;
+  xSemaphoreGive(scene->resultSemaphore);
+
+  xSemaphoreTake(managerSemaphore, portMAX_DELAY);
+  uint32_t sumLatency = 0;
+  for (size_t i = 0; i < sceneDevices.size(); i++) {
+    ManagedDevice* managedDevice = findDevice(sceneDevices[i]);
+    if (latencies[i] == 0 || managedDevice == nullptr) {
+      continue;
+    }
+    sumLatency += latencies[i];
+    managedDevice->stats.sceneCommands++;
+    managedDevice->stats.lastLatencyMs = latencies[i];
+    managedDevice->stats.totalLatencyMs += latencies[i];
+    if (latencies[i] > managedDevice->stats.maxLatencyMs) {
+      managedDevice->stats.maxLatencyMs = latencies[i];
+    }
+  }
+  sceneStats.scenes++;
+  sceneStats.lastDurationMs = duration;
+  sceneStats.lastSumLatencyMs = sumLatency;
+  sceneStats.totalDurationMs += duration;
+  if (duration > sceneStats.maxDurationMs) {
+    sceneStats.maxDurationMs = duration;
+  }
+  xSemaphoreGive(managerSemaphore);
+
+  #ifdef DEBUG_NUKI_CONNECT
+  log_d("Scene on %d devices done in %d ms, %d ms one by one", dispatched, duration, sumLatency);
+  #endif
+  return results;
+}
+
+DeviceRadioStats DeviceManager::getRadioStats(const NukiBle* device) {
+  DeviceRadioStats stats = {};
+  xSemaphoreTake(managerSemaphore, portMAX_DELAY);
+  ManagedDevice* managedDevice = findDevice(device);
+  if (managedDevice != nullptr) {
+    stats = managedDevice->stats;
+  }
+  xSemaphoreGive(managerSemaphore);
+  return stats;
+}
+
+SceneStats DeviceManager::getSceneStats() {
+  xSemaphoreTake(managerSemaphore, portMAX_DELAY);
+  SceneStats stats = sceneStats;
+  xSemaphoreGive(managerSemaphore);
+  return stats;
+}
+
+bool DeviceManager::acquireRadio(const NukiBle* device, const uint32_t timeout) {
+  xSemaphoreTake(managerSemaphore, portMAX_DELAY);
+  radioWaiters++;
+  xSemaphoreGive(managerSemaphore);
+
+  uint32_t startTime = millis();
+  bool acquired = takeRadioSlot(device, timeout);
+  uint32_t waited = millis() - startTime;
+
+  xSemaphoreTake(managerSemaphore, portMAX_DELAY);
+  radioWaiters--;
+  if (acquired) {
+    if (!scanningSuspended && bleScanner != nullptr) {
+      bleScanner->enableScanning(false);
+    }
+    scanningSuspended = true;
+    radioHolders++;
+    ManagedDevice* managedDevice = findDevice(device);
+    if (managedDevice != nullptr) {
+      managedDevice->holdsLink = true;
+      managedDevice->holdsRadio = true;
+      managedDevice->radioAcquiredTs = millis();
+      managedDevice->stats.totalWaitMs += waited;
+      if (waited > managedDevice->stats.maxWaitMs) {
+        managedDevice->stats.maxWaitMs = waited;
+      }
+    }
+  } else {
+    if (scanningSuspended && radioHolders == 0 && radioWaiters == 0) {
+      //radio was handed over to this device but it gave up waiting
+      scanningSuspended = false;
+      if (bleScanner != nullptr) {
+        bleScanner->enableScanning(true);
+      }
+    }
+    log_w("Radio not available after %d ms", waited);
+  }
+  xSemaphoreGive(managerSemaphore);
+  return acquired;
+}
+
+void DeviceManager::releaseRadio(const NukiBle* device) {
+  xSemaphoreTake(managerSemaphore, portMAX_DELAY);
+  ManagedDevice* managedDevice = findDevice(device);
+  if (managedDevice == nullptr || !managedDevice->holdsRadio) {
+    xSemaphoreGive(managerSemaphore);
+    log_w("Radio released by a device not holding it");
+    return;
+  }
+  uint32_t radioTime = millis() - managedDevice->radioAcquiredTs;
+  managedDevice->holdsRadio = false;
+  managedDevice->stats.commands++;
+  managedDevice->stats.lastRadioTimeMs = radioTime;
+  managedDevice->stats.radioTimeMs += radioTime;
+  radioHolders--;
+  //when another device is waiting it takes over right away, scanning stays off in between
+  if (radioHolders == 0 && radioWaiters == 0 && scanningSuspended) {
+    scanningSuspended = false;
+    if (bleScanner != nullptr) {
+      bleScanner->enableScanning(true);
+    }
+  }
+  //the slot stays with the device until its connection is closed
+  releaseClosedLink(*managedDevice);
+  xSemaphoreGive(managerSemaphore);
+}
+
+void DeviceManager::onLinkClosed(const NukiBle* device) {
+  xSemaphoreTake(managerSemaphore, portMAX_DELAY);
+  ManagedDevice* managedDevice = findDevice(device);
+  //while a command runs, the slot is kept for a reconnect and freed by releaseRadio()
+  if (managedDevice != nullptr && managedDevice->holdsLink && !managedDevice->holdsRadio) {
+    managedDevice->holdsLink = false;
+    managedDevice->closingLink = false;
+    xSemaphoreGive(radioSlots);
+  }
+  xSemaphoreGive(managerSemaphore);
+}
+
+bool DeviceManager::takeRadioSlot(const NukiBle* device, const uint32_t timeout) {
+  uint32_t startTime = millis();
+  while (millis() - startTime < timeout) {
+    xSemaphoreTake(managerSemaphore, portMAX_DELAY);
+    ManagedDevice* managedDevice = findDevice(device);
+    bool ownLink = managedDevice != nullptr && managedDevice->holdsLink && !releaseClosedLink(*managedDevice);
+    bool closing = ownLink && managedDevice->closingLink;
+    xSemaphoreGive(managerSemaphore);
+
+    if (ownLink && !closing) {
+      //the slot of a connection that is still open is used for all commands sent over it
+      return true;
+    } else if (closing) {
+      //a device whose connection is being closed gets a new slot after its old one is freed
+      delay(RADIO_SLOT_WAIT_SLICE / 10);
+    } else if (xSemaphoreTake(radioSlots, 0) == pdTRUE) {
+      return true;
+    } else {
+      //a connection kept open after its command is closed right away, its slot is given back by onLinkClosed().
+      //Only when every slot is used by a running command this waits for a command to finish
+      closeIdleLink(device);
+      if (xSemaphoreTake(radioSlots, RADIO_SLOT_WAIT_SLICE / portTICK_PERIOD_MS) == pdTRUE) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void DeviceManager::closeIdleLink(const NukiBle* device) {
+  NukiBle* idleDevice = nullptr;
+  xSemaphoreTake(managerSemaphore, portMAX_DELAY);
+  ManagedDevice* leastRecentlyUsed = nullptr;
+  for (ManagedDevice& managedDevice : devices) {
+    if (managedDevice.device == device || !managedDevice.holdsLink || managedDevice.holdsRadio
+        || managedDevice.closingLink) {
+      continue;
+    }
+    if (releaseClosedLink(managedDevice)) {
+      //disconnected without notice, its slot is free now
+      leastRecentlyUsed = nullptr;
+      break;
+    }
+    if (leastRecentlyUsed == nullptr || (int32_t)(managedDevice.radioAcquiredTs - leastRecentlyUsed->radioAcquiredTs) < 0) {
+      leastRecentlyUsed = &managedDevice;
+    }
+  }
+  if (leastRecentlyUsed != nullptr) {
+    leastRecentlyUsed->closingLink = true;
+    idleDevice = leastRecentlyUsed->device;
+  }
+  xSemaphoreGive(managerSemaphore);
+
+  if (idleDevice != nullptr) {
+    #ifdef DEBUG_NUKI_CONNECT
+    log_d("Closing idle connection to %s to free a radio slot", idleDevice->deviceName.c_str());
+    #endif
+    //the slot is freed by onLinkClosed()
+    idleDevice->pClient->disconnect();
+  }
+}
+
+bool DeviceManager::releaseClosedLink(ManagedDevice& managedDevice) {
+  if (!managedDevice.holdsLink || managedDevice.holdsRadio
+      || (managedDevice.device->pClient && managedDevice.device->pClient->isConnected())) {
+    return false;
+  }
+  managedDevice.holdsLink = false;
+  managedDevice.closingLink = false;
+  xSemaphoreGive(radioSlots);
+  return true;
+}
+
+void DeviceManager::beginConnect() {
+  xSemaphoreTake(connectSemaphore, portMAX_DELAY);
+}
+
+void DeviceManager::endConnect() {
+  xSemaphoreGive(connectSemaphore);
+}
+
+void DeviceManager::onResult(NimBLEAdvertisedDevice* advertisedDevice) {
+  uint64_t key = addressKey(advertisedDevice->getAddress());
+
+  //the subscribers are called after the manager is unlocked, so they may use the manager
+  xSemaphoreTakeRecursive(dispatchSemaphore, portMAX_DELAY);
+  xSemaphoreTake(managerSemaphore, portMAX_DELAY);
+  resultTargets.clear();
+  auto it = devicesByAddress.find(key);
+  if (it != devicesByAddress.end()) {
+    resultTargets.push_back(it->second);
+  } else {
+    //not from a paired device, of interest to devices looking for a lock in pairing mode and to other subscribers
+    for (BleScanner::Subscriber* subscriber : subscribers) {
+      bool pairedDevice = false;
+      for (auto& addressDevice : devicesByAddress) {
+        if (subscriber == addressDevice.second) {
+          pairedDevice = true;
+          break;
+        }
+      }
+      if (!pairedDevice) {
+        resultTargets.push_back(subscriber);
+      }
+    }
+  }
+  xSemaphoreGive(managerSemaphore);
+
+  for (BleScanner::Subscriber* subscriber : resultTargets) {
+    subscriber->onResult(advertisedDevice);
+  }
+  xSemaphoreGiveRecursive(dispatchSemaphore);
+}
+
+void DeviceManager::subscribe(BleScanner::Subscriber* subscriber) {
+  xSemaphoreTake(managerSemaphore, portMAX_DELAY);
+  for (BleScanner::Subscriber* s : subscribers) {
+    if (s == subscriber) {
+      xSemaphoreGive(managerSemaphore);
+      return;
+    }
+  }
+  subscribers.push_back(subscriber);
+  xSemaphoreGive(managerSemaphore);
+}
+
+void DeviceManager::unsubscribe(BleScanner::Subscriber* subscriber) {
+  xSemaphoreTake(managerSemaphore, portMAX_DELAY);
+  for (auto it = subscribers.begin(); it != subscribers.end(); it++) {
+    if (*it == subscriber) {
+      subscribers.erase(it);
+      break;
+    }
+  }
+  for (auto it = devices.begin(); it != devices.end(); it++) {
+    if (it->device == subscriber) {
+      if (it->holdsLink) {
+        xSemaphoreGive(radioSlots);
+      }
+      devices.erase(it);
+      break;
+    }
+  }
+  removeDeviceAddress(subscriber);
+  xSemaphoreGive(managerSemaphore);
+  //the subscriber may be deleted once this returns
+  waitForDispatch();
+}
+
+void DeviceManager::enableScanning(bool enable) {
+  xSemaphoreTake(managerSemaphore, portMAX_DELAY);
+  //while a device holds the radio, scanning is controlled by the manager
+  if (!scanningSuspended && bleScanner != nullptr) {
+    bleScanner->enableScanning(enable);
+  }
+  xSemaphoreGive(managerSemaphore);
+}
+
+uint64_t DeviceManager::addressKey(const NimBLEAddress& address) {
+  uint64_t key = 0;
+  memcpy(&key, address.getNative(), 6);
+  return key;
+}
+
+void DeviceManager::removeDeviceAddress(const BleScanner::Subscriber* subscriber) {
+  for (auto it = devicesByAddress.begin(); it != devicesByAddress.end(); it++) {
+    if (it->second == subscriber) {
+      devicesByAddress.erase(it);
+      return;
+    }
+  }
+}
+
+void DeviceManager::waitForDispatch() {
+  xSemaphoreTakeRecursive(dispatchSemaphore, portMAX_DELAY);
+  xSemaphoreGiveRecursive(dispatchSemaphore);
+}
+
+DeviceManager::ManagedDevice* DeviceManager::findDevice(const NukiBle* device) {
+  for (ManagedDevice& managedDevice : devices) {
+    if (managedDevice.device == device) {
+      return &managedDevice;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace Nuki
@@ -0,0 +1,213 @@
+#pragma once
+
+/**
+ * @file NukiDeviceManager.h
+ * Manages several Nuki devices (locks/openers) served by one ESP32: shares one BLE scanner between them,
+ * dispatches advertisements to the right device and arbitrates the radio. Optionally keeps connections to several
+ * devices open at the same time so a command to all of them (a scene) runs interleaved instead of one after another
+ *
+ * Created on: 2022
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * This library implements the communication from an ESP32 via BLE to a Nuki smart lock.
+ * Based on the Nuki Smart Lock API V2.2.1
+ * https://developer.nuki.io/page/nuki-smart-lock-api-2/2/
+ *
+ */
+
+#include "Arduino.h"
+#include "NimBLEDevice.h"
+#include "NukiDataTypes.h"
+#include <BleInterfaces.h>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#define RADIO_ACQUIRE_TIMEOUT 30000
+#define RADIO_SLOT_WAIT_SLICE 500   //max wait for a freed slot before looking for an idle connection again
+#define SCENE_TIMEOUT 60000
+
+#ifdef CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+#define DEVICE_MANAGER_MAX_CONNECTIONS CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+#else
+#define DEVICE_MANAGER_MAX_CONNECTIONS 3
+#endif
+
+namespace Nuki {
+
+class NukiBle;
+
+struct DeviceRadioStats {
+  uint32_t commands;      // commands executed while holding the radio
+  uint32_t radioTimeMs;   // total time the device held the radio
+  uint32_t lastRadioTimeMs;
+  uint32_t totalWaitMs;   // total time spent waiting for the radio
+  uint32_t maxWaitMs;
+  uint32_t sceneCommands;   // commands executed as part of executeOnAll()
+  uint32_t lastLatencyMs;   // time from dispatch to result of the last scene command
+  uint32_t maxLatencyMs;
+  uint32_t totalLatencyMs;
+};
+
+struct SceneStats {
+  uint32_t scenes;              // executeOnAll() calls
+  uint32_t lastDurationMs;      // duration of the last scene until the last device finished
+  uint32_t lastSumLatencyMs;    // sum of the device latencies of the last scene, the duration when run one by one
+  uint32_t maxDurationMs;
+  uint32_t totalDurationMs;
+};
+
+class DeviceManager : public BleScanner::Subscriber, public BleScanner::Publisher {
+  public:
+    DeviceManager();
+    ~DeviceManager();
+
+    /**
+     * @brief Registers the BLE scanner shared by all managed devices
+     * BleScanner::Publisher is defined in dependent library https://github.com/I-Connect/BleScanner.git
+     *
+     * @param bleScanner the publisher of the BLE scanner
+     */
+    void registerBleScanner(BleScanner::Publisher* bleScanner);
+
+    /**
+     * @brief Adds a device to the manager, the device receives its advertisements through the manager
+     * and takes the radio from the manager for every command. Replaces NukiBle::registerBleScanner()
+     *
+     * @param device initialized lock or opener
+     */
+    void addDevice(NukiBle* device);
+
+    /**
+     * @brief Removes a device from the manager, it then no longer receives advertisements until it is added again
+     * or a BLE scanner is registered with NukiBle::registerBleScanner(). Must not be called while the device
+     * executes a command
+     */
+    void removeDevice(NukiBle* device);
+
+    /**
+     * @brief Updates the advertisement dispatch of a managed device after it was paired or unpaired,
+     * called by the device
+     */
+    void updateDeviceAddress(const NukiBle* device);
+
+    /**
+     * @brief Calls updateConnectionState() of all managed devices, to be called from the loop
+     */
+    void updateConnectionState();
+
+    /**
+     * @brief Sets the number of devices that may be connected at the same time (default 1).
+     * A device takes a slot with its first command and keeps it until its connection is closed, so there are never
+     * more open connections than slots. When no slot is free, the idle connection used least recently is closed.
+     * With more than 1 the connections to those devices are kept open side by side and their command exchanges
+     * interleave: while one device waits for the reply of its lock, the next one sends. Connection setup itself
+     * is always done one device at a time.
+     *
+     * @param connections 1 .. DEVICE_MANAGER_MAX_CONNECTIONS (CONFIG_BT_NIMBLE_MAX_CONNECTIONS)
+     */
+    void setConcurrentConnections(const uint8_t connections);
+
+    /**
+     * @brief Connects to all paired devices, one after another, so a following scene only has to exchange messages.
+     * Each connection waits for its turn like a command of the device. The connections are closed by
+     * updateConnectionState() after the idle timeout as usual
+     *
+     * @return number of connected devices
+     */
+    uint8_t connectAll();
+
+    /**
+     * @brief Runs a command on all paired devices at the same time (on the async worker of each device)
+     * and waits until all are done, e.g. to lock all doors:
+     * `deviceManager.executeOnAll([](Nuki::NukiBle* device) { return ((NukiLock::NukiLock*)device)->lockAction(NukiLock::LockAction::Lock); });`
+     *
+     * @param command command to run, called with each device
+     * @param timeout max time in ms to wait for all devices
+     * @return the result per device in the order the devices were added, NotPaired for unpaired devices
+     * and TimeOut for devices that did not finish in time
+     */
+    std::vector<CmdResult> executeOnAll(std::function<CmdResult(NukiBle*)> command, const uint32_t timeout = SCENE_TIMEOUT);
+
+    /**
+     * @brief Returns the radio and latency statistics of a managed device
+     */
+    DeviceRadioStats getRadioStats(const NukiBle* device);
+
+    /**
+     * @brief Returns the statistics of the scenes run with executeOnAll()
+     */
+    SceneStats getSceneStats();
+
+    /**
+     * @brief Waits until a radio slot is free and hands it to device, a device that is still connected already has
+     * its slot. Scanning is turned off while any device holds the radio and stays off when the radio is handed over
+     * directly to a waiting device.
+     *
+     * @param device device that wants to communicate
+     * @param timeout max time in ms to wait for the radio
+     * @return true if device holds the radio, releaseRadio() must then be called when done
+     */
+    bool acquireRadio(const NukiBle* device, const uint32_t timeout = RADIO_ACQUIRE_TIMEOUT);
+
+    /**
+     * @brief Releases the radio, scanning is turned on again when no device holds or waits for it.
+     * The slot is kept while the device stays connected
+     */
+    void releaseRadio(const NukiBle* device);
+
+    /**
+     * @brief Frees the slot of a device, called by the device when its connection is closed
+     */
+    void onLinkClosed(const NukiBle* device);
+
+    /**
+     * @brief Serializes connection setup, NimBLE handles one connection attempt at a time
+     */
+    void beginConnect();
+    void endConnect();
+
+    // BleScanner::Subscriber
+    void onResult(NimBLEAdvertisedDevice* advertisedDevice) override;
+
+    // BleScanner::Publisher, used by the managed devices
+    void subscribe(BleScanner::Subscriber* subscriber) override;
+    void unsubscribe(BleScanner::Subscriber* subscriber) override;
+    void enableScanning(bool enable) override;
+
+  private:
+    struct ManagedDevice {
+      NukiBle* device;
+      DeviceRadioStats stats;
+      bool holdsRadio;
+      uint32_t radioAcquiredTs;
+      bool holdsLink;     // holds a slot for its open connection
+      bool closingLink;   // asked to disconnect to free its slot
+    };
+
+    static uint64_t addressKey(const NimBLEAddress& address);
+    ManagedDevice* findDevice(const NukiBle* device);
+    void removeDeviceAddress(const BleScanner::Subscriber* subscriber);
+    bool takeRadioSlot(const NukiBle* device, const uint32_t timeout);
+    void closeIdleLink(const NukiBle* device);
+    bool releaseClosedLink(ManagedDevice& managedDevice);
+    void waitForDispatch();
+
+    BleScanner::Publisher* bleScanner = nullptr;
+    std::vector<ManagedDevice> devices;
+    std::vector<BleScanner::Subscriber*> subscribers;
+    std::unordered_map<uint64_t, NukiBle*> devicesByAddress;   //paired devices only
+    std::vector<BleScanner::Subscriber*> resultTargets;        //only used by onResult(), kept to not allocate per advertisement
+
+    SemaphoreHandle_t managerSemaphore = xSemaphoreCreateMutex();
+    SemaphoreHandle_t dispatchSemaphore = xSemaphoreCreateRecursiveMutex();  //held while onResult() calls out
+    SemaphoreHandle_t radioSlots = xSemaphoreCreateCounting(DEVICE_MANAGER_MAX_CONNECTIONS, 1);
+    SemaphoreHandle_t connectSemaphore = xSemaphoreCreateMutex();
+    uint8_t concurrentConnections = 1;
+    uint8_t radioHolders = 0;
+    uint8_t radioWaiters = 0;
+    bool scanningSuspended = false;
+    SceneStats sceneStats = {};
+};
+
+} // namespace Nuki
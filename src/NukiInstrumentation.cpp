@@ -0,0 +1,114 @@
+#include "NukiInstrumentation.h"
+#include <atomic>
+
+#ifdef NUKI_INSTRUMENTATION
+
+namespace Nuki {
+
+static const uint32_t bucketLimitsMs[INSTRUMENTATION_HISTOGRAM_BUCKETS] = {100, 250, 500, 1000, 2000, 4000, 8000, UINT32_MAX};
+
+Instrumentation::Instrumentation() {
+  clear();
+}
+
+void Instrumentation::record(const Command command, const CommandPhase phase, const uint8_t result) {
+  uint32_t now = micros();
+
+  //claim a slot, the sequence tells readers whether the slot holds a complete event
+  uint32_t index = __atomic_fetch_add(&writeIndex, 1, __ATOMIC_RELAXED);
+  Slot& slot = slots[index % INSTRUMENTATION_BUFFER_SIZE];
+  __atomic_store_n(&slot.sequence, 0, __ATOMIC_RELAXED);
+  //the sequence is invalidated before the event is written
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.event = {now, command, phase, result};
+  __atomic_store_n(&slot.sequence, index + 1, __ATOMIC_RELEASE);
+
+  if (command == Command::Empty || phase == CommandPhase::Disconnected) {
+    return;
+  }
+  if (phase == CommandPhase::Start) {
+    commandStartUs = now;
+    lastPhaseUs = now;
+    return;
+  }
+
+  CommandHistogram* histogram = histogramFor(command);
+  if (histogram == nullptr) {
+    return;
+  }
+  histogram->phaseTotalUs[(uint8_t)phase] += now - lastPhaseUs;
+  lastPhaseUs = now;
+
+  if (phase == CommandPhase::FinalStatus) {
+    uint32_t durationMs = (now - commandStartUs) / 1000;
+    histogram->count++;
+    histogram->totalMs += durationMs;
+    if (durationMs > histogram->maxMs) {
+      histogram->maxMs = durationMs;
+    }
+    uint8_t bucket = 0;
+    while (durationMs >= bucketLimitsMs[bucket]) {
+      bucket++;
+    }
+    histogram->buckets[bucket]++;
+  }
+}
+
+size_t Instrumentation::getEvents(PhaseEvent* events, const size_t maxEvents) const {
+  uint32_t end = __atomic_load_n(&writeIndex, __ATOMIC_ACQUIRE);
+  uint32_t available = end < INSTRUMENTATION_BUFFER_SIZE ? end : INSTRUMENTATION_BUFFER_SIZE;
+  uint32_t count = available < maxEvents ? available : maxEvents;
+
+  size_t copied = 0;
+  for (uint32_t index = end - count; index != end; index++) {
+    const Slot& slot = slots[index % INSTRUMENTATION_BUFFER_SIZE];
+    if (__atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE) != index + 1) {
+      continue;
+    }
+    PhaseEvent event = slot.event;
+    //the copy is done before the sequence is read again
+    std::atomic_thread_fence(std::memory_order_acquire);
+    //skip events overwritten while being copied
+    if (__atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE) == index + 1) {
+      events[copied++] = event;
+    }
+  }
+  return copied;
+}
+
+size_t Instrumentation::getHistograms(CommandHistogram* histograms, const size_t maxHistograms) const {
+  size_t copied = 0;
+  for (const CommandHistogram& histogram : this->histograms) {
+    if (histogram.command != Command::Empty && copied < maxHistograms) {
+      histograms[copied++] = histogram;
+    }
+  }
+  return copied;
+}
+
+uint32_t Instrumentation::getBucketLimitMs(const uint8_t bucket) {
+  return bucket < INSTRUMENTATION_HISTOGRAM_BUCKETS ? bucketLimitsMs[bucket] : UINT32_MAX;
+}
+
+void Instrumentation::clear() {
+  memset(slots, 0, sizeof(slots));
+  memset(histograms, 0, sizeof(histograms));
+  writeIndex = 0;
+}
+
+CommandHistogram* Instrumentation::histogramFor(const Command command) {
+  for (CommandHistogram& histogram : histograms) {
+    if (histogram.command == command) {
+      return &histogram;
+    }
+    if (histogram.command == Command::Empty) {
+      histogram.command = command;
+      return &histogram;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace Nuki
+
+#endif
@@ -0,0 +1,126 @@
+#pragma once
+
+/**
+ * @file NukiInstrumentation.h
+ * Optional timing of the protocol phases of every command, enabled with the define NUKI_INSTRUMENTATION.
+ * Without the define the trace macros are empty and nothing is compiled in.
+ *
+ * Created on: 2022
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * This library implements the communication from an ESP32 via BLE to a Nuki smart lock.
+ * Based on the Nuki Smart Lock API V2.2.1
+ * https://developer.nuki.io/page/nuki-smart-lock-api-2/2/
+ *
+ */
+
+#include "Arduino.h"
+#include "NukiConstants.h"
+
+#define INSTRUMENTATION_BUFFER_SIZE 64
+#define INSTRUMENTATION_MAX_COMMANDS 16
+#define INSTRUMENTATION_HISTOGRAM_BUCKETS 8   //<100, <250, <500, <1000, <2000, <4000, <8000, >=8000 ms
+
+namespace Nuki {
+
+enum class CommandPhase : uint8_t {
+  Start               = 0,  // command let in by the command queue
+  ConnectStart        = 1,  // connectBle() has to set up a connection
+  ConnectRetry        = 2,  // connection attempt failed, retrying
+  Connected           = 3,  // BLE connection established
+  ServicesRegistered  = 4,  // characteristics found and subscribed
+  ChallengeSent       = 5,
+  ChallengeReceived   = 6,
+  CommandSent         = 7,
+  AcceptReceived      = 8,  // only for commands with challenge and accept
+  FinalStatus         = 9,  // command finished, with result
+  Disconnected        = 10
+};
+
+#define INSTRUMENTATION_PHASES 11
+
+#ifdef NUKI_INSTRUMENTATION
+
+struct PhaseEvent {
+  uint32_t timestampUs;
+  Command command;        // Empty for phases outside a command (e.g. idle disconnect)
+  CommandPhase phase;
+  uint8_t result;        // CmdResult, only for FinalStatus
+};
+
+struct CommandHistogram {
+  Command command;
+  uint32_t count;
+  uint32_t totalMs;
+  uint32_t maxMs;
+  uint32_t buckets[INSTRUMENTATION_HISTOGRAM_BUCKETS];  // number of commands per duration bucket
+  uint32_t phaseTotalUs[INSTRUMENTATION_PHASES];        // cumulative time from the previous phase up to each phase
+};
+
+class Instrumentation {
+  public:
+    Instrumentation();
+
+    /**
+     * @brief Records a phase, safe to call from any task (lock-free)
+     */
+    void record(const Command command, const CommandPhase phase, const uint8_t result = 0);
+
+    /**
+     * @brief Copies the most recent phase events, oldest first
+     *
+     * @param events buffer for the events
+     * @param maxEvents size of events
+     * @return number of events copied
+     */
+    size_t getEvents(PhaseEvent* events, const size_t maxEvents) const;
+
+    /**
+     * @brief Copies the cumulative histograms of the commands executed so far
+     *
+     * @param histograms buffer for the histograms
+     * @param maxHistograms size of histograms
+     * @return number of histograms copied
+     */
+    size_t getHistograms(CommandHistogram* histograms, const size_t maxHistograms) const;
+
+    /**
+     * @brief Returns the upper limit in ms of a histogram bucket, the last bucket has no upper limit (UINT32_MAX)
+     */
+    static uint32_t getBucketLimitMs(const uint8_t bucket);
+
+    /**
+     * @brief Resets the events and histograms
+     */
+    void clear();
+
+  private:
+    struct Slot {
+      volatile uint32_t sequence;  // index + 1 of the event in the slot, 0 while being written
+      PhaseEvent event;
+    };
+
+    CommandHistogram* histogramFor(const Command command);
+
+    Slot slots[INSTRUMENTATION_BUFFER_SIZE];
+    uint32_t writeIndex = 0;
+
+    //histograms are only updated from the task executing the command
+    CommandHistogram histograms[INSTRUMENTATION_MAX_COMMANDS];
+    uint32_t commandStartUs = 0;
+    uint32_t lastPhaseUs = 0;
+};
+
+#define NUKI_TRACE_START(command) do { instrumentedCommand = command; instrumentation.record(command, Nuki::CommandPhase::Start); } while (0)
+#define NUKI_TRACE(phase) instrumentation.record(instrumentedCommand, Nuki::CommandPhase::phase)
+#define NUKI_TRACE_END(result) do { instrumentation.record(instrumentedCommand, Nuki::CommandPhase::FinalStatus, result); instrumentedCommand = Nuki::Command::Empty; } while (0)
+
+#else
+
+#define NUKI_TRACE_START(command)
+#define NUKI_TRACE(phase)
+#define NUKI_TRACE_END(result)
+
+#endif
+
+} // namespace Nuki
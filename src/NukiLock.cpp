@@ -92,33 +92,129 @@ Nuki::CmdResult NukiLock::requestBatteryReport(BatteryReport* retrievedBatteryRe
 
 
 Nuki::CmdResult NukiLock::requestConfig(Config* retrievedConfig) {
-  Action action;
+  if (configTransaction && configStaged) {
+    memcpy(retrievedConfig, &stagedConfig, sizeof(Config));
+    return Nuki::CmdResult::Success;
+  }
 
-  memset(&action, 0, sizeof(action));
-  action.cmdType = Nuki::CommandType::CommandWithChallenge;
-  action.command = Command::RequestConfig;
+  Nuki::CmdResult result = Nuki::CmdResult::Success;
+  if (isConfigCacheValid(configCached, configCacheUpdateCount)) {
+    #ifdef DEBUG_NUKI_COMMUNICATION
+    log_d("Config served from cache");
+    #endif
+  } else {
+    Action action;
 
-  Nuki::CmdResult result = executeAction(action);
+    memset(&action, 0, sizeof(action));
+    action.cmdType = Nuki::CommandType::CommandWithChallenge;
+    action.command = Command::RequestConfig;
+
+    result = executeAction(action);
+  }
   if (result == Nuki::CmdResult::Success) {
     memcpy(retrievedConfig, &config, sizeof(Config));
+    if (configTransaction) {
+      memcpy(&stagedConfig, &config, sizeof(Config));
+      memcpy(&originalConfig, &config, sizeof(Config));
+      configStaged = true;
+    }
   }
   return result;
 }
 
 Nuki::CmdResult NukiLock::requestAdvancedConfig(AdvancedConfig* retrievedAdvancedConfig) {
-  Action action;
+  if (configTransaction && advancedConfigStaged) {
+    memcpy(retrievedAdvancedConfig, &stagedAdvancedConfig, sizeof(AdvancedConfig));
+    return Nuki::CmdResult::Success;
+  }
 
-  memset(&action, 0, sizeof(action));
-  action.cmdType = Nuki::CommandType::CommandWithChallenge;
-  action.command = Command::RequestAdvancedConfig;
+  Nuki::CmdResult result = Nuki::CmdResult::Success;
+  if (isConfigCacheValid(advancedConfigCached, advancedConfigCacheUpdateCount)) {
+    #ifdef DEBUG_NUKI_COMMUNICATION
+    log_d("AdvancedConfig served from cache");
+    #endif
+  } else {
+    Action action;
 
-  Nuki::CmdResult result = executeAction(action);
+    memset(&action, 0, sizeof(action));
+    action.cmdType = Nuki::CommandType::CommandWithChallenge;
+    action.command = Command::RequestAdvancedConfig;
+
+    result = executeAction(action);
+  }
   if (result == Nuki::CmdResult::Success) {
     memcpy(retrievedAdvancedConfig, &advancedConfig, sizeof(AdvancedConfig));
+    if (configTransaction) {
+      memcpy(&stagedAdvancedConfig, &advancedConfig, sizeof(AdvancedConfig));
+      memcpy(&originalAdvancedConfig, &advancedConfig, sizeof(AdvancedConfig));
+      advancedConfigStaged = true;
+    }
   }
   return result;
 }
 
+void NukiLock::beginConfigTransaction() {
+  configTransaction = true;
+  configStaged = false;
+  advancedConfigStaged = false;
+}
+
+Nuki::CmdResult NukiLock::commitConfigTransaction() {
+  Nuki::CmdResult result = Nuki::CmdResult::Success;
+  configTransaction = false;
+
+  if (configStaged) {
+    NewConfig newConfig;
+    NewConfig oldConfig;
+    memset(&newConfig, 0, sizeof(NewConfig));
+    memset(&oldConfig, 0, sizeof(NewConfig));
+    createNewConfig(&stagedConfig, &newConfig);
+    createNewConfig(&originalConfig, &oldConfig);
+    if (memcmp(&newConfig, &oldConfig, sizeof(NewConfig)) != 0) {
+      result = setConfig(newConfig);
+    } else {
+      #ifdef DEBUG_NUKI_COMMUNICATION
+      log_d("Config unchanged, not sent");
+      #endif
+    }
+  }
+
+  if (advancedConfigStaged && result == Nuki::CmdResult::Success) {
+    NewAdvancedConfig newConfig;
+    NewAdvancedConfig oldConfig;
+    memset(&newConfig, 0, sizeof(NewAdvancedConfig));
+    memset(&oldConfig, 0, sizeof(NewAdvancedConfig));
+    createNewAdvancedConfig(&stagedAdvancedConfig, &newConfig);
+    createNewAdvancedConfig(&originalAdvancedConfig, &oldConfig);
+    if (memcmp(&newConfig, &oldConfig, sizeof(NewAdvancedConfig)) != 0) {
+      result = setAdvancedConfig(newConfig);
+    } else {
+      #ifdef DEBUG_NUKI_COMMUNICATION
+      log_d("Advanced config unchanged, not sent");
+      #endif
+    }
+  }
+
+  configStaged = false;
+  advancedConfigStaged = false;
+  return result;
+}
+
+void NukiLock::invalidateConfigCache() {
+  configCached = false;
+  advancedConfigCached = false;
+}
+
+bool NukiLock::isConfigCacheValid(const bool cached, const uint8_t cacheUpdateCount) const {
+  return cached && stateReceived && keyTurnerState.configUpdateCount == cacheUpdateCount;
+}
+
+void NukiLock::abortConfigTransaction() {
+  configTransaction = false;
+  configStaged = false;
+  advancedConfigStaged = false;
+}
+
 
 //basic config change methods
 Nuki::CmdResult NukiLock::setName(const std::string& name) {
@@ -580,28 +676,39 @@ Nuki::CmdResult NukiLock::retrieveTimeControlEntries() {
   action.command = Command::RequestTimeControlEntries;
   action.payloadLen = 0;
 
-  listOfTimeControlEntries.clear();
+  timeControlEntryBuffer.clear();
 
-  return executeAction(action);
+  //number of entries is only known from the time control entry count frame
+  return executeAction(action, {Command::TimeControlEntry, UINT16_MAX});
 }
 
 void NukiLock::getTimeControlEntries(std::list<TimeControlEntry>* requestedTimeControlEntries) {
   requestedTimeControlEntries->clear();
-  std::list<TimeControlEntry>::iterator it = listOfTimeControlEntries.begin();
-  while (it != listOfTimeControlEntries.end()) {
-    requestedTimeControlEntries->push_back(*it);
-    it++;
+  for (const TimeControlEntry& entry : timeControlEntryBuffer) {
+    requestedTimeControlEntries->push_back(entry);
   }
 }
 
+const TimeControlEntryBuffer& NukiLock::getTimeControlEntryBuffer() const {
+  return timeControlEntryBuffer;
+}
+
 void NukiLock::getLogEntries(std::list<LogEntry>* requestedLogEntries) {
   requestedLogEntries->clear();
 
-  for (const auto& it : listOfLogEntries) {
+  for (const auto& it : logEntryBuffer) {
     requestedLogEntries->push_back(it);
   }
 }
 
+const LogEntryBuffer& NukiLock::getLogEntryBuffer() const {
+  return logEntryBuffer;
+}
+
+void NukiLock::setLogEntrySink(LogEntrySink* sink) {
+  logEntrySink = sink;
+}
+
 Nuki::CmdResult NukiLock::retrieveLogEntries(const uint32_t startIndex, const uint16_t count, const uint8_t sortOrder, bool const totalCount) {
   Action action;
   unsigned char payload[8] = {0};
@@ -615,25 +722,39 @@ Nuki::CmdResult NukiLock::retrieveLogEntries(const uint32_t startIndex, const ui
   memcpy(action.payload, &payload, sizeof(payload));
   action.payloadLen = sizeof(payload);
 
-  listOfLogEntries.clear();
+  logEntryBuffer.clear();
+  nrOfReceivedLogEntries = 0;
 
-  return executeAction(action);
+  //the start index is not an offset into the reported count (it depends on the sort order), the lock
+  //ends the list with a status complete
+  return executeAction(action, {Command::LogEntry, count, 0, true});
 }
 
-Nuki::CmdResult NukiLock::retrieveAuthorizationEntries(const uint16_t offset, const uint16_t count) {
-  Action action;
-  unsigned char payload[4] = {0};
-  memcpy(payload, &offset, 2);
-  memcpy(&payload[2], &count, 2);
+Nuki::CmdResult NukiLock::syncLogEntries(const uint16_t maxEntries) {
+  return logSync.sync(*this, maxEntries);
+}
 
-  action.cmdType = Nuki::CommandType::CommandWithChallengeAndPin;
-  action.command = Command::RequestAuthorizationEntries;
-  memcpy(action.payload, &payload, sizeof(payload));
-  action.payloadLen = sizeof(payload);
+void NukiLock::getSyncedLogEntries(std::list<LogEntry>* syncedLogEntries) {
+  logSync.getEntries(syncedLogEntries);
+}
+
+void NukiLock::clearSyncedLogEntries() {
+  logSync.clearEntries();
+}
 
-  listOfAuthorizationEntries.clear();
+uint32_t NukiLock::getLastSyncedLogIndex() {
+  return logSync.getLastIndex();
+}
 
-  return executeAction(action);
+void NukiLock::resetLogSync() {
+  logSync.reset();
+}
+
+void NukiLock::onCredentialsDeleted() {
+  logSync.reset();
+  //cached config and state belong to the old pairing
+  invalidateConfigCache();
+  stateReceived = false;
 }
 
 Nuki::CmdResult NukiLock::deleteAuthorizationEntry(uint32_t id) {
@@ -682,16 +803,30 @@ Nuki::CmdResult NukiLock::setConfig(NewConfig newConfig) {
   memcpy(action.payload, &payload, sizeof(payload));
   action.payloadLen = sizeof(payload);
 
-  return executeAction(action);
+  Nuki::CmdResult result = executeAction(action);
+  if (result == Nuki::CmdResult::Success) {
+    configCached = false;
+  }
+  return result;
 }
 
 Nuki::CmdResult NukiLock::setFromConfig(const Config config) {
+  if (configTransaction && configStaged) {
+    memcpy(&stagedConfig, &config, sizeof(Config));
+    return Nuki::CmdResult::Success;
+  }
+
   NewConfig newConfig;
   createNewConfig(&config, &newConfig);
   return setConfig(newConfig);
 }
 
 Nuki::CmdResult NukiLock::setFromAdvancedConfig(const AdvancedConfig config) {
+  if (configTransaction && advancedConfigStaged) {
+    memcpy(&stagedAdvancedConfig, &config, sizeof(AdvancedConfig));
+    return Nuki::CmdResult::Success;
+  }
+
   NewAdvancedConfig newConfig;
   createNewAdvancedConfig(&config, &newConfig);
   return setAdvancedConfig(newConfig);
@@ -707,7 +842,11 @@ Nuki::CmdResult NukiLock::setAdvancedConfig(NewAdvancedConfig newAdvancedConfig)
   memcpy(action.payload, &payload, sizeof(payload));
   action.payloadLen = sizeof(payload);
 
-  return executeAction(action);
+  Nuki::CmdResult result = executeAction(action);
+  if (result == Nuki::CmdResult::Success) {
+    advancedConfigCached = false;
+  }
+  return result;
 }
 
 
@@ -762,6 +901,7 @@ void NukiLock::handleReturnMessage(Command returnCode, unsigned char* data, uint
     case Command::KeyturnerStates : {
       printBuffer((byte*)data, dataLen, false, "keyturnerStates");
       memcpy(&keyTurnerState, data, sizeof(keyTurnerState));
+      stateReceived = true;
       #ifdef DEBUG_NUKI_READABLE_DATA
       logKeyturnerState(keyTurnerState);
       #endif
@@ -777,6 +917,8 @@ void NukiLock::handleReturnMessage(Command returnCode, unsigned char* data, uint
     }
     case Command::Config : {
       memcpy(&config, data, sizeof(config));
+      configCached = true;
+      configCacheUpdateCount = keyTurnerState.configUpdateCount;
       #ifdef DEBUG_NUKI_READABLE_DATA
       logConfig(config);
       #endif
@@ -785,6 +927,8 @@ void NukiLock::handleReturnMessage(Command returnCode, unsigned char* data, uint
     }
     case Command::AdvancedConfig : {
       memcpy(&advancedConfig, data, sizeof(advancedConfig));
+      advancedConfigCached = true;
+      advancedConfigCacheUpdateCount = keyTurnerState.configUpdateCount;
       #ifdef DEBUG_NUKI_READABLE_DATA
       logAdvancedConfig(advancedConfig);
       #endif
@@ -795,33 +939,115 @@ void NukiLock::handleReturnMessage(Command returnCode, unsigned char* data, uint
       printBuffer((byte*)data, dataLen, false, "timeControlEntry");
       TimeControlEntry timeControlEntry;
       memcpy(&timeControlEntry, data, sizeof(timeControlEntry));
-      listOfTimeControlEntries.push_back(timeControlEntry);
+      if (!timeControlEntryBuffer.tryPush(timeControlEntry)) {
+        log_w("Time control entry buffer full (%d entries), entry dropped", TIME_CONTROL_ENTRIES_BUFFER_SIZE);
+      }
       break;
     }
     case Command::LogEntry : {
       printBuffer((byte*)data, dataLen, false, "logEntry");
       LogEntry logEntry;
       memcpy(&logEntry, data, sizeof(logEntry));
-      listOfLogEntries.push_back(logEntry);
+      if (logEntrySink) {
+        logEntrySink->onLogEntry(logEntry);
+      }
+      if (!logEntryBuffer.tryPush(logEntry) && !logEntrySink) {
+        log_w("Log entry buffer full (%d entries), entry dropped", LOG_ENTRIES_BUFFER_SIZE);
+      }
+      nrOfReceivedLogEntries++;
       #ifdef DEBUG_NUKI_READABLE_DATA
       logLogEntry(logEntry);
       #endif
       break;
     }
-    case Command::AuthorizationEntry : {
-      printBuffer((byte*)data, dataLen, false, "authEntry");
-      AuthorizationEntry authEntry;
-      memcpy(&authEntry, data, sizeof(authEntry));
-      listOfAuthorizationEntries.push_back(authEntry);
-      logAuthorizationEntry(authEntry);
-      break;
-    }
     default:
       NukiBle::handleReturnMessage(returnCode, data, dataLen);
   }
   lastMsgCodeReceived = returnCode;
 }
 
+uint32_t NukiLock::lockActionAsync(const LockAction lockAction, const uint32_t nukiAppId, const uint8_t flags,
+                                   const char* nameSuffix, const uint8_t nameSuffixLen, Nuki::AsyncCmdCallback callback) {
+  //nameSuffix may not outlive this call, keep a copy until the command is executed
+  bool hasNameSuffix = nameSuffix != nullptr;
+  std::string suffix = hasNameSuffix ? std::string(nameSuffix, strnlen(nameSuffix, 19)) : std::string();
+  return executeAsync([this, lockAction, nukiAppId, flags, hasNameSuffix, suffix, nameSuffixLen]() {
+    return this->lockAction(lockAction, nukiAppId, flags, hasNameSuffix ? suffix.c_str() : nullptr, nameSuffixLen);
+  }, callback, Nuki::CommandPriority::High);
+}
+
+uint32_t NukiLock::keypadActionAsync(KeypadActionSource source, uint32_t code, KeypadAction keypadAction,
+                                     Nuki::AsyncCmdCallback callback) {
+  return executeAsync([this, source, code, keypadAction]() {
+    return this->keypadAction(source, code, keypadAction);
+  }, callback, Nuki::CommandPriority::High);
+}
+
+uint32_t NukiLock::requestKeyTurnerStateAsync(Nuki::AsyncPayloadCallback<KeyTurnerState> callback) {
+  return executeAsync([this, callback]() {
+    KeyTurnerState state;
+    Nuki::CmdResult result = requestKeyTurnerState(&state);
+    if (callback) {
+      callback(runningAsyncHandle, result, state);
+    }
+    return result;
+  });
+}
+
+uint32_t NukiLock::requestBatteryReportAsync(Nuki::AsyncPayloadCallback<BatteryReport> callback) {
+  return executeAsync([this, callback]() {
+    BatteryReport report;
+    Nuki::CmdResult result = requestBatteryReport(&report);
+    if (callback) {
+      callback(runningAsyncHandle, result, report);
+    }
+    return result;
+  });
+}
+
+uint32_t NukiLock::requestConfigAsync(Nuki::AsyncPayloadCallback<Config> callback) {
+  return executeAsync([this, callback]() {
+    Config config;
+    Nuki::CmdResult result = requestConfig(&config);
+    if (callback) {
+      callback(runningAsyncHandle, result, config);
+    }
+    return result;
+  });
+}
+
+uint32_t NukiLock::requestAdvancedConfigAsync(Nuki::AsyncPayloadCallback<AdvancedConfig> callback) {
+  return executeAsync([this, callback]() {
+    AdvancedConfig config;
+    Nuki::CmdResult result = requestAdvancedConfig(&config);
+    if (callback) {
+      callback(runningAsyncHandle, result, config);
+    }
+    return result;
+  });
+}
+
+uint32_t NukiLock::retrieveTimeControlEntriesAsync(Nuki::AsyncPayloadCallback<TimeControlEntryBuffer> callback) {
+  return executeAsync([this, callback]() {
+    Nuki::CmdResult result = retrieveTimeControlEntries();
+    if (callback) {
+      callback(runningAsyncHandle, result, timeControlEntryBuffer);
+    }
+    return result;
+  });
+}
+
+uint32_t NukiLock::retrieveLogEntriesAsync(const uint32_t startIndex, const uint16_t count, const uint8_t sortOrder,
+    const bool totalCount, Nuki::AsyncPayloadCallback<LogEntryBuffer> callback) {
+  return executeAsync([this, startIndex, count, sortOrder, totalCount, callback]() {
+    Nuki::CmdResult result = retrieveLogEntries(startIndex, count, sortOrder, totalCount);
+    if (callback) {
+      callback(runningAsyncHandle, result, logEntryBuffer);
+    }
+    return result;
+  });
+}
+
 void NukiLock::logErrorCode(uint8_t errorCode) {
   logLockErrorCode(errorCode);
 }
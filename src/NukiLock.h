@@ -2,10 +2,25 @@
 
 #include "NukiBle.h"
 #include "NukiLockConstants.h"
+#include "NukiLogSync.h"
+#include "NukiRingBuffer.h"
 #include "NukiLockUtils.h"
 
 namespace NukiLock {
 
+typedef Nuki::RingBuffer<LogEntry, LOG_ENTRIES_BUFFER_SIZE> LogEntryBuffer;
+typedef Nuki::RingBuffer<TimeControlEntry, TIME_CONTROL_ENTRIES_BUFFER_SIZE> TimeControlEntryBuffer;
+
+/**
+ * @brief Receives log entries one by one while they are downloaded, also during syncLogEntries().
+ * Called from the BLE receive task like Nuki::EntrySink: return quickly and DO NOT execute any BLE actions from it
+ */
+class LogEntrySink {
+  public:
+    virtual ~LogEntrySink() {};
+    virtual void onLogEntry(const LogEntry& entry) = 0;
+};
+
 class NukiLock : public Nuki::NukiBle {
   public:
     NukiLock(const std::string& deviceName, const uint32_t deviceId);
@@ -69,6 +84,33 @@ class NukiLock : public Nuki::NukiBle {
      */
     Nuki::CmdResult requestAdvancedConfig(AdvancedConfig* retrievedAdvancedConfig);
 
+    /**
+     * @brief Starts a config transaction. Until commitConfigTransaction() or abortConfigTransaction()
+     * is called, the config and advanced config are only read once from the lock and all config
+     * setters (setName(), enableAutoUnlatch(), ...) only change the local copy.
+     */
+    void beginConfigTransaction();
+
+    /**
+     * @brief Ends the config transaction and writes the changed config and/or advanced config to the
+     * lock with a single SetConfig/SetAdvancedConfig command each. Nothing is sent if nothing changed.
+     */
+    Nuki::CmdResult commitConfigTransaction();
+
+    /**
+     * @brief Ends the config transaction and drops all changes made since beginConfigTransaction()
+     */
+    void abortConfigTransaction();
+
+    /**
+     * @brief Drops the cached config and advanced config.
+     *
+     * requestConfig() and requestAdvancedConfig() serve the config from memory as long as the
+     * configUpdateCount in the latest received keyturner state is the same as when the config was read,
+     * note that the time fields in a cached config are not updated.
+     */
+    void invalidateConfigCache();
+
 
     /**
      * @brief Gets the current config from the lock, updates the name parameter and sends the
@@ -409,6 +451,13 @@ class NukiLock : public Nuki::NukiBle {
      */
     void getTimeControlEntries(std::list<TimeControlEntry>* timeControlEntries);
 
+    /**
+     * @brief Read-only view of the time control entries stored on the esp, without copying them.
+     * Valid until the next retrieveTimeControlEntries().
+     * dropped() is the number of entries beyond TIME_CONTROL_ENTRIES_BUFFER_SIZE that were received but not stored
+     */
+    const TimeControlEntryBuffer& getTimeControlEntryBuffer() const;
+
     /**
      * @brief Get the Log Entries stored on the esp. Only available after executing retreiveLogEntries.
      *
@@ -416,6 +465,21 @@ class NukiLock : public Nuki::NukiBle {
      */
     void getLogEntries(std::list<LogEntry>* requestedLogEntries);
 
+    /**
+     * @brief Read-only view of the Log Entries stored on the esp, without copying them.
+     * Iterate with a range based for loop or forEach(), valid until the next retrieveLogEntries().
+     * dropped() is the number of entries beyond LOG_ENTRIES_BUFFER_SIZE that were received but not stored
+     */
+    const LogEntryBuffer& getLogEntryBuffer() const;
+
+    /**
+     * @brief Set the sink receiving every log entry as soon as it is received, so big log downloads can be
+     * processed without keeping them. Entries beyond LOG_ENTRIES_BUFFER_SIZE only go to the sink
+     *
+     * @param sink sink for the log entries, nullptr to remove it
+     */
+    void setLogEntrySink(LogEntrySink* sink);
+
     /**
      * @brief Request the lock via BLE to send the log entries
      *
@@ -428,12 +492,38 @@ class NukiLock : public Nuki::NukiBle {
                                        const bool totalCount);
 
     /**
-     * @brief Request the lock via BLE to send the authorization entries
+     * @brief Retrieves only the log entries that are newer than the newest entry retrieved by a previous sync
+     * and adds them (oldest first) to the synced log entries buffer. The index of the newest synced entry is
+     * stored in preferences so a restart does not cause a full reload.
+     * Entries are requested in pages, the page size is reduced when the lock does not deliver a page in time.
      *
-     * @param offset Startindex of first log msg to be send
-     * @param count The number of log entries to be read, starting at the specified start index.
+     * @param maxEntries max number of entries to retrieve, on the first sync or when more entries are new
+     * only the most recent maxEntries are retrieved
+     */
+    Nuki::CmdResult syncLogEntries(const uint16_t maxEntries = LOG_SYNC_BUFFER_SIZE);
+
+    /**
+     * @brief Get the log entries retrieved by syncLogEntries(), oldest first.
+     * When more than LOG_SYNC_BUFFER_SIZE entries are synced the oldest are dropped.
+     *
+     * @param syncedLogEntries list to store the synced log entries
+     */
+    void getSyncedLogEntries(std::list<LogEntry>* syncedLogEntries);
+
+    /**
+     * @brief Removes all entries from the synced log entries buffer, the last synced index is kept
+     */
+    void clearSyncedLogEntries();
+
+    /**
+     * @brief Returns the index of the newest log entry retrieved by syncLogEntries()
+     */
+    uint32_t getLastSyncedLogIndex();
+
+    /**
+     * @brief Forgets the last synced index, the next sync starts again from the most recent entries
      */
-    Nuki::CmdResult retrieveAuthorizationEntries(const uint16_t offset, const uint16_t count);
+    void resetLogSync();
 
     /**
      * @brief Deletes the authorization entry from the lock
@@ -483,10 +573,41 @@ class NukiLock : public Nuki::NukiBle {
      */
     const ErrorCode getLastError() const;
 
+    /**
+     * @brief Non-blocking version of lockAction(), the action is queued and executed by the worker task
+     *
+     * @param callback optional, called from the worker task when the action has finished
+     * @return handle identifying the queued command, 0 if the command could not be queued
+     */
+    uint32_t lockActionAsync(const LockAction lockAction, const uint32_t nukiAppId = 1, const uint8_t flags = 0,
+                             const char* nameSuffix = nullptr, const uint8_t nameSuffixLen = 0,
+                             Nuki::AsyncCmdCallback callback = nullptr);
+
+    /**
+     * @brief Non-blocking version of keypadAction()
+     */
+    uint32_t keypadActionAsync(KeypadActionSource source, uint32_t code, KeypadAction keypadAction,
+                               Nuki::AsyncCmdCallback callback = nullptr);
+
+    /**
+     * @brief Non-blocking versions of the request methods, the callback receives the retrieved data
+     * and is called from the worker task
+     *
+     * @return handle identifying the queued command, 0 if the command could not be queued
+     */
+    uint32_t requestKeyTurnerStateAsync(Nuki::AsyncPayloadCallback<KeyTurnerState> callback);
+    uint32_t requestBatteryReportAsync(Nuki::AsyncPayloadCallback<BatteryReport> callback);
+    uint32_t requestConfigAsync(Nuki::AsyncPayloadCallback<Config> callback);
+    uint32_t requestAdvancedConfigAsync(Nuki::AsyncPayloadCallback<AdvancedConfig> callback);
+    uint32_t retrieveTimeControlEntriesAsync(Nuki::AsyncPayloadCallback<TimeControlEntryBuffer> callback);
+    uint32_t retrieveLogEntriesAsync(const uint32_t startIndex, const uint16_t count, const uint8_t sortOrder,
+                                     const bool totalCount, Nuki::AsyncPayloadCallback<LogEntryBuffer> callback);
+
     virtual void logErrorCode(uint8_t errorCode) override;
 
   protected:
     void handleReturnMessage(Command returnCode, unsigned char* data, uint16_t dataLen) override;
+    void onCredentialsDeleted() override;
 
 
   private:
@@ -499,12 +620,29 @@ class NukiLock : public Nuki::NukiBle {
 
     KeyTurnerState keyTurnerState;
     BatteryReport batteryReport;
-    std::list<TimeControlEntry> listOfTimeControlEntries;
-    std::list<LogEntry> listOfLogEntries;
-    std::list<AuthorizationEntry> listOfAuthorizationEntries;
+    TimeControlEntryBuffer timeControlEntryBuffer;
+    LogEntryBuffer logEntryBuffer;
+    uint16_t nrOfReceivedLogEntries = 0;
+    Nuki::LogSync<LogEntry> logSync{*this};
+    LogEntrySink* logEntrySink = nullptr;
 
     Config config;
     AdvancedConfig advancedConfig;
+
+    bool configTransaction = false;
+    bool configStaged = false;
+    bool advancedConfigStaged = false;
+    Config stagedConfig;
+    Config originalConfig;
+    AdvancedConfig stagedAdvancedConfig;
+    AdvancedConfig originalAdvancedConfig;
+
+    bool stateReceived = false;
+    bool configCached = false;
+    bool advancedConfigCached = false;
+    uint8_t configCacheUpdateCount = 0;
+    uint8_t advancedConfigCacheUpdateCount = 0;
+    bool isConfigCacheValid(const bool cached, const uint8_t cacheUpdateCount) const;
 };
 
 }
\ No newline at end of file
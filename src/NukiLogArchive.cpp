@@ -0,0 +1,494 @@
+#include "NukiLogArchive.h"
+#include "NukiCrc.h"
+#include <algorithm>
+
+#define LOG_ARCHIVE_SEGMENT_EXTENSION ".seg"
+#define LOG_ARCHIVE_INDEX_EXTENSION ".idx"
+#define LOG_ARCHIVE_CRC_SIZE 2
+
+namespace Nuki {
+
+uint32_t toLogTimestamp(const uint16_t year, const uint8_t month, const uint8_t day,
+                        const uint8_t hour, const uint8_t minute, const uint8_t second) {
+  if (year < 1970 || month < 1 || month > 12) {
+    return 0;
+  }
+  //days since 1970-01-01 of the proleptic gregorian calendar, with the year starting in march
+  uint32_t y = year - (month <= 2 ? 1 : 0);
+  uint32_t era = y / 400;
+  uint32_t yearOfEra = y - era * 400;
+  uint32_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  uint32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  uint32_t days = era * 146097 + dayOfEra - 719468;
+  return days * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+LogArchiveStore::LogArchiveStore(fs::FS& fileSystem, const char* directory, const size_t entrySize,
+                                 const uint16_t segmentRecords, const uint8_t maxSegments)
+  : fileSystem(fileSystem),
+    directory(directory),
+    entrySize(entrySize),
+    recordSize(entrySize + LOG_ARCHIVE_CRC_SIZE),
+    segmentRecords(segmentRecords > 0 ? segmentRecords : 1),
+    maxSegments(maxSegments > 1 ? maxSegments : 2) {
+}
+
+LogArchiveStore::~LogArchiveStore() {
+  vSemaphoreDelete(archiveSemaphore);
+}
+
+bool LogArchiveStore::begin() {
+  xSemaphoreTake(archiveSemaphore, portMAX_DELAY);
+  segments.clear();
+  epochStart = 0;
+  nextSequence = 0;
+  stats = {};
+
+  if (!fileSystem.exists(directory.c_str()) && !fileSystem.mkdir(directory.c_str())) {
+    log_w("Log archive directory %s could not be created", directory.c_str());
+    xSemaphoreGive(archiveSemaphore);
+    return false;
+  }
+  fs::File dir = fileSystem.open(directory.c_str());
+  if (!dir || !dir.isDirectory()) {
+    log_w("Log archive directory %s could not be read", directory.c_str());
+    xSemaphoreGive(archiveSemaphore);
+    return false;
+  }
+
+  std::vector<uint32_t> sequences;
+  fs::File file = dir.openNextFile();
+  while (file) {
+    //depending on the core version name() returns the name with or without the path
+    std::string name = file.name();
+    name = name.substr(name.find_last_of('/') + 1);
+    file.close();
+    if (name.size() == 8 + strlen(LOG_ARCHIVE_SEGMENT_EXTENSION) && name.compare(8, std::string::npos, LOG_ARCHIVE_SEGMENT_EXTENSION) == 0) {
+      sequences.push_back(strtoul(name.substr(0, 8).c_str(), nullptr, 16));
+    }
+    file = dir.openNextFile();
+  }
+  dir.close();
+  std::sort(sequences.begin(), sequences.end());
+
+  for (uint32_t sequence : sequences) {
+    Segment segment;
+    if (loadSegment(sequence, &segment) && segment.count > 0) {
+      segments.push_back(segment);
+      stats.records += segment.count;
+    } else {
+      removeSegment(sequence);
+    }
+    nextSequence = sequence + 1;
+  }
+  //only the newest segment can still be written to
+  for (size_t i = 0; i + 1 < segments.size(); i++) {
+    if (!segments[i].sealed) {
+      sealSegment(segments[i]);
+    }
+  }
+  //the indexes restart after a reset of the lock, the current epoch begins with the last restart
+  for (size_t i = 1; i < segments.size(); i++) {
+    if (segments[i].firstIndex <= segments[i - 1].lastIndex) {
+      epochStart = i;
+    }
+  }
+  stats.segments = segments.size();
+
+  #ifdef DEBUG_NUKI_COMMUNICATION
+  log_d("Log archive loaded, %d segments, %d records, index %d .. %d", segments.size(), stats.records,
+        segments.empty() ? 0 : segments.front().firstIndex, segments.empty() ? 0 : segments.back().lastIndex);
+  #endif
+  xSemaphoreGive(archiveSemaphore);
+  return true;
+}
+
+void LogArchiveStore::clear() {
+  xSemaphoreTake(archiveSemaphore, portMAX_DELAY);
+  for (const Segment& segment : segments) {
+    removeSegment(segment.sequence);
+  }
+  segments.clear();
+  epochStart = 0;
+  stats.segments = 0;
+  stats.records = 0;
+  xSemaphoreGive(archiveSemaphore);
+}
+
+uint32_t LogArchiveStore::getLastIndex() {
+  xSemaphoreTake(archiveSemaphore, portMAX_DELAY);
+  uint32_t index = segments.size() > epochStart ? segments.back().lastIndex : 0;
+  xSemaphoreGive(archiveSemaphore);
+  return index;
+}
+
+uint32_t LogArchiveStore::getFirstIndex() {
+  xSemaphoreTake(archiveSemaphore, portMAX_DELAY);
+  uint32_t index = segments.size() > epochStart ? segments[epochStart].firstIndex : 0;
+  xSemaphoreGive(archiveSemaphore);
+  return index;
+}
+
+uint32_t LogArchiveStore::size() {
+  xSemaphoreTake(archiveSemaphore, portMAX_DELAY);
+  uint32_t records = stats.records;
+  xSemaphoreGive(archiveSemaphore);
+  return records;
+}
+
+LogArchiveStats LogArchiveStore::getStats() {
+  xSemaphoreTake(archiveSemaphore, portMAX_DELAY);
+  LogArchiveStats result = stats;
+  xSemaphoreGive(archiveSemaphore);
+  return result;
+}
+
+size_t LogArchiveStore::appendEntries(const uint8_t* entries, const size_t count) {
+  xSemaphoreTake(archiveSemaphore, portMAX_DELAY);
+  fs::File file;
+  size_t appended = 0;
+  uint8_t record[recordSize];
+
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t* entry = &entries[i * entrySize];
+    if (segments.size() > epochStart && entryIndex(entry) <= segments.back().lastIndex) {
+      if (entryTimestamp(entry) <= getEpochMaxTimestamp()) {
+        //already archived or out of order
+        continue;
+      }
+      //a lower index logged after all archived entries: the log of the lock was reset
+      if (file) {
+        file.close();
+      }
+      beginEpoch();
+    }
+    if (segments.empty() || segments.back().sealed) {
+      if (file) {
+        file.close();
+      }
+      if (!startSegment()) {
+        break;
+      }
+    }
+    if (!file) {
+      file = fileSystem.open(segmentPath(segments.back().sequence, LOG_ARCHIVE_SEGMENT_EXTENSION).c_str(), FILE_APPEND);
+      if (!file) {
+        log_w("Log archive segment %d could not be opened", segments.back().sequence);
+        break;
+      }
+    }
+
+    memcpy(record, entry, entrySize);
+    uint16_t crc = crc16CcittFalse(entry, entrySize);
+    memcpy(&record[entrySize], &crc, LOG_ARCHIVE_CRC_SIZE);
+    if (file.write(record, recordSize) != recordSize) {
+      //the segment index ends before the incomplete record, continue in a new segment next time
+      log_w("Log archive write failed, segment %d sealed", segments.back().sequence);
+      file.close();
+      sealSegment(segments.back());
+      break;
+    }
+    addToSegment(segments.back(), entry);
+    stats.records++;
+    stats.recordsWritten++;
+    appended++;
+
+    if (segments.back().count >= segmentRecords) {
+      file.close();
+      sealSegment(segments.back());
+    }
+  }
+  if (file) {
+    file.close();
+  }
+  xSemaphoreGive(archiveSemaphore);
+  return appended;
+}
+
+void LogArchiveStore::startEpoch() {
+  xSemaphoreTake(archiveSemaphore, portMAX_DELAY);
+  beginEpoch();
+  xSemaphoreGive(archiveSemaphore);
+}
+
+size_t LogArchiveStore::query(const QueryKey key, const uint32_t from, const uint32_t to,
+                              std::function<bool(const uint8_t* entry)> callback) {
+  if (from > to) {
+    return 0;
+  }
+  //indexes are only unique within the current epoch, timestamps cover the whole archive
+  std::vector<Segment> candidates;
+  xSemaphoreTake(archiveSemaphore, portMAX_DELAY);
+  for (size_t i = key == QueryKey::Index ? epochStart : 0; i < segments.size(); i++) {
+    const Segment& segment = segments[i];
+    if (key == QueryKey::Index) {
+      if (segment.firstIndex > to) {
+        break;
+      }
+      if (segment.lastIndex < from) {
+        continue;
+      }
+    } else if (segment.maxTimestamp < from || segment.minTimestamp > to) {
+      continue;
+    }
+    candidates.push_back(segment);
+  }
+  xSemaphoreGive(archiveSemaphore);
+
+  //every chunk is read with the archive locked and passed to callback after unlocking, so callback can use the archive
+  size_t delivered = 0;
+  uint32_t corruptRecords = 0;
+  bool done = false;
+  uint8_t chunk[LOG_ARCHIVE_CHUNK_RECORDS * recordSize];
+
+  for (const Segment& segment : candidates) {
+    if (done) {
+      break;
+    }
+    int32_t position = -1;
+    while (!done) {
+      uint16_t chunkRecords = 0;
+      xSemaphoreTake(archiveSemaphore, portMAX_DELAY);
+      //the segment may have been rotated out or cleared in the meantime
+      if (!segments.empty() && segment.sequence >= segments.front().sequence && segment.sequence <= segments.back().sequence) {
+        fs::File file = fileSystem.open(segmentPath(segment.sequence, LOG_ARCHIVE_SEGMENT_EXTENSION).c_str(), FILE_READ);
+        if (!file) {
+          log_w("Log archive segment %d could not be opened", segment.sequence);
+        } else {
+          if (position < 0) {
+            position = key == QueryKey::Index ? lowerBound(file, segment, from) : 0;
+          }
+          if (position < segment.count) {
+            chunkRecords = segment.count - position < LOG_ARCHIVE_CHUNK_RECORDS ? segment.count - position : LOG_ARCHIVE_CHUNK_RECORDS;
+            if (!file.seek(position * recordSize) || file.read(chunk, chunkRecords * recordSize) != chunkRecords * recordSize) {
+              log_w("Log archive segment %d could not be read", segment.sequence);
+              chunkRecords = 0;
+            }
+          }
+          file.close();
+        }
+      }
+      xSemaphoreGive(archiveSemaphore);
+      if (chunkRecords == 0) {
+        break;
+      }
+      position += chunkRecords;
+
+      for (uint16_t i = 0; i < chunkRecords; i++) {
+        const uint8_t* record = &chunk[i * recordSize];
+        if (!isValidRecord(record)) {
+          corruptRecords++;
+          continue;
+        }
+        uint32_t value = key == QueryKey::Index ? entryIndex(record) : entryTimestamp(record);
+        if (key == QueryKey::Index && value > to) {
+          done = true;
+          break;
+        }
+        if (value >= from && value <= to) {
+          delivered++;
+          if (!callback(record)) {
+            done = true;
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  if (corruptRecords > 0) {
+    xSemaphoreTake(archiveSemaphore, portMAX_DELAY);
+    stats.corruptRecords += corruptRecords;
+    xSemaphoreGive(archiveSemaphore);
+  }
+  return delivered;
+}
+
+std::string LogArchiveStore::segmentPath(const uint32_t sequence, const char* extension) const {
+  char name[9];
+  snprintf(name, sizeof(name), "%08x", sequence);
+  return directory + "/" + name + extension;
+}
+
+bool LogArchiveStore::loadSegment(const uint32_t sequence, Segment* segment) {
+  fs::File file = fileSystem.open(segmentPath(sequence, LOG_ARCHIVE_SEGMENT_EXTENSION).c_str(), FILE_READ);
+  if (!file) {
+    return false;
+  }
+
+  //sealed segments have an index file with their summary
+  std::string indexPath = segmentPath(sequence, LOG_ARCHIVE_INDEX_EXTENSION);
+  if (fileSystem.exists(indexPath.c_str())) {
+    fs::File indexFile = fileSystem.open(indexPath.c_str(), FILE_READ);
+    uint8_t data[sizeof(Segment) + LOG_ARCHIVE_CRC_SIZE];
+    bool valid = indexFile && indexFile.read(data, sizeof(data)) == sizeof(data);
+    indexFile.close();
+    uint16_t crc;
+    memcpy(&crc, &data[sizeof(Segment)], LOG_ARCHIVE_CRC_SIZE);
+    if (valid && crc == crc16CcittFalse(data, sizeof(Segment))) {
+      memcpy(segment, data, sizeof(Segment));
+      if (segment->sequence == sequence && file.size() >= segment->count * recordSize) {
+        file.close();
+        return true;
+      }
+    }
+  }
+
+  //segment written last, without valid index file or shorter than its index: rebuild the summary from its records
+  //an incomplete record at the end is left from a write interrupted by a power loss
+  size_t fileRecords = file.size() / recordSize;
+  bool incompleteRecord = file.size() % recordSize != 0;
+  bool damaged = false;
+  *segment = {sequence, 0, 0, 0, 0, 0, false};
+
+  uint8_t chunk[LOG_ARCHIVE_CHUNK_RECORDS * recordSize];
+  size_t position = 0;
+  while (position < fileRecords && !damaged) {
+    size_t chunkRecords = fileRecords - position < LOG_ARCHIVE_CHUNK_RECORDS ? fileRecords - position : LOG_ARCHIVE_CHUNK_RECORDS;
+    if (file.read(chunk, chunkRecords * recordSize) != chunkRecords * recordSize) {
+      damaged = true;
+      break;
+    }
+    for (size_t i = 0; i < chunkRecords; i++) {
+      const uint8_t* record = &chunk[i * recordSize];
+      //records after a bad or out of order record are not used
+      if (!isValidRecord(record) || (segment->count > 0 && entryIndex(record) <= segment->lastIndex)) {
+        damaged = true;
+        break;
+      }
+      addToSegment(*segment, record);
+    }
+    position += chunkRecords;
+  }
+  file.close();
+
+  if (damaged || incompleteRecord) {
+    log_w("Log archive segment %d damaged, %d of %d records used", sequence, segment->count, fileRecords + (incompleteRecord ? 1 : 0));
+    stats.corruptRecords += fileRecords - segment->count + (incompleteRecord ? 1 : 0);
+    damaged = true;
+  }
+  if (segment->count > 0 && (damaged || segment->count >= segmentRecords)) {
+    sealSegment(*segment);
+  }
+  return true;
+}
+
+bool LogArchiveStore::startSegment() {
+  //wear is spread by rotation: the oldest segment is deleted as a whole instead of rewriting records
+  while (segments.size() >= maxSegments) {
+    stats.records -= segments.front().count;
+    removeSegment(segments.front().sequence);
+    segments.erase(segments.begin());
+    if (epochStart > 0) {
+      epochStart--;
+    }
+    stats.segmentsRotated++;
+  }
+  Segment segment = {nextSequence++, 0, 0, 0, 0, 0, false};
+  segments.push_back(segment);
+  stats.segments = segments.size();
+  return true;
+}
+
+void LogArchiveStore::beginEpoch() {
+  log_w("Log archive: log indexes restarted after index %d, new epoch", segments.empty() ? 0 : segments.back().lastIndex);
+  if (!segments.empty() && !segments.back().sealed) {
+    if (segments.back().count == 0) {
+      removeSegment(segments.back().sequence);
+      segments.pop_back();
+      stats.segments = segments.size();
+    } else {
+      sealSegment(segments.back());
+    }
+  }
+  epochStart = segments.size();
+}
+
+uint32_t LogArchiveStore::getEpochMaxTimestamp() const {
+  uint32_t maxTimestamp = 0;
+  for (size_t i = epochStart; i < segments.size(); i++) {
+    maxTimestamp = segments[i].maxTimestamp > maxTimestamp ? segments[i].maxTimestamp : maxTimestamp;
+  }
+  return maxTimestamp;
+}
+
+void LogArchiveStore::sealSegment(Segment& segment) {
+  segment.sealed = true;
+  uint8_t data[sizeof(Segment) + LOG_ARCHIVE_CRC_SIZE];
+  memcpy(data, &segment, sizeof(Segment));
+  uint16_t crc = crc16CcittFalse(data, sizeof(Segment));
+  memcpy(&data[sizeof(Segment)], &crc, LOG_ARCHIVE_CRC_SIZE);
+
+  fs::File indexFile = fileSystem.open(segmentPath(segment.sequence, LOG_ARCHIVE_INDEX_EXTENSION).c_str(), FILE_WRITE);
+  if (!indexFile || indexFile.write(data, sizeof(data)) != sizeof(data)) {
+    //the summary is rebuilt from the records on the next begin()
+    log_w("Log archive index of segment %d could not be written", segment.sequence);
+  }
+  indexFile.close();
+}
+
+void LogArchiveStore::removeSegment(const uint32_t sequence) {
+  std::string indexPath = segmentPath(sequence, LOG_ARCHIVE_INDEX_EXTENSION);
+  if (fileSystem.exists(indexPath.c_str())) {
+    fileSystem.remove(indexPath.c_str());
+  }
+  fileSystem.remove(segmentPath(sequence, LOG_ARCHIVE_SEGMENT_EXTENSION).c_str());
+}
+
+void LogArchiveStore::addToSegment(Segment& segment, const uint8_t* entry) {
+  uint32_t index = entryIndex(entry);
+  uint32_t timestamp = entryTimestamp(entry);
+  if (segment.count == 0) {
+    segment.firstIndex = index;
+    segment.minTimestamp = timestamp;
+    segment.maxTimestamp = timestamp;
+  }
+  //timestamps are not strictly ascending, the lock clock can be set back
+  segment.minTimestamp = timestamp < segment.minTimestamp ? timestamp : segment.minTimestamp;
+  segment.maxTimestamp = timestamp > segment.maxTimestamp ? timestamp : segment.maxTimestamp;
+  segment.lastIndex = index;
+  segment.count++;
+}
+
+bool LogArchiveStore::isValidRecord(const uint8_t* record) {
+  uint16_t crc;
+  memcpy(&crc, &record[entrySize], LOG_ARCHIVE_CRC_SIZE);
+  return crc == crc16CcittFalse(record, entrySize);
+}
+
+uint32_t LogArchiveStore::entryIndex(const uint8_t* entry) const {
+  uint32_t index;
+  memcpy(&index, entry, sizeof(index));
+  return index;
+}
+
+uint32_t LogArchiveStore::entryTimestamp(const uint8_t* entry) const {
+  //year (2 bytes), month, day, hour, minute, second after the index
+  uint16_t year;
+  memcpy(&year, &entry[4], sizeof(year));
+  return toLogTimestamp(year, entry[6], entry[7], entry[8], entry[9], entry[10]);
+}
+
+uint16_t LogArchiveStore::lowerBound(fs::File& file, const Segment& segment, const uint32_t index) {
+  //indexes are ascending within a segment, find the first record with an index >= index
+  if (index <= segment.firstIndex) {
+    return 0;
+  }
+  uint16_t low = 0;
+  uint16_t high = segment.count;
+  uint8_t entry[sizeof(uint32_t)];
+  while (low < high) {
+    uint16_t middle = low + (high - low) / 2;
+    if (!file.seek(middle * recordSize) || file.read(entry, sizeof(entry)) != sizeof(entry)) {
+      return 0;
+    }
+    if (entryIndex(entry) < index) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+} // namespace Nuki
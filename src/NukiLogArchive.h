@@ -0,0 +1,241 @@
+#pragma once
+
+/**
+ * @file NukiLogArchive.h
+ * Append-only archive of lock/opener log entries on a file system (LittleFS, SPIFFS, SD), to keep months of
+ * history on the ESP32 and query it without asking the lock again.
+ *
+ * The entries are stored as fixed-width records (the packed LogEntry followed by a crc) in segment files of
+ * a fixed number of records. Entries are only appended in order of their index, a full segment is sealed and never
+ * written again, and when the maximum number of segments is reached the oldest segment file is deleted as a whole.
+ * Existing data is never rewritten, which keeps the flash wear to the appended data itself.
+ * The first/last index and the timestamp range of every segment are kept in memory (and in a small index file per
+ * sealed segment), so range queries only read the segments that can hold matching entries and find the first
+ * entry of an index range with a binary search.
+ * After a reset of the lock its log indexes start again at 1. The archived entries are kept and the entries logged
+ * after the reset are appended as a new epoch, index based access (getLastIndex(), queryByIndex()) only covers the
+ * current epoch while time queries cover the whole archive.
+ *
+ * Created on: 2022
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * This library implements the communication from an ESP32 via BLE to a Nuki smart lock.
+ * Based on the Nuki Smart Lock API V2.2.1
+ * https://developer.nuki.io/page/nuki-smart-lock-api-2/2/
+ *
+ */
+
+#include "Arduino.h"
+#include "FS.h"
+#include "NukiDataTypes.h"
+#include <esp_task_wdt.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define LOG_ARCHIVE_DIRECTORY "/nukilog"
+#define LOG_ARCHIVE_SEGMENT_RECORDS 512   //records per segment file
+#define LOG_ARCHIVE_MAX_SEGMENTS 16       //oldest segment is deleted when a new one would exceed this
+#define LOG_ARCHIVE_CHUNK_RECORDS 16      //records read or buffered for writing at once
+#define LOG_ARCHIVE_SYNC_MAX_ENTRIES 100  //max entries retrieved from the lock per syncFrom() call
+#define LOG_ARCHIVE_SYNC_PAGE_SIZE 20     //entries retrieved per request in syncFrom()
+
+namespace Nuki {
+
+struct LogArchiveStats {
+  uint8_t segments;
+  uint32_t records;           // records in the archive
+  uint32_t recordsWritten;    // records appended since begin()
+  uint32_t segmentsRotated;   // oldest segments deleted to make room since begin()
+  uint32_t corruptRecords;    // records skipped because of a bad crc (e.g. after a power loss)
+};
+
+/**
+ * @brief Returns the seconds since 1970-01-01 of a date and time as logged by the lock (UTC), 0 before 1970
+ */
+uint32_t toLogTimestamp(const uint16_t year, const uint8_t month, const uint8_t day,
+                        const uint8_t hour, const uint8_t minute, const uint8_t second);
+
+/**
+ * @brief Archive of fixed size log entries, the entry type is handled by LogArchive<TLogEntry>.
+ * The entries must start with the uint32_t index followed by the timestamp (year, month, day, hour, minute, second)
+ * like NukiLock::LogEntry and NukiOpener::LogEntry
+ */
+class LogArchiveStore {
+  public:
+    enum class QueryKey : uint8_t {
+      Index,
+      Timestamp
+    };
+
+    /**
+     * @param fileSystem file system to store the archive on, must be mounted before begin() (e.g. LittleFS.begin(true))
+     * @param directory directory of the segment files, only used by this archive
+     * @param entrySize size of one log entry
+     * @param segmentRecords records per segment file
+     * @param maxSegments max number of segment files
+     */
+    LogArchiveStore(fs::FS& fileSystem, const char* directory, const size_t entrySize,
+                    const uint16_t segmentRecords, const uint8_t maxSegments);
+    ~LogArchiveStore();
+
+    /**
+     * @brief Loads the segment index, scans the segment written last and repairs it after a power loss
+     *
+     * @return false if the directory can not be created or read
+     */
+    bool begin();
+
+    /**
+     * @brief Deletes all archived entries
+     */
+    void clear();
+
+    /**
+     * @brief Index of the newest archived entry of the current epoch, 0 if the epoch has no entries yet.
+     * Entries up to this index never have to be retrieved from the lock again
+     */
+    uint32_t getLastIndex();
+
+    /**
+     * @brief Index of the oldest archived entry of the current epoch, 0 if the epoch has no entries yet
+     */
+    uint32_t getFirstIndex();
+
+    /**
+     * @brief Number of archived entries
+     */
+    uint32_t size();
+
+    LogArchiveStats getStats();
+
+  protected:
+    /**
+     * @brief Appends entries with an index higher than the newest archived entry, other entries are skipped.
+     * An entry with a lower index that is newer than all entries of the current epoch was logged after a reset
+     * of the lock, it starts a new epoch
+     *
+     * @param entries count entries of entrySize bytes, in order of their index
+     * @return number of entries appended
+     */
+    size_t appendEntries(const uint8_t* entries, const size_t count);
+
+    /**
+     * @brief Calls callback with every entry with a key from .. to (inclusive), in order of their index.
+     * Index queries only return entries of the current epoch.
+     * The archive is not locked while callback runs, entries appended during the query are not returned
+     *
+     * @param callback called with the entry data, return false to stop the query
+     * @return number of entries passed to callback
+     */
+    size_t query(const QueryKey key, const uint32_t from, const uint32_t to, std::function<bool(const uint8_t* entry)> callback);
+
+    /**
+     * @brief Starts a new epoch after a reset of the lock, the next appended entry may have any index
+     */
+    void startEpoch();
+
+  private:
+    struct __attribute__((packed)) Segment {
+      uint32_t sequence;
+      uint16_t count;
+      uint32_t firstIndex;
+      uint32_t lastIndex;
+      uint32_t minTimestamp;
+      uint32_t maxTimestamp;
+      bool sealed;
+    };
+
+    std::string segmentPath(const uint32_t sequence, const char* extension) const;
+    bool loadSegment(const uint32_t sequence, Segment* segment);
+    bool startSegment();
+    void beginEpoch();
+    uint32_t getEpochMaxTimestamp() const;
+    void sealSegment(Segment& segment);
+    void removeSegment(const uint32_t sequence);
+    void addToSegment(Segment& segment, const uint8_t* entry);
+    bool isValidRecord(const uint8_t* record);
+    uint32_t entryIndex(const uint8_t* entry) const;
+    uint32_t entryTimestamp(const uint8_t* entry) const;
+    uint16_t lowerBound(fs::File& file, const Segment& segment, const uint32_t index);
+
+    fs::FS& fileSystem;
+    std::string directory;
+    size_t entrySize;
+    size_t recordSize;
+    uint16_t segmentRecords;
+    uint8_t maxSegments;
+
+    std::vector<Segment> segments;
+    size_t epochStart = 0;  //first segment of the current epoch
+    uint32_t nextSequence = 0;
+    LogArchiveStats stats = {};
+    SemaphoreHandle_t archiveSemaphore = xSemaphoreCreateMutex();
+};
+
+/**
+ * @brief Archive of NukiLock::LogEntry or NukiOpener::LogEntry records, e.g.
+ * `Nuki::LogArchive<NukiLock::LogEntry> logArchive{LittleFS};`
+ */
+template <typename TLogEntry>
+class LogArchive : public LogArchiveStore {
+  public:
+    LogArchive(fs::FS& fileSystem, const char* directory = LOG_ARCHIVE_DIRECTORY,
+               const uint16_t segmentRecords = LOG_ARCHIVE_SEGMENT_RECORDS, const uint8_t maxSegments = LOG_ARCHIVE_MAX_SEGMENTS)
+      : LogArchiveStore(fileSystem, directory, sizeof(TLogEntry), segmentRecords, maxSegments) {
+      static_assert(offsetof(TLogEntry, index) == 0 && offsetof(TLogEntry, timeStampYear) == 4, "Unsupported log entry layout");
+    }
+
+    /**
+     * @brief Appends an entry if its index is higher than the newest archived entry
+     *
+     * @return true if the entry was appended
+     */
+    bool append(const TLogEntry& entry) {
+      return appendEntries((const uint8_t*)&entry, 1) == 1;
+    }
+
+    /**
+     * @brief Appends entries in ascending order of their index (e.g. getLogEntryBuffer() after retrieving
+     * with sortOrder 0), entries that are already archived are skipped
+     *
+     * @return number of entries appended
+     */
+    template <typename TContainer>
+    size_t appendAll(const TContainer& entries);
+
+    /**
+     * @brief Calls callback with the archived entries of the current epoch with an index from fromIndex .. toIndex
+     * (inclusive), oldest first. callback may use the archive, e.g. append entries
+     *
+     * @param callback return false to stop the query
+     * @return number of entries passed to callback
+     */
+    size_t queryByIndex(const uint32_t fromIndex, const uint32_t toIndex, std::function<bool(const TLogEntry&)> callback);
+
+    /**
+     * @brief Calls callback with the archived entries logged from fromTimestamp .. toTimestamp (inclusive, seconds since
+     * 1970 UTC, see toLogTimestamp()), in order of their index
+     */
+    size_t queryByTime(const uint32_t fromTimestamp, const uint32_t toTimestamp, std::function<bool(const TLogEntry&)> callback);
+
+    /**
+     * @brief Retrieves the entries newer than the newest archived entry from the lock/opener and appends them,
+     * entries that are already archived are never requested again.
+     * When the log of the lock was reset a new epoch is started and its entries are retrieved from index 1
+     *
+     * @param device paired NukiLock::NukiLock or NukiOpener::NukiOpener
+     * @param maxEntries max number of entries to retrieve in this call, call again to continue
+     * @return Success when all retrieved pages were archived, otherwise the result of the failed retrieval
+     * (the entries received until then are archived)
+     */
+    template <typename TDevice>
+    Nuki::CmdResult syncFrom(TDevice& device, const uint16_t maxEntries = LOG_ARCHIVE_SYNC_MAX_ENTRIES);
+
+  private:
+    size_t queryEntries(const QueryKey key, const uint32_t from, const uint32_t to, std::function<bool(const TLogEntry&)>& callback);
+};
+
+} // namespace Nuki
+
+#include "NukiLogArchive.hpp"
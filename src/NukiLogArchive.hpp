@@ -0,0 +1,104 @@
+#pragma once
+
+namespace Nuki {
+
+template <typename TLogEntry>
+template <typename TContainer>
+size_t LogArchive<TLogEntry>::appendAll(const TContainer& entries) {
+  //written in chunks, each chunk with one open/write/close of the segment file
+  TLogEntry chunk[LOG_ARCHIVE_CHUNK_RECORDS];
+  size_t chunkCount = 0;
+  size_t appended = 0;
+  for (const TLogEntry& entry : entries) {
+    chunk[chunkCount++] = entry;
+    if (chunkCount == LOG_ARCHIVE_CHUNK_RECORDS) {
+      appended += appendEntries((const uint8_t*)chunk, chunkCount);
+      chunkCount = 0;
+    }
+  }
+  if (chunkCount > 0) {
+    appended += appendEntries((const uint8_t*)chunk, chunkCount);
+  }
+  return appended;
+}
+
+template <typename TLogEntry>
+size_t LogArchive<TLogEntry>::queryByIndex(const uint32_t fromIndex, const uint32_t toIndex,
+    std::function<bool(const TLogEntry&)> callback) {
+  return queryEntries(QueryKey::Index, fromIndex, toIndex, callback);
+}
+
+template <typename TLogEntry>
+size_t LogArchive<TLogEntry>::queryByTime(const uint32_t fromTimestamp, const uint32_t toTimestamp,
+    std::function<bool(const TLogEntry&)> callback) {
+  return queryEntries(QueryKey::Timestamp, fromTimestamp, toTimestamp, callback);
+}
+
+template <typename TLogEntry>
+size_t LogArchive<TLogEntry>::queryEntries(const QueryKey key, const uint32_t from, const uint32_t to,
+    std::function<bool(const TLogEntry&)>& callback) {
+  return query(key, from, to, [&callback](const uint8_t* data) {
+    //records are not aligned in the read buffer
+    TLogEntry entry;
+    memcpy(&entry, data, sizeof(TLogEntry));
+    return callback(entry);
+  });
+}
+
+template <typename TLogEntry>
+template <typename TDevice>
+Nuki::CmdResult LogArchive<TLogEntry>::syncFrom(TDevice& device, const uint16_t maxEntries) {
+  uint32_t lastIndex = getLastIndex();
+  if (lastIndex > 0) {
+    //after a reset of the lock its indexes restart at 1, the entry at the newest archived index is missing on the
+    //lock or another entry, also when the lock logged more entries since the reset than the archive holds
+    Nuki::CmdResult result = device.retrieveLogEntries(lastIndex, 1, 0, false);
+    if (result != Nuki::CmdResult::Success) {
+      return result;
+    }
+    const auto& received = device.getLogEntryBuffer();
+    if (received.empty()) {
+      startEpoch();
+    } else if (received.front().index == lastIndex) {
+      const TLogEntry& onLock = received.front();
+      uint32_t onLockTimestamp = toLogTimestamp(onLock.timeStampYear, onLock.timeStampMonth, onLock.timeStampDay,
+                                                onLock.timeStampHour, onLock.timeStampMinute, onLock.timeStampSecond);
+      bool archived = false;
+      queryByIndex(lastIndex, lastIndex, [&](const TLogEntry& entry) {
+        archived = entry.authId == onLock.authId
+                   && toLogTimestamp(entry.timeStampYear, entry.timeStampMonth, entry.timeStampDay,
+                                     entry.timeStampHour, entry.timeStampMinute, entry.timeStampSecond) == onLockTimestamp;
+        return false;
+      });
+      if (!archived) {
+        startEpoch();
+      }
+    }
+    //a higher index is returned when the lock dropped its oldest entries, the archive continues from there
+  }
+
+  uint16_t synced = 0;
+  while (synced < maxEntries) {
+    uint16_t remaining = maxEntries - synced;
+    uint16_t pageSize = remaining < LOG_ARCHIVE_SYNC_PAGE_SIZE ? remaining : LOG_ARCHIVE_SYNC_PAGE_SIZE;
+
+    //ascending from the first index that is not archived yet
+    Nuki::CmdResult result = device.retrieveLogEntries(getLastIndex() + 1, pageSize, 0, false);
+    size_t appended = appendAll(device.getLogEntryBuffer());
+    synced += appended;
+    if (result != Nuki::CmdResult::Success) {
+      return result;
+    }
+    if (appended == 0 || device.getLogEntryBuffer().size() < pageSize) {
+      //no newer entries on the lock
+      break;
+    }
+    esp_task_wdt_reset();
+  }
+  #ifdef DEBUG_NUKI_COMMUNICATION
+  log_d("Log archive synced %d entries, newest index %d", synced, getLastIndex());
+  #endif
+  return Nuki::CmdResult::Success;
+}
+
+} // namespace Nuki
@@ -0,0 +1,84 @@
+#pragma once
+
+/**
+ * @file NukiLogSync.h
+ * Incremental retrieval of the lock/opener log: only the entries newer than the newest entry retrieved before are
+ * requested. The index of that entry is kept in preferences so a restart does not cause a full reload.
+ *
+ * Created on: 2022
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * This library implements the communication from an ESP32 via BLE to a Nuki smart lock.
+ * Based on the Nuki Smart Lock API V2.2.1
+ * https://developer.nuki.io/page/nuki-smart-lock-api-2/2/
+ *
+ */
+
+#include "Arduino.h"
+#include "NukiBle.h"
+#include "NukiConstants.h"
+#include "NukiDataTypes.h"
+#include "NukiRingBuffer.h"
+#include <esp_task_wdt.h>
+#include <list>
+
+#define LOG_SYNC_BUFFER_SIZE 50
+#define LOG_SYNC_MAX_PAGE_SIZE 20
+#define LOG_SYNC_MAX_RETRIES 3  //passes without a new entry before a sync is aborted
+
+namespace Nuki {
+
+/**
+ * @brief Sync state of NukiLock::LogEntry or NukiOpener::LogEntry, used by the syncLogEntries() of
+ * NukiLock::NukiLock and NukiOpener::NukiOpener
+ */
+template <typename TLogEntry>
+class LogSync {
+  public:
+    /**
+     * @param device lock or opener, the last synced index is stored in its preferences
+     */
+    LogSync(NukiBle& nukiBle) : nukiBle(nukiBle) {}
+
+    /**
+     * @brief Retrieves the entries newer than the last synced index from device and adds them (oldest first)
+     * to the synced entries buffer
+     *
+     * @param device NukiLock::NukiLock or NukiOpener::NukiOpener
+     * @param maxEntries max number of entries to retrieve, on the first sync or when more entries are new
+     * only the most recent maxEntries are retrieved
+     */
+    template <typename TDevice>
+    Nuki::CmdResult sync(TDevice& device, const uint16_t maxEntries);
+
+    /**
+     * @brief Copies the synced entries, oldest first
+     */
+    void getEntries(std::list<TLogEntry>* entries);
+
+    /**
+     * @brief Removes all synced entries, the last synced index is kept
+     */
+    void clearEntries();
+
+    /**
+     * @brief Returns the index of the newest synced entry, 0 if nothing was synced yet
+     */
+    uint32_t getLastIndex();
+
+    /**
+     * @brief Forgets the last synced index, in memory and in preferences
+     */
+    void reset();
+
+  private:
+    NukiBle& nukiBle;
+    Nuki::RingBuffer<TLogEntry, LOG_SYNC_BUFFER_SIZE> entries;
+    uint32_t lastIndex = 0;
+    bool lastIndexLoaded = false;
+    uint8_t pageSize = LOG_SYNC_MAX_PAGE_SIZE;
+};
+
+} // namespace Nuki
+
+#include "NukiLogSync.hpp"
@@ -0,0 +1,125 @@
+#pragma once
+
+namespace Nuki {
+
+template <typename TLogEntry>
+template <typename TDevice>
+Nuki::CmdResult LogSync<TLogEntry>::sync(TDevice& device, const uint16_t maxEntries) {
+  if (maxEntries == 0) {
+    return Nuki::CmdResult::Failed;
+  }
+  uint32_t syncedIndex = getLastIndex();
+  const auto& received = device.getLogEntryBuffer();
+
+  //the most recent entry tells how many entries are new
+  Nuki::CmdResult result = device.retrieveLogEntries(0, 1, 1, false);
+  if (result != Nuki::CmdResult::Success && result != Nuki::CmdResult::TimeOut) {
+    return result;
+  }
+  if (received.empty()) {
+    //no entries at all
+    return result == Nuki::CmdResult::TimeOut ? result : Nuki::CmdResult::Success;
+  }
+  uint32_t newestIndex = received.front().index;
+  if (newestIndex <= syncedIndex) {
+    #ifdef DEBUG_NUKI_COMMUNICATION
+    log_d("Log in sync, newest index %d", newestIndex);
+    #endif
+    return Nuki::CmdResult::Success;
+  }
+
+  uint32_t nextIndex = syncedIndex + 1;
+  if (syncedIndex == 0 || newestIndex - syncedIndex > maxEntries) {
+    nextIndex = newestIndex >= maxEntries ? newestIndex - maxEntries + 1 : 1;
+  }
+
+  uint8_t retries = 0;
+  while (nextIndex <= newestIndex) {
+    uint32_t remaining = newestIndex - nextIndex + 1;
+    uint16_t requested = remaining < pageSize ? remaining : pageSize;
+    if (requested > received.capacity()) {
+      requested = received.capacity();
+    }
+
+    result = device.retrieveLogEntries(nextIndex, requested, 0, false);
+    bool pageComplete = result == Nuki::CmdResult::Success && received.size() >= requested;
+
+    //keep what was received, also from an incomplete page
+    bool progress = false;
+    for (const TLogEntry& logEntry : received) {
+      if (logEntry.index >= nextIndex && logEntry.index <= newestIndex) {
+        entries.push(logEntry);
+        nextIndex = logEntry.index + 1;
+        progress = true;
+      }
+    }
+    if (progress) {
+      lastIndex = nextIndex - 1;
+      if (!nukiBle.storeUInt(LOG_SYNC_INDEX_STORE_NAME, lastIndex)) {
+        log_w("Unable to store log sync index %d", lastIndex);
+      }
+    }
+
+    if (pageComplete) {
+      if (pageSize < LOG_SYNC_MAX_PAGE_SIZE) {
+        pageSize++;
+      }
+    } else if (!progress && !received.empty()) {
+      //only entries outside the requested range, the remaining indexes do not exist (anymore)
+      break;
+    } else if (pageSize > 1) {
+      //link could not deliver the page in time, continue with smaller pages
+      pageSize /= 2;
+    }
+
+    //also a complete page can hold no entry of the requested range, never loop without progress
+    if (progress) {
+      retries = 0;
+    } else if (++retries >= LOG_SYNC_MAX_RETRIES) {
+      log_w("Log sync aborted at index %d", nextIndex);
+      if (result != Nuki::CmdResult::Success) {
+        return result;
+      }
+      return pageComplete ? Nuki::CmdResult::Failed : Nuki::CmdResult::TimeOut;
+    }
+    esp_task_wdt_reset();
+  }
+
+  #ifdef DEBUG_NUKI_COMMUNICATION
+  log_d("Log synced up to index %d", lastIndex);
+  #endif
+  return Nuki::CmdResult::Success;
+}
+
+template <typename TLogEntry>
+void LogSync<TLogEntry>::getEntries(std::list<TLogEntry>* entries) {
+  entries->clear();
+  for (const TLogEntry& entry : this->entries) {
+    entries->push_back(entry);
+  }
+}
+
+template <typename TLogEntry>
+void LogSync<TLogEntry>::clearEntries() {
+  entries.clear();
+}
+
+template <typename TLogEntry>
+uint32_t LogSync<TLogEntry>::getLastIndex() {
+  //retried on the next call when the semaphore is busy
+  if (!lastIndexLoaded && nukiBle.getStoredUInt(LOG_SYNC_INDEX_STORE_NAME, 0, &lastIndex)) {
+    lastIndexLoaded = true;
+  }
+  return lastIndex;
+}
+
+template <typename TLogEntry>
+void LogSync<TLogEntry>::reset() {
+  lastIndex = 0;
+  lastIndexLoaded = true;
+  if (!nukiBle.removeStoredValue(LOG_SYNC_INDEX_STORE_NAME)) {
+    log_w("Unable to remove log sync index");
+  }
+}
+
+} // namespace Nuki
@@ -2,9 +2,24 @@
 
 #include "NukiBle.h"
 #include "NukiOpenerConstants.h"
+#include "NukiLogSync.h"
+#include "NukiRingBuffer.h"
 
 namespace NukiOpener {
 
+typedef Nuki::RingBuffer<LogEntry, LOG_ENTRIES_BUFFER_SIZE> LogEntryBuffer;
+typedef Nuki::RingBuffer<TimeControlEntry, TIME_CONTROL_ENTRIES_BUFFER_SIZE> TimeControlEntryBuffer;
+
+/**
+ * @brief Receives log entries one by one while they are downloaded, also during syncLogEntries().
+ * Called from the BLE receive task like Nuki::EntrySink: return quickly and DO NOT execute any BLE actions from it
+ */
+class LogEntrySink {
+  public:
+    virtual ~LogEntrySink() {};
+    virtual void onLogEntry(const LogEntry& entry) = 0;
+};
+
 class NukiOpener : public Nuki::NukiBle {
   public:
     NukiOpener(const std::string& deviceName, const uint32_t deviceId);
@@ -345,6 +360,13 @@ class NukiOpener : public Nuki::NukiBle {
      */
     void getTimeControlEntries(std::list<TimeControlEntry>* timeControlEntries);
 
+    /**
+     * @brief Read-only view of the time control entries stored on the esp, without copying them.
+     * Valid until the next retrieveTimeControlEntries().
+     * dropped() is the number of entries beyond TIME_CONTROL_ENTRIES_BUFFER_SIZE that were received but not stored
+     */
+    const TimeControlEntryBuffer& getTimeControlEntryBuffer() const;
+
     /**
      * @brief Get the Log Entries stored on the esp. Only available after executing retreiveLogEntries.
      *
@@ -352,6 +374,21 @@ class NukiOpener : public Nuki::NukiBle {
      */
     void getLogEntries(std::list<LogEntry>* requestedLogEntries);
 
+    /**
+     * @brief Read-only view of the Log Entries stored on the esp, without copying them.
+     * Iterate with a range based for loop or forEach(), valid until the next retrieveLogEntries().
+     * dropped() is the number of entries beyond LOG_ENTRIES_BUFFER_SIZE that were received but not stored
+     */
+    const LogEntryBuffer& getLogEntryBuffer() const;
+
+    /**
+     * @brief Set the sink receiving every log entry as soon as it is received, so big log downloads can be
+     * processed without keeping them. Entries beyond LOG_ENTRIES_BUFFER_SIZE only go to the sink
+     *
+     * @param sink sink for the log entries, nullptr to remove it
+     */
+    void setLogEntrySink(LogEntrySink* sink);
+
     /**
     * @brief Request the lock via BLE to send the log entries
     *
@@ -363,6 +400,40 @@ class NukiOpener : public Nuki::NukiBle {
     Nuki::CmdResult retrieveLogEntries(const uint32_t startIndex, const uint16_t count, const uint8_t sortOrder,
                                        const bool totalCount);
 
+    /**
+     * @brief Retrieves only the log entries that are newer than the newest entry retrieved by a previous sync
+     * and adds them (oldest first) to the synced log entries buffer. The index of the newest synced entry is
+     * stored in preferences so a restart does not cause a full reload.
+     * Entries are requested in pages, the page size is reduced when the opener does not deliver a page in time.
+     *
+     * @param maxEntries max number of entries to retrieve, on the first sync or when more entries are new
+     * only the most recent maxEntries are retrieved
+     */
+    Nuki::CmdResult syncLogEntries(const uint16_t maxEntries = LOG_SYNC_BUFFER_SIZE);
+
+    /**
+     * @brief Get the log entries retrieved by syncLogEntries(), oldest first.
+     * When more than LOG_SYNC_BUFFER_SIZE entries are synced the oldest are dropped.
+     *
+     * @param syncedLogEntries list to store the synced log entries
+     */
+    void getSyncedLogEntries(std::list<LogEntry>* syncedLogEntries);
+
+    /**
+     * @brief Removes all entries from the synced log entries buffer, the last synced index is kept
+     */
+    void clearSyncedLogEntries();
+
+    /**
+     * @brief Returns the index of the newest log entry retrieved by syncLogEntries()
+     */
+    uint32_t getLastSyncedLogIndex();
+
+    /**
+     * @brief Forgets the last synced index, the next sync starts again from the most recent entries
+     */
+    void resetLogSync();
+
     /**
      * @brief Requests config from Lock via BLE
      *
@@ -377,6 +448,33 @@ class NukiOpener : public Nuki::NukiBle {
      */
     Nuki::CmdResult requestAdvancedConfig(AdvancedConfig* retrievedAdvancedConfig);
 
+    /**
+     * @brief Starts a config transaction. Until commitConfigTransaction() or abortConfigTransaction()
+     * is called, the config and advanced config are only read once from the opener and all config
+     * setters (setName(), enableAutoUnlatch(), ...) only change the local copy.
+     */
+    void beginConfigTransaction();
+
+    /**
+     * @brief Ends the config transaction and writes the changed config and/or advanced config to the
+     * opener with a single SetConfig/SetAdvancedConfig command each. Nothing is sent if nothing changed.
+     */
+    Nuki::CmdResult commitConfigTransaction();
+
+    /**
+     * @brief Ends the config transaction and drops all changes made since beginConfigTransaction()
+     */
+    void abortConfigTransaction();
+
+    /**
+     * @brief Drops the cached config and advanced config.
+     *
+     * requestConfig() and requestAdvancedConfig() serve the config from memory as long as the
+     * configUpdateCount in the latest received opener state is the same as when the config was read,
+     * note that the time fields in a cached config are not updated.
+     */
+    void invalidateConfigCache();
+
 
     /**
      * @brief Returns battery critical state parsed from the battery state byte (battery critical byte)
@@ -392,10 +490,35 @@ class NukiOpener : public Nuki::NukiBle {
      */
     const ErrorCode getLastError() const;
 
+    /**
+     * @brief Non-blocking version of lockAction(), the action is queued and executed by the worker task
+     *
+     * @param callback optional, called from the worker task when the action has finished
+     * @return handle identifying the queued command, 0 if the command could not be queued
+     */
+    uint32_t lockActionAsync(const LockAction lockAction, const uint32_t nukiAppId = 1, const uint8_t flags = 0,
+                             const char* nameSuffix = nullptr, const uint8_t nameSuffixLen = 0,
+                             Nuki::AsyncCmdCallback callback = nullptr);
+
+    /**
+     * @brief Non-blocking versions of the request methods, the callback receives the retrieved data
+     * and is called from the worker task
+     *
+     * @return handle identifying the queued command, 0 if the command could not be queued
+     */
+    uint32_t requestOpenerStateAsync(Nuki::AsyncPayloadCallback<OpenerState> callback);
+    uint32_t requestBatteryReportAsync(Nuki::AsyncPayloadCallback<BatteryReport> callback);
+    uint32_t requestConfigAsync(Nuki::AsyncPayloadCallback<Config> callback);
+    uint32_t requestAdvancedConfigAsync(Nuki::AsyncPayloadCallback<AdvancedConfig> callback);
+    uint32_t retrieveTimeControlEntriesAsync(Nuki::AsyncPayloadCallback<TimeControlEntryBuffer> callback);
+    uint32_t retrieveLogEntriesAsync(const uint32_t startIndex, const uint16_t count, const uint8_t sortOrder,
+                                     const bool totalCount, Nuki::AsyncPayloadCallback<LogEntryBuffer> callback);
+
     virtual void logErrorCode(uint8_t errorCode) override;
 
   protected:
     void handleReturnMessage(Command returnCode, unsigned char* data, uint16_t dataLen) override;
+    void onCredentialsDeleted() override;
 
 
   private:
@@ -408,12 +531,30 @@ class NukiOpener : public Nuki::NukiBle {
 
     OpenerState openerState;
     BatteryReport batteryReport;
-    std::list<TimeControlEntry> listOfTimeControlEntries;
-    std::list<LogEntry> listOfLogEntries;
+    TimeControlEntryBuffer timeControlEntryBuffer;
+    LogEntryBuffer logEntryBuffer;
+    uint16_t nrOfReceivedLogEntries = 0;
+    Nuki::LogSync<LogEntry> logSync{*this};
+    LogEntrySink* logEntrySink = nullptr;
 
     Config config;
     AdvancedConfig advancedConfig;
 
+    bool configTransaction = false;
+    bool configStaged = false;
+    bool advancedConfigStaged = false;
+    Config stagedConfig;
+    Config originalConfig;
+    AdvancedConfig stagedAdvancedConfig;
+    AdvancedConfig originalAdvancedConfig;
+
+    bool stateReceived = false;
+    bool configCached = false;
+    bool advancedConfigCached = false;
+    uint8_t configCacheUpdateCount = 0;
+    uint8_t advancedConfigCacheUpdateCount = 0;
+    bool isConfigCacheValid(const bool cached, const uint8_t cacheUpdateCount) const;
+
 };
 
 }
\ No newline at end of file
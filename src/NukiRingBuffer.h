@@ -0,0 +1,178 @@
+#pragma once
+
+/**
+ * @file NukiRingBuffer.h
+ * Fixed capacity ring buffer, the elements are stored in the object itself so adding an element never allocates.
+ * When full, push() overwrites the oldest element and tryPush() drops the new one, dropped() tells how many were dropped
+ *
+ * Created on: 2022
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * This library implements the communication from an ESP32 via BLE to a Nuki smart lock.
+ * Based on the Nuki Smart Lock API V2.2.1
+ * https://developer.nuki.io/page/nuki-smart-lock-api-2/2/
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Nuki {
+
+template <typename T, size_t Capacity>
+class RingBuffer {
+  public:
+    /**
+     * @brief Adds an element after the newest element, overwrites the oldest element when full
+     *
+     * @return true if an element was overwritten
+     */
+    bool push(const T& element) {
+      buffer[(head + count) % Capacity] = element;
+      if (count < Capacity) {
+        count++;
+        return false;
+      }
+      head = (head + 1) % Capacity;
+      return true;
+    }
+
+    /**
+     * @brief Adds an element after the newest element if the buffer is not full
+     *
+     * @return false if the buffer was full and the element was not added, it is counted in dropped() then
+     */
+    bool tryPush(const T& element) {
+      if (count == Capacity) {
+        droppedCount++;
+        return false;
+      }
+      buffer[(head + count) % Capacity] = element;
+      count++;
+      return true;
+    }
+
+    /**
+     * @brief Removes the oldest element
+     *
+     * @return false if the buffer was empty
+     */
+    bool pop() {
+      if (count == 0) {
+        return false;
+      }
+      head = (head + 1) % Capacity;
+      count--;
+      return true;
+    }
+
+    /**
+     * @brief Returns the element at index, 0 being the oldest element
+     */
+    const T& at(const size_t index) const {
+      return buffer[(head + index) % Capacity];
+    }
+
+    T& at(const size_t index) {
+      return buffer[(head + index) % Capacity];
+    }
+
+    const T& front() const {
+      return at(0);
+    }
+
+    const T& back() const {
+      return at(count - 1);
+    }
+
+    size_t size() const {
+      return count;
+    }
+
+    bool empty() const {
+      return count == 0;
+    }
+
+    bool full() const {
+      return count == Capacity;
+    }
+
+    constexpr size_t capacity() const {
+      return Capacity;
+    }
+
+    /**
+     * @brief Returns the number of elements tryPush() could not add since the last clear(), a non zero value means
+     * the buffer holds an incomplete list
+     */
+    size_t dropped() const {
+      return droppedCount;
+    }
+
+    void clear() {
+      head = 0;
+      count = 0;
+      droppedCount = 0;
+    }
+
+    /**
+     * @brief Read-only iterator from the oldest to the newest element, for range based for loops
+     */
+    class ConstIterator {
+      public:
+        ConstIterator(const RingBuffer* ringBuffer, const size_t index) : ringBuffer(ringBuffer), index(index) {}
+
+        const T& operator*() const {
+          return ringBuffer->at(index);
+        }
+
+        const T* operator->() const {
+          return &ringBuffer->at(index);
+        }
+
+        ConstIterator& operator++() {
+          index++;
+          return *this;
+        }
+
+        bool operator==(const ConstIterator& other) const {
+          return index == other.index && ringBuffer == other.ringBuffer;
+        }
+
+        bool operator!=(const ConstIterator& other) const {
+          return !(*this == other);
+        }
+
+      private:
+        const RingBuffer* ringBuffer;
+        size_t index;
+    };
+
+    ConstIterator begin() const {
+      return ConstIterator(this, 0);
+    }
+
+    ConstIterator end() const {
+      return ConstIterator(this, count);
+    }
+
+    /**
+     * @brief Calls callback with every element, oldest first
+     *
+     * @param callback callable taking a const T&
+     */
+    template <typename TCallback>
+    void forEach(TCallback callback) const {
+      for (size_t i = 0; i < count; i++) {
+        callback(at(i));
+      }
+    }
+
+  private:
+    T buffer[Capacity];
+    size_t head = 0;
+    size_t count = 0;
+    size_t droppedCount = 0;
+};
+
+} // namespace Nuki
@@ -1,7 +1,8 @@
 #include "NukiUtils.h"
 
 #include "sodium/crypto_secretbox.h"
-#include "Crc16.h"
+#include "NukiCrc.h"
+#include "esp_system.h"
 
 
 namespace Nuki {
@@ -77,18 +78,84 @@ int decode(unsigned char* output, unsigned char* input, unsigned long long len,
 }
 
 void generateNonce(unsigned char* hexArray, uint8_t nrOfBytes) {
-  randomSeed(millis());
-  for (int i = 0 ; i < nrOfBytes ; i++) {
-    hexArray[i] = random(0, 255);
-  }
+  //hardware RNG, true random while the radio is on
+  esp_fill_random(hexArray, nrOfBytes);
   printBuffer((byte*)hexArray, nrOfBytes, false, "Nonce");
 }
 
 unsigned int calculateCrc(uint8_t* data, uint8_t start, uint16_t length) {
-  Crc16 crcObj;
-  crcObj.clearCrc();
   // CCITT-False:	width=16 poly=0x1021 init=0xffff refin=false refout=false xorout=0x0000 check=0x29b1
-  return crcObj.fastCrc(data, start, length, false, false, 0x1021, 0xffff, 0x0000, 0x8000, 0xffff);
+  return crc16CcittFalse(&data[start], length);
+}
+
+uint16_t buildEncryptedFrame(unsigned char* frame, const uint16_t frameSize, const unsigned char* authorizationId,
+                             const Command commandIdentifier, const unsigned char* payload, const uint8_t payloadLen,
+                             const unsigned char* nonce, const CryptoContext& crypto) {
+  /*
+  #     ADDITIONAL DATA (not encr)      #                         PLAIN DATA (encr)                                 #
+  #  nonce  # auth identifier # msg len #   mac   # authorization identifier # command identifier # payload #  crc   #
+  # 24 byte #    4 byte       # 2 byte  # 16 byte #      4 byte              #       2 byte       #  n byte # 2 byte #
+  */
+  uint16_t plainDataLen = 8 + payloadLen;
+  uint16_t encrMsgLen = crypto_secretbox_MACBYTES + plainDataLen;
+  uint16_t frameLen = ENCRYPTED_FRAME_HEADER_SIZE + encrMsgLen;
+  if (frameLen > frameSize) {
+    log_w("Frame too large: %d", frameLen);
+    return 0;
+  }
+
+  //plain data is composed at its final position and encrypted in place
+  unsigned char* mac = &frame[ENCRYPTED_FRAME_HEADER_SIZE];
+  unsigned char* plainData = &mac[crypto_secretbox_MACBYTES];
+  memcpy(&plainData[0], authorizationId, 4);
+  memcpy(&plainData[4], &commandIdentifier, sizeof(commandIdentifier));
+  if (payloadLen > 0) {
+    memcpy(&plainData[6], payload, payloadLen);
+  }
+  uint16_t dataCrc = calculateCrc(plainData, 0, plainDataLen - 2);
+  memcpy(&plainData[plainDataLen - 2], &dataCrc, sizeof(dataCrc));
+  printBuffer((byte*)plainData, plainDataLen, false, "Plain data with CRC: ");
+
+  memcpy(&frame[0], nonce, crypto_secretbox_NONCEBYTES);
+  memcpy(&frame[24], authorizationId, 4);
+  memcpy(&frame[28], &encrMsgLen, sizeof(encrMsgLen));
+
+  //mac in front of the cipher text, same layout as crypto_secretbox_easy
+  if (!crypto.encrypt(plainData, mac, plainData, plainDataLen, nonce)) {
+    return 0;
+  }
+  return frameLen;
+}
+
+int16_t openEncryptedFrame(unsigned char* plainData, const uint16_t plainDataSize, const unsigned char* frame,
+                           const uint16_t frameLen, const CryptoContext& crypto) {
+  if (frameLen < ENCRYPTED_FRAME_OVERHEAD) {
+    log_w("Received frame too short: %d", frameLen);
+    return -1;
+  }
+  uint16_t encrMsgLen = 0;
+  memcpy(&encrMsgLen, &frame[28], sizeof(encrMsgLen));
+  if (encrMsgLen > frameLen - ENCRYPTED_FRAME_HEADER_SIZE || encrMsgLen < ENCRYPTED_FRAME_OVERHEAD - ENCRYPTED_FRAME_HEADER_SIZE) {
+    log_w("Invalid encrypted message length: %d", encrMsgLen);
+    return -1;
+  }
+  uint16_t plainDataLen = encrMsgLen - crypto_secretbox_MACBYTES;
+  if (plainDataLen > plainDataSize) {
+    log_w("Received message too large: %d", plainDataLen);
+    return -1;
+  }
+
+  const unsigned char* mac = &frame[ENCRYPTED_FRAME_HEADER_SIZE];
+  if (!crypto.decrypt(plainData, &mac[crypto_secretbox_MACBYTES], mac, plainDataLen, frame)) {
+    log_w("Decryption failed (length %i)", encrMsgLen);
+    return -1;
+  }
+  printBuffer((byte*)plainData, plainDataLen, false, "Decrypted data");
+
+  if (!crcValid(plainData, plainDataLen)) {
+    return -1;
+  }
+  return plainDataLen;
 }
 
 bool crcValid(uint8_t* pData, uint16_t length) {
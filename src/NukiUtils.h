@@ -16,12 +16,17 @@
 #include "Arduino.h"
 #include "NukiDataTypes.h"
 #include "NukiConstants.h"
+#include "NukiCrypto.h"
+#include "sodium/crypto_secretbox.h"
 #include <bitset>
 
 namespace Nuki {
 
 #define ENDIAN_CHANGE_U16(x) ((((x)&0xFF00)>>8) + (((x)&0xFF)<<8))
 
+#define ENCRYPTED_FRAME_HEADER_SIZE 30  //nonce (24) + authorization id (4) + encrypted message length (2)
+#define ENCRYPTED_FRAME_OVERHEAD (ENCRYPTED_FRAME_HEADER_SIZE + crypto_secretbox_MACBYTES + 8) //+ authorization id, command and crc
+
 void printBuffer(const byte* buff, const uint8_t size, const boolean asChars, const char* header);
 bool isCharArrayNotEmpty(unsigned char* array, uint16_t len);
 bool isCharArrayEmpty(unsigned char* array, uint16_t len);
@@ -33,6 +38,36 @@ void generateNonce(unsigned char* hexArray, uint8_t nrOfBytes);
 unsigned int calculateCrc(uint8_t data[], uint8_t start, uint16_t length);
 bool crcValid(uint8_t* pData, uint16_t length);
 
+/**
+ * @brief Lays out an encrypted message in frame and encrypts it in place, no intermediate buffers are used
+ *
+ * @param frame buffer the complete message (additional data + encrypted data) is written to
+ * @param frameSize size of frame
+ * @param authorizationId authorization id (4 bytes)
+ * @param commandIdentifier command to be sent
+ * @param payload payload of the command
+ * @param payloadLen length of payload
+ * @param nonce nonce to encrypt with (crypto_secretbox_NONCEBYTES)
+ * @param crypto crypto context holding the shared secret key
+ * @return length of the frame, 0 if the frame does not fit or encryption failed
+ */
+uint16_t buildEncryptedFrame(unsigned char* frame, const uint16_t frameSize, const unsigned char* authorizationId,
+                             const Command commandIdentifier, const unsigned char* payload, const uint8_t payloadLen,
+                             const unsigned char* nonce, const CryptoContext& crypto);
+
+/**
+ * @brief Decrypts a received encrypted message directly from the received frame and checks the crc
+ *
+ * @param plainData buffer the decrypted data (authorization id + command + payload + crc) is written to
+ * @param plainDataSize size of plainData
+ * @param frame the received frame
+ * @param frameLen length of the received frame
+ * @param crypto crypto context holding the shared secret key
+ * @return length of the decrypted data, -1 if the frame is invalid, could not be decrypted or the crc is wrong
+ */
+int16_t openEncryptedFrame(unsigned char* plainData, const uint16_t plainDataSize, const unsigned char* frame,
+                           const uint16_t frameLen, const CryptoContext& crypto);
+
 /**
  * @brief Translate a bitset<N> into Nuki weekdays int
  *
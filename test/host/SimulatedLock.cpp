@@ -0,0 +1,784 @@
+#include "SimulatedLock.h"
+#include "sodium/crypto_auth_hmacsha256.h"
+#include "sodium/crypto_box.h"
+#include "sodium/crypto_core_hsalsa20.h"
+#include "sodium/crypto_scalarmult.h"
+#include "sodium/crypto_secretbox.h"
+#include "sodium/randombytes.h"
+#include "sodium/utils.h"
+#include <chrono>
+#include <cstring>
+
+namespace Nuki {
+
+namespace {
+
+//pairing service data of a lock in pairing mode, only its presence is checked
+const char PAIRING_SERVICE_DATA[] = "\x01";
+
+uint16_t getUInt16(const uint8_t* data) {
+  return data[0] | (data[1] << 8);
+}
+
+uint32_t getUInt32(const uint8_t* data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+void putUInt16(std::vector<uint8_t>& data, const uint16_t value) {
+  data.push_back(value & 0xff);
+  data.push_back(value >> 8);
+}
+
+void putUInt32(std::vector<uint8_t>& data, const uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    data.push_back((value >> (8 * i)) & 0xff);
+  }
+}
+
+} // namespace
+
+SimulatedLock::SimulatedLock(const std::string& address)
+  : address(address) {
+  crypto_box_keypair(publicKey, privateKey);
+  randombytes_buf(lockId, sizeof(lockId));
+
+  keyTurnerState.nukiState = NukiLock::State::DoorMode;
+  keyTurnerState.lockState = NukiLock::LockState::Locked;
+  keyTurnerState.currentTimeYear = 2024;
+  keyTurnerState.configUpdateCount = 1;
+  memset(&config, 0, sizeof(config));
+  config.nukiId = 0x1234;
+  strcpy((char*)config.name, "Simulated lock");
+  memset(&batteryReport, 0, sizeof(batteryReport));
+  batteryReport.batteryVoltage = 6000;
+}
+
+SimulatedLock::~SimulatedLock() {
+  stop();
+}
+
+void SimulatedLock::start() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running) {
+      return;
+    }
+    running = true;
+  }
+  worker = std::thread(&SimulatedLock::run, this);
+  NimBLEDevice::hostAddPeripheral(address, this);
+}
+
+void SimulatedLock::stop() {
+  NimBLEDevice::hostRemovePeripheral(address);
+  disconnectClients();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!running) {
+      return;
+    }
+    running = false;
+    frames.clear();
+  }
+  framesAvailable.notify_all();
+  worker.join();
+  idle.notify_all();
+}
+
+NimBLEAddress SimulatedLock::getAddress() const {
+  return address;
+}
+
+void SimulatedLock::setPairingMode(const bool enable) {
+  std::lock_guard<std::mutex> lock(mutex);
+  pairingMode = enable;
+}
+
+void SimulatedLock::advertise(BleScanner::Scanner& scanner, const bool stateChanged) {
+  NimBLEAdvertisedDevice device(address);
+  device.name = "Nuki_SIM";
+  bool inPairingMode;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    inPairingMode = pairingMode;
+  }
+
+  if (inPairingMode) {
+    device.serviceData[NukiLock::keyturnerPairingServiceUUID] = PAIRING_SERVICE_DATA;
+  } else {
+    //flags, then the iBeacon: company id, type, length, proximity uuid (the keyturner service), major, minor, power
+    device.payload = {0x02, 0x01, 0x06, 26, 0xff, 0x4c, 0x00, 0x02, 0x15};
+    std::string uuid = NukiLock::keyturnerServiceUUID.toString();
+    for (size_t i = 0; i + 1 < uuid.size(); i++) {
+      if (isxdigit(uuid[i]) && isxdigit(uuid[i + 1])) {
+        device.payload.push_back(std::stoi(uuid.substr(i, 2), nullptr, 16));
+        i++;
+      }
+    }
+    device.payload.insert(device.payload.end(), {0x00, 0x01, 0x00, 0x02, (uint8_t)(stateChanged ? 0xc5 : 0xc4)});
+  }
+  scanner.publish(&device);
+}
+
+void SimulatedLock::disconnectClients() {
+  std::set<NimBLEClient*> connected;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    connected.swap(clients);
+  }
+  for (NimBLEClient* client : connected) {
+    client->hostPeerDisconnected();
+  }
+}
+
+bool SimulatedLock::isPaired() const {
+  return paired;
+}
+
+uint32_t SimulatedLock::getAuthorizationId() const {
+  return authorizationId;
+}
+
+void SimulatedLock::setSecurityPin(const uint16_t pin) {
+  std::lock_guard<std::mutex> lock(mutex);
+  securityPin = pin;
+}
+
+void SimulatedLock::setReplyDelay(const uint32_t delayUs) {
+  std::lock_guard<std::mutex> lock(mutex);
+  replyDelayUs = delayUs;
+}
+
+void SimulatedLock::injectBusy(const uint16_t nrOfCommands) {
+  std::lock_guard<std::mutex> lock(mutex);
+  busyCommands = nrOfCommands;
+}
+
+void SimulatedLock::setListStatusComplete(const bool send) {
+  std::lock_guard<std::mutex> lock(mutex);
+  listStatusComplete = send;
+}
+
+void SimulatedLock::setLockActionDuration(const uint32_t durationMs) {
+  std::lock_guard<std::mutex> lock(mutex);
+  lockActionDurationMs = durationMs;
+}
+
+bool SimulatedLock::waitIdle(const uint32_t timeoutMs) {
+  std::unique_lock<std::mutex> lock(mutex);
+  return idle.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() {
+    return !running || (frames.empty() && !handlingFrame);
+  });
+}
+
+void SimulatedLock::setKeyTurnerState(const NukiLock::KeyTurnerState& state) {
+  std::lock_guard<std::mutex> lock(mutex);
+  keyTurnerState = state;
+}
+
+NukiLock::KeyTurnerState SimulatedLock::getKeyTurnerState() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return keyTurnerState;
+}
+
+void SimulatedLock::setConfig(const NukiLock::Config& config) {
+  std::lock_guard<std::mutex> lock(mutex);
+  this->config = config;
+}
+
+void SimulatedLock::setBatteryReport(const NukiLock::BatteryReport& report) {
+  std::lock_guard<std::mutex> lock(mutex);
+  batteryReport = report;
+}
+
+void SimulatedLock::setLogEntries(const std::vector<NukiLock::LogEntry>& entries) {
+  std::lock_guard<std::mutex> lock(mutex);
+  logEntries = entries;
+}
+
+void SimulatedLock::setKeypadEntries(const std::vector<KeypadEntry>& entries) {
+  std::lock_guard<std::mutex> lock(mutex);
+  keypadEntries = entries;
+}
+
+void SimulatedLock::setAuthorizationEntries(const std::vector<AuthorizationEntry>& entries) {
+  std::lock_guard<std::mutex> lock(mutex);
+  authorizationEntries = entries;
+}
+
+void SimulatedLock::setTimeControlEntries(const std::vector<NukiLock::TimeControlEntry>& entries) {
+  std::lock_guard<std::mutex> lock(mutex);
+  timeControlEntries = entries;
+}
+
+uint32_t SimulatedLock::getConnectCount() const {
+  return connectCount;
+}
+
+uint32_t SimulatedLock::getReceivedFrameCount() const {
+  return receivedFrameCount;
+}
+
+uint32_t SimulatedLock::getSentFrameCount() const {
+  return sentFrameCount;
+}
+
+uint32_t SimulatedLock::getErrorCount() const {
+  return errorCount;
+}
+
+NukiLock::LogEntry SimulatedLock::makeLogEntry(const uint32_t index, const uint32_t authId, const uint16_t year) {
+  NukiLock::LogEntry entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.index = index;
+  entry.timeStampYear = year;
+  entry.timeStampMonth = 1 + index % 12;
+  entry.timeStampDay = 1 + index % 28;
+  entry.timeStampHour = index % 24;
+  entry.timeStampMinute = index % 60;
+  entry.timeStampSecond = (index * 7) % 60;
+  entry.authId = authId;
+  snprintf((char*)entry.name, sizeof(entry.name), "user %u", authId);
+  entry.loggingType = NukiLock::LoggingType::LockAction;
+  entry.data[0] = (uint8_t)NukiLock::LockAction::Unlock;
+  return entry;
+}
+
+uint16_t SimulatedLock::crc16(const uint8_t* data, const size_t length) {
+  uint16_t crc = 0xffff;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+bool SimulatedLock::hasCharacteristic(const NimBLEUUID& serviceUUID, const NimBLEUUID& characteristicUUID) {
+  return (serviceUUID == NukiLock::keyturnerPairingServiceUUID && characteristicUUID == NukiLock::keyturnerGdioUUID)
+         || (serviceUUID == NukiLock::keyturnerServiceUUID && characteristicUUID == NukiLock::keyturnerUserDataUUID);
+}
+
+bool SimulatedLock::onConnect(NimBLEClient* client) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!running) {
+    return false;
+  }
+  clients.insert(client);
+  connectCount++;
+  return true;
+}
+
+void SimulatedLock::onDisconnect(NimBLEClient* client) {
+  std::lock_guard<std::mutex> lock(mutex);
+  clients.erase(client);
+}
+
+bool SimulatedLock::onWrite(NimBLEClient* client, const NimBLEUUID& characteristicUUID, const uint8_t* data,
+                            const size_t length) {
+  bool encrypted = characteristicUUID == NukiLock::keyturnerUserDataUUID;
+  if (!encrypted && characteristicUUID != NukiLock::keyturnerGdioUUID) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!running) {
+      return false;
+    }
+    frames.push_back({client, encrypted, std::vector<uint8_t>(data, data + length)});
+  }
+  receivedFrameCount++;
+  framesAvailable.notify_one();
+  return true;
+}
+
+void SimulatedLock::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    framesAvailable.wait(lock, [this]() {
+      return !running || !frames.empty();
+    });
+    if (!running) {
+      break;
+    }
+    Frame frame = std::move(frames.front());
+    frames.pop_front();
+    handlingFrame = true;
+    lock.unlock();
+
+    //replies are sent without holding the mutex, the client may write the next frame from its notify callback
+    if (frame.encrypted) {
+      handleEncryptedFrame(frame.client, frame.data);
+    } else {
+      handlePlainFrame(frame.client, frame.data);
+    }
+
+    lock.lock();
+    handlingFrame = false;
+    idle.notify_all();
+  }
+}
+
+void SimulatedLock::handlePlainFrame(NimBLEClient* client, const std::vector<uint8_t>& frame) {
+  /*
+  #  command  #  payload  #  crc    #
+  #  2 byte   #  n byte   #  2 byte #
+  */
+  if (frame.size() < 4 || crc16(frame.data(), frame.size() - 2) != getUInt16(&frame[frame.size() - 2])) {
+    sendError(client, false, NukiLock::ErrorCode::ERROR_BAD_CRC, Command::Empty);
+    return;
+  }
+  Command command = (Command)getUInt16(frame.data());
+  const uint8_t* payload = &frame[2];
+  size_t payloadLen = frame.size() - 4;
+
+  bool inPairingMode;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    inPairingMode = pairingMode;
+  }
+  if (!inPairingMode) {
+    sendError(client, false, NukiLock::ErrorCode::P_ERROR_NOT_PAIRING, command);
+    return;
+  }
+
+  switch (command) {
+    case Command::RequestData: {
+      if (payloadLen == 2 && (Command)getUInt16(payload) == Command::PublicKey) {
+        sendPlain(client, Command::PublicKey, publicKey, sizeof(publicKey));
+      } else {
+        sendError(client, false, NukiLock::ErrorCode::P_ERROR_BAD_PARAMETER, command);
+      }
+      break;
+    }
+    case Command::PublicKey: {
+      if (payloadLen != sizeof(clientPublicKey)) {
+        sendError(client, false, NukiLock::ErrorCode::ERROR_BAD_LENGTH, command);
+        break;
+      }
+      memcpy(clientPublicKey, payload, sizeof(clientPublicKey));
+      uint8_t sharedKey[32];
+      uint8_t in[16] = {};
+      const uint8_t sigma[] = "expand 32-byte k";
+      crypto_scalarmult_curve25519(sharedKey, privateKey, clientPublicKey);
+      crypto_core_hsalsa20(secretKey, in, sharedKey, sigma);
+      newChallenge();
+      sendPlain(client, Command::Challenge, challenge, sizeof(challenge));
+      break;
+    }
+    case Command::AuthorizationAuthenticator: {
+      //client public key, lock public key and challenge
+      uint8_t authenticated[96];
+      memcpy(authenticated, clientPublicKey, 32);
+      memcpy(&authenticated[32], publicKey, 32);
+      memcpy(&authenticated[64], challenge, 32);
+      if (payloadLen != 32 || crypto_auth_hmacsha256_verify(payload, authenticated, sizeof(authenticated), secretKey) != 0) {
+        sendError(client, false, NukiLock::ErrorCode::P_ERROR_BAD_AUTHENTICATOR, command);
+        break;
+      }
+      newChallenge();
+      sendPlain(client, Command::Challenge, challenge, sizeof(challenge));
+      break;
+    }
+    case Command::AuthorizationData: {
+      /*
+      #  authenticator  #  id type  #  id     #  name    #  nonce   #
+      #  32 byte        #  1 byte   #  4 byte #  32 byte #  32 byte #
+      */
+      if (payloadLen != 101) {
+        sendError(client, false, NukiLock::ErrorCode::ERROR_BAD_LENGTH, command);
+        break;
+      }
+      uint8_t authenticated[101];
+      memcpy(authenticated, &payload[32], 69);
+      memcpy(&authenticated[69], challenge, 32);
+      if (crypto_auth_hmacsha256_verify(payload, authenticated, sizeof(authenticated), secretKey) != 0) {
+        sendError(client, false, NukiLock::ErrorCode::P_ERROR_BAD_AUTHENTICATOR, command);
+        break;
+      }
+      authorizationId = nextAuthorizationId++;
+      newChallenge();
+
+      //authenticator, authorization id, lock id, nonce
+      std::vector<uint8_t> reply(32);
+      putUInt32(reply, authorizationId);
+      reply.insert(reply.end(), lockId, lockId + sizeof(lockId));
+      reply.insert(reply.end(), challenge, challenge + sizeof(challenge));
+      std::vector<uint8_t> authenticatedReply(reply.begin() + 32, reply.end());
+      authenticatedReply.insert(authenticatedReply.end(), &payload[69], &payload[101]);
+      crypto_auth_hmacsha256(reply.data(), authenticatedReply.data(), authenticatedReply.size(), secretKey);
+      sendPlain(client, Command::AuthorizationId, reply.data(), reply.size());
+      break;
+    }
+    case Command::AuthorizationIdConfirmation: {
+      //authenticator over authorization id and the nonce of the authorization id frame
+      uint8_t authenticated[36];
+      if (payloadLen != 36 || getUInt32(&payload[32]) != authorizationId) {
+        sendError(client, false, NukiLock::ErrorCode::P_ERROR_BAD_PARAMETER, command);
+        break;
+      }
+      memcpy(authenticated, &payload[32], 4);
+      memcpy(&authenticated[4], challenge, 32);
+      if (crypto_auth_hmacsha256_verify(payload, authenticated, sizeof(authenticated), secretKey) != 0) {
+        sendError(client, false, NukiLock::ErrorCode::P_ERROR_BAD_AUTHENTICATOR, command);
+        break;
+      }
+      challengeValid = false;
+      paired = true;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        pairingMode = false;
+      }
+      uint8_t status = (uint8_t)CommandStatus::Complete;
+      sendPlain(client, Command::Status, &status, 1);
+      break;
+    }
+    default:
+      sendError(client, false, NukiLock::ErrorCode::ERROR_UNKNOWN, command);
+  }
+}
+
+void SimulatedLock::handleEncryptedFrame(NimBLEClient* client, const std::vector<uint8_t>& frame) {
+  /*
+  #  nonce   #  authorization id  #  length  #  mac + encrypted: authorization id, command, payload, crc  #
+  #  24 byte #  4 byte            #  2 byte  #  16 byte + 8 + n byte                                      #
+  */
+  const size_t headerSize = crypto_secretbox_NONCEBYTES + 4 + 2;
+  if (!paired || frame.size() < headerSize + crypto_secretbox_MACBYTES + 8
+      || getUInt16(&frame[headerSize - 2]) != frame.size() - headerSize) {
+    errorCount++;
+    return;
+  }
+  size_t plainLen = frame.size() - headerSize - crypto_secretbox_MACBYTES;
+  std::vector<uint8_t> plain(plainLen);
+  if (crypto_secretbox_open_easy(plain.data(), &frame[headerSize], frame.size() - headerSize, frame.data(),
+                                 secretKey) != 0) {
+    //not sent by the paired client, a lock does not answer it
+    errorCount++;
+    return;
+  }
+  Command command = (Command)getUInt16(&plain[4]);
+  if (crc16(plain.data(), plainLen - 2) != getUInt16(&plain[plainLen - 2])) {
+    sendError(client, true, NukiLock::ErrorCode::ERROR_BAD_CRC, command);
+    return;
+  }
+  if (getUInt32(&frame[24]) != authorizationId || getUInt32(plain.data()) != authorizationId) {
+    sendError(client, true, NukiLock::ErrorCode::K_ERROR_INVALID_AUTH_ID, command);
+    return;
+  }
+  handleCommand(client, command, &plain[6], plainLen - 8);
+}
+
+void SimulatedLock::handleCommand(NimBLEClient* client, const Command command, const uint8_t* payload,
+                                  const size_t payloadLen) {
+  //commands with a challenge end with the nonce, followed by the security pin for the commands that need it
+  const size_t nonceLen = sizeof(challenge);
+  size_t fixedLen = 0;
+  bool withPin = false;
+  switch (command) {
+    case Command::RequestData: {
+      if (payloadLen != 2) {
+        sendError(client, true, NukiLock::ErrorCode::ERROR_BAD_LENGTH, command);
+        return;
+      }
+      Command requested = (Command)getUInt16(payload);
+      if (requested == Command::Challenge) {
+        newChallenge();
+        sendEncrypted(client, Command::Challenge, challenge, sizeof(challenge));
+      } else if (requested == Command::KeyturnerStates) {
+        NukiLock::KeyTurnerState state = getKeyTurnerState();
+        sendEncrypted(client, Command::KeyturnerStates, (uint8_t*)&state, sizeof(state));
+      } else if (requested == Command::BatteryReport) {
+        NukiLock::BatteryReport report;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          report = batteryReport;
+        }
+        sendEncrypted(client, Command::BatteryReport, (uint8_t*)&report, sizeof(report));
+      } else {
+        sendError(client, true, NukiLock::ErrorCode::K_ERROR_BAD_PARAMETER, command);
+      }
+      return;
+    }
+    case Command::RequestConfig:
+      break;
+    case Command::LockAction:
+      fixedLen = payloadLen > nonceLen ? payloadLen - nonceLen : 0;
+      break;
+    case Command::RequestLogEntries:
+      fixedLen = 8;
+      withPin = true;
+      break;
+    case Command::RequestKeypadCodes:
+    case Command::RequestAuthorizationEntries:
+      fixedLen = 4;
+      withPin = true;
+      break;
+    case Command::RequestTimeControlEntries:
+    case Command::VerifySecurityPin:
+      withPin = true;
+      break;
+    default:
+      sendError(client, true, NukiLock::ErrorCode::ERROR_UNKNOWN, command);
+      return;
+  }
+
+  if (payloadLen != fixedLen + nonceLen + (withPin ? 2 : 0)) {
+    sendError(client, true, NukiLock::ErrorCode::ERROR_BAD_LENGTH, command);
+    return;
+  }
+  if (!checkChallenge(client, command, &payload[fixedLen])
+      || (withPin && !checkPin(client, command, &payload[fixedLen + nonceLen]))) {
+    return;
+  }
+  bool busy = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (busyCommands > 0) {
+      busyCommands--;
+      busy = true;
+    }
+  }
+  if (busy) {
+    sendError(client, true, NukiLock::ErrorCode::K_ERROR_BUSY, command);
+    return;
+  }
+
+  switch (command) {
+    case Command::RequestConfig: {
+      NukiLock::Config current;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        current = config;
+      }
+      sendEncrypted(client, Command::Config, (uint8_t*)&current, sizeof(current));
+      break;
+    }
+    case Command::LockAction: {
+      sendStatus(client, CommandStatus::Accepted);
+      uint32_t duration;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        NukiLock::LockAction action = (NukiLock::LockAction)payload[0];
+        keyTurnerState.lastLockAction = action;
+        keyTurnerState.lastLockActionCompletionStatus = NukiLock::CompletionStatus::Success;
+        switch (action) {
+          case NukiLock::LockAction::Unlock:
+            keyTurnerState.lockState = NukiLock::LockState::Unlocked;
+            break;
+          case NukiLock::LockAction::Lock:
+          case NukiLock::LockAction::FullLock:
+            keyTurnerState.lockState = NukiLock::LockState::Locked;
+            break;
+          case NukiLock::LockAction::LockNgo:
+            keyTurnerState.lockState = NukiLock::LockState::UnlockedLnga;
+            break;
+          default:
+            keyTurnerState.lockState = NukiLock::LockState::Unlatched;
+        }
+        duration = lockActionDurationMs;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(duration));
+      sendStatus(client, CommandStatus::Complete);
+      break;
+    }
+    case Command::RequestLogEntries:
+      sendLogEntries(client, payload);
+      break;
+    case Command::RequestKeypadCodes: {
+      std::vector<KeypadEntry> entries;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries = keypadEntries;
+      }
+      sendList(client, Command::KeypadCodeCount, 2, Command::KeypadCode, entries, getUInt16(payload),
+               getUInt16(&payload[2]));
+      break;
+    }
+    case Command::RequestAuthorizationEntries: {
+      std::vector<AuthorizationEntry> entries;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries = authorizationEntries;
+      }
+      sendList(client, Command::AuthorizationEntryCount, 2, Command::AuthorizationEntry, entries, getUInt16(payload),
+               getUInt16(&payload[2]));
+      break;
+    }
+    case Command::RequestTimeControlEntries: {
+      std::vector<NukiLock::TimeControlEntry> entries;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries = timeControlEntries;
+      }
+      sendList(client, Command::TimeControlEntryCount, 1, Command::TimeControlEntry, entries, 0, UINT16_MAX);
+      break;
+    }
+    default:
+      sendStatus(client, CommandStatus::Complete);
+  }
+}
+
+bool SimulatedLock::checkChallenge(NimBLEClient* client, const Command command, const uint8_t* nonce) {
+  //a challenge is only valid for one command
+  bool valid = challengeValid && memcmp(nonce, challenge, sizeof(challenge)) == 0;
+  challengeValid = false;
+  if (!valid) {
+    sendError(client, true, NukiLock::ErrorCode::K_ERROR_BAD_NONCE, command);
+  }
+  return valid;
+}
+
+bool SimulatedLock::checkPin(NimBLEClient* client, const Command command, const uint8_t* pin) {
+  uint16_t expected;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    expected = securityPin;
+  }
+  if (getUInt16(pin) != expected) {
+    sendError(client, true, NukiLock::ErrorCode::K_ERROR_BAD_PIN, command);
+    return false;
+  }
+  return true;
+}
+
+void SimulatedLock::sendLogEntries(NimBLEClient* client, const uint8_t* payload) {
+  /*
+  #  start index  #  count   #  sort order  #  total count  #
+  #  4 byte       #  2 byte  #  1 byte      #  1 byte       #
+  */
+  uint32_t startIndex = getUInt32(payload);
+  uint16_t count = getUInt16(&payload[4]);
+  bool descending = payload[6] != 0;
+  bool totalCount = payload[7] != 0;
+
+  std::vector<NukiLock::LogEntry> entries;
+  bool sendComplete;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries = logEntries;
+    sendComplete = listStatusComplete;
+  }
+
+  if (totalCount) {
+    std::vector<uint8_t> countFrame = {1};
+    putUInt16(countFrame, entries.size());
+    sendEncrypted(client, Command::LogEntryCount, countFrame.data(), countFrame.size());
+  }
+
+  //start index 0 starts at the oldest (ascending) or the most recent (descending) entry
+  uint16_t sent = 0;
+  if (descending) {
+    for (auto it = entries.rbegin(); it != entries.rend() && sent < count; it++) {
+      if (startIndex == 0 || it->index <= startIndex) {
+        sendEncrypted(client, Command::LogEntry, (uint8_t*)&*it, sizeof(*it));
+        sent++;
+      }
+    }
+  } else {
+    for (auto it = entries.begin(); it != entries.end() && sent < count; it++) {
+      if (it->index >= startIndex) {
+        sendEncrypted(client, Command::LogEntry, (uint8_t*)&*it, sizeof(*it));
+        sent++;
+      }
+    }
+  }
+  if (sendComplete) {
+    sendStatus(client, CommandStatus::Complete);
+  }
+}
+
+template <typename TEntry>
+void SimulatedLock::sendList(NimBLEClient* client, const Command countCommand, const uint8_t countSize,
+                             const Command entryCommand, const std::vector<TEntry>& entries, const uint16_t offset,
+                             const uint16_t count) {
+  bool sendComplete;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    sendComplete = listStatusComplete;
+  }
+  std::vector<uint8_t> countFrame;
+  putUInt16(countFrame, entries.size());
+  sendEncrypted(client, countCommand, countFrame.data(), countSize);
+
+  for (size_t i = offset; i < entries.size() && i - offset < count; i++) {
+    sendEncrypted(client, entryCommand, (uint8_t*)&entries[i], sizeof(TEntry));
+  }
+  if (sendComplete) {
+    sendStatus(client, CommandStatus::Complete);
+  }
+}
+
+void SimulatedLock::sendPlain(NimBLEClient* client, const Command command, const uint8_t* payload,
+                              const size_t payloadLen) {
+  std::vector<uint8_t> frame;
+  putUInt16(frame, (uint16_t)command);
+  frame.insert(frame.end(), payload, payload + payloadLen);
+  putUInt16(frame, crc16(frame.data(), frame.size()));
+
+  uint32_t delayUs;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    delayUs = replyDelayUs;
+  }
+  if (delayUs > 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(delayUs));
+  }
+  if (client->hostNotify(NukiLock::keyturnerGdioUUID, frame.data(), frame.size())) {
+    sentFrameCount++;
+  }
+}
+
+void SimulatedLock::sendEncrypted(NimBLEClient* client, const Command command, const uint8_t* payload,
+                                  const size_t payloadLen) {
+  std::vector<uint8_t> plain;
+  putUInt32(plain, authorizationId);
+  putUInt16(plain, (uint16_t)command);
+  plain.insert(plain.end(), payload, payload + payloadLen);
+  putUInt16(plain, crc16(plain.data(), plain.size()));
+
+  std::vector<uint8_t> frame(crypto_secretbox_NONCEBYTES);
+  randombytes_buf(frame.data(), crypto_secretbox_NONCEBYTES);
+  putUInt32(frame, authorizationId);
+  putUInt16(frame, plain.size() + crypto_secretbox_MACBYTES);
+  size_t headerSize = frame.size();
+  frame.resize(headerSize + crypto_secretbox_MACBYTES + plain.size());
+  crypto_secretbox_easy(&frame[headerSize], plain.data(), plain.size(), frame.data(), secretKey);
+
+  uint32_t delayUs;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    delayUs = replyDelayUs;
+  }
+  if (delayUs > 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(delayUs));
+  }
+  if (client->hostNotify(NukiLock::keyturnerUserDataUUID, frame.data(), frame.size())) {
+    sentFrameCount++;
+  }
+}
+
+void SimulatedLock::sendStatus(NimBLEClient* client, const CommandStatus status) {
+  uint8_t payload = (uint8_t)status;
+  sendEncrypted(client, Command::Status, &payload, 1);
+}
+
+void SimulatedLock::sendError(NimBLEClient* client, const bool encrypted, const NukiLock::ErrorCode error,
+                              const Command command) {
+  errorCount++;
+  std::vector<uint8_t> payload = {(uint8_t)error};
+  putUInt16(payload, (uint16_t)command);
+  if (encrypted) {
+    sendEncrypted(client, Command::ErrorReport, payload.data(), payload.size());
+  } else {
+    sendPlain(client, Command::ErrorReport, payload.data(), payload.size());
+  }
+}
+
+void SimulatedLock::newChallenge() {
+  randombytes_buf(challenge, sizeof(challenge));
+  challengeValid = true;
+}
+
+} // namespace Nuki
@@ -0,0 +1,205 @@
+#pragma once
+
+/**
+ * @file SimulatedLock.h
+ * Smart lock at the other end of the simulated BLE link of the host build. Implements the pairing on the GDIO
+ * characteristic and the encrypted commands on the USDIO characteristic that the host tests and benchmarks use, with
+ * its own crc and crypto so the frames of the library are checked against an independent implementation.
+ *
+ * Frames are handled by a worker thread in the order they are written, the replies are sent from that thread like
+ * notifications arrive from the NimBLE host task on the ESP32
+ *
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ */
+
+#include "NimBLEDevice.h"
+#include "BleScanner.h"
+#include "NukiConstants.h"
+#include "NukiLockConstants.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace Nuki {
+
+class SimulatedLock : public NimBLEHostPeripheral {
+  public:
+    SimulatedLock(const std::string& address = "54:d2:72:00:00:01");
+    virtual ~SimulatedLock();
+
+    /**
+     * @brief Makes the lock reachable and starts handling frames
+     */
+    void start();
+
+    /**
+     * @brief Drops all connections and stops handling frames, frames not handled yet are discarded
+     */
+    void stop();
+
+    NimBLEAddress getAddress() const;
+
+    /**
+     * @brief Pairing is only accepted in pairing mode, like after pressing the button of the lock for 5 s
+     */
+    void setPairingMode(const bool enable);
+
+    /**
+     * @brief Sends one advertisement to the scanner: pairing service data in pairing mode, the iBeacon otherwise
+     *
+     * @param stateChanged sets the bit in the iBeacon telling that the state of the lock changed
+     */
+    void advertise(BleScanner::Scanner& scanner, const bool stateChanged = false);
+
+    /**
+     * @brief Lock side of a link, drops the connection of all clients
+     */
+    void disconnectClients();
+
+    bool isPaired() const;
+    uint32_t getAuthorizationId() const;
+
+    void setSecurityPin(const uint16_t pin);
+
+    /**
+     * @brief Delay before each reply frame, 0 replies immediately
+     */
+    void setReplyDelay(const uint32_t delayUs);
+
+    /**
+     * @brief Answers the next commands (not the challenge requests) with K_ERROR_BUSY
+     */
+    void injectBusy(const uint16_t nrOfCommands);
+
+    /**
+     * @brief Whether the entries of a list request are followed by a Status COMPLETE frame, true by default
+     */
+    void setListStatusComplete(const bool send);
+
+    /**
+     * @brief Time between the Status ACCEPTED and the Status COMPLETE of a lock action, the time the motor turns
+     */
+    void setLockActionDuration(const uint32_t durationMs);
+
+    /**
+     * @brief Waits until all written frames are handled and their replies are sent
+     *
+     * @return false on timeout
+     */
+    bool waitIdle(const uint32_t timeoutMs = 1000);
+
+    void setKeyTurnerState(const NukiLock::KeyTurnerState& state);
+    NukiLock::KeyTurnerState getKeyTurnerState();
+    void setConfig(const NukiLock::Config& config);
+    void setBatteryReport(const NukiLock::BatteryReport& report);
+
+    /**
+     * @brief Log entries by ascending index
+     */
+    void setLogEntries(const std::vector<NukiLock::LogEntry>& entries);
+    void setKeypadEntries(const std::vector<KeypadEntry>& entries);
+    void setAuthorizationEntries(const std::vector<AuthorizationEntry>& entries);
+    void setTimeControlEntries(const std::vector<NukiLock::TimeControlEntry>& entries);
+
+    uint32_t getConnectCount() const;
+    uint32_t getReceivedFrameCount() const;
+    uint32_t getSentFrameCount() const;
+
+    /**
+     * @brief Errors sent to the client, e.g. for a bad crc, nonce or pin
+     */
+    uint32_t getErrorCount() const;
+
+    /**
+     * @brief Log entry with the given index and timestamp, other fields filled with test data
+     */
+    static NukiLock::LogEntry makeLogEntry(const uint32_t index, const uint32_t authId = 1, const uint16_t year = 2024);
+
+    /**
+     * @brief Bitwise CRC-16/CCITT-FALSE, kept separate from the implementation of the library
+     */
+    static uint16_t crc16(const uint8_t* data, const size_t length);
+
+    //NimBLEHostPeripheral
+    bool hasCharacteristic(const NimBLEUUID& serviceUUID, const NimBLEUUID& characteristicUUID) override;
+    bool onConnect(NimBLEClient* client) override;
+    void onDisconnect(NimBLEClient* client) override;
+    bool onWrite(NimBLEClient* client, const NimBLEUUID& characteristicUUID, const uint8_t* data,
+                 const size_t length) override;
+
+  private:
+    struct Frame {
+      NimBLEClient* client;
+      bool encrypted;
+      std::vector<uint8_t> data;
+    };
+
+    void run();
+    void handlePlainFrame(NimBLEClient* client, const std::vector<uint8_t>& frame);
+    void handleEncryptedFrame(NimBLEClient* client, const std::vector<uint8_t>& frame);
+    void handleCommand(NimBLEClient* client, const Command command, const uint8_t* payload, const size_t payloadLen);
+    bool checkChallenge(NimBLEClient* client, const Command command, const uint8_t* nonce);
+    bool checkPin(NimBLEClient* client, const Command command, const uint8_t* pin);
+    void sendLogEntries(NimBLEClient* client, const uint8_t* payload);
+
+    template <typename TEntry>
+    void sendList(NimBLEClient* client, const Command countCommand, const uint8_t countSize, const Command entryCommand,
+                  const std::vector<TEntry>& entries, const uint16_t offset, const uint16_t count);
+
+    void sendPlain(NimBLEClient* client, const Command command, const uint8_t* payload, const size_t payloadLen);
+    void sendEncrypted(NimBLEClient* client, const Command command, const uint8_t* payload, const size_t payloadLen);
+    void sendStatus(NimBLEClient* client, const CommandStatus status);
+    void sendError(NimBLEClient* client, const bool encrypted, const NukiLock::ErrorCode error, const Command command);
+    void newChallenge();
+
+    NimBLEAddress address;
+
+    std::mutex mutex;
+    std::condition_variable framesAvailable;
+    std::condition_variable idle;
+    std::deque<Frame> frames;
+    std::set<NimBLEClient*> clients;
+    std::thread worker;
+    bool running = false;
+    bool handlingFrame = false;
+
+    //only used by the worker thread
+    uint8_t clientPublicKey[32] = {};
+    uint8_t challenge[32] = {};
+    bool challengeValid = false;
+
+    //set by the test, read by the worker thread under mutex
+    bool pairingMode = false;
+    uint16_t securityPin = 0;
+    uint32_t replyDelayUs = 0;
+    uint16_t busyCommands = 0;
+    bool listStatusComplete = true;
+    uint32_t lockActionDurationMs = 250;
+    NukiLock::KeyTurnerState keyTurnerState;
+    NukiLock::Config config;
+    NukiLock::BatteryReport batteryReport;
+    std::vector<NukiLock::LogEntry> logEntries;
+    std::vector<KeypadEntry> keypadEntries;
+    std::vector<AuthorizationEntry> authorizationEntries;
+    std::vector<NukiLock::TimeControlEntry> timeControlEntries;
+
+    uint8_t publicKey[32] = {};
+    uint8_t privateKey[32] = {};
+    uint8_t secretKey[32] = {};
+    uint8_t lockId[16] = {};
+    std::atomic<bool> paired{false};
+    std::atomic<uint32_t> authorizationId{0};
+    uint32_t nextAuthorizationId = 1;
+
+    std::atomic<uint32_t> connectCount{0};
+    std::atomic<uint32_t> receivedFrameCount{0};
+    std::atomic<uint32_t> sentFrameCount{0};
+    std::atomic<uint32_t> errorCount{0};
+};
+
+} // namespace Nuki
@@ -0,0 +1,50 @@
+#pragma once
+
+/**
+ * @file SimulatedLockSetup.h
+ * A NukiLock paired with a SimulatedLock over the simulated link, shared by the host tests and benchmarks
+ *
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ */
+
+#include "NukiLock.h"
+#include "SimulatedLock.h"
+#include "Preferences.h"
+#include <memory>
+
+namespace Nuki {
+
+class SimulatedLockSetup {
+  public:
+    SimulatedLockSetup(const std::string& address = "54:d2:72:00:00:01")
+      : simulatedLock(address) {
+      //every setup starts without stored credentials, log sync index or nonce counter
+      hostErasePreferences();
+      simulatedLock.start();
+      lock.reset(new NukiLock::NukiLock("NukiHost", 0x2a));
+      lock->initialize();
+      lock->registerBleScanner(&scanner);
+    }
+
+    ~SimulatedLockSetup() {
+      //no notification may reach the lock while it is deleted
+      simulatedLock.stop();
+      lock.reset();
+    }
+
+    /**
+     * @brief Pairs the lock like a user would: lock in pairing mode, advertisement received, pairNuki()
+     */
+    bool pair() {
+      simulatedLock.setPairingMode(true);
+      simulatedLock.advertise(scanner);
+      return lock->pairNuki(AuthorizationIdType::Bridge) == PairingResult::Success;
+    }
+
+    BleScanner::Scanner scanner;
+    SimulatedLock simulatedLock;
+    std::unique_ptr<NukiLock::NukiLock> lock;
+};
+
+} // namespace Nuki
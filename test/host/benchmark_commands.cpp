@@ -0,0 +1,100 @@
+#include "SimulatedLockSetup.h"
+#include <benchmark/benchmark.h>
+
+/*
+Round trips of commands over the simulated link, the time is spent in the library (framing, crc, crypto, state
+machines, list collection) and the simulated lock, not on the air. A reply delay can be given to the simulated lock
+to see how a connection interval adds up per frame
+*/
+
+using Nuki::CmdResult;
+using Nuki::SimulatedLock;
+
+namespace {
+
+Nuki::SimulatedLockSetup& pairedSetup() {
+  static Nuki::SimulatedLockSetup* setup = nullptr;
+  if (setup == nullptr) {
+    setup = new Nuki::SimulatedLockSetup();
+    if (!setup->pair()) {
+      fprintf(stderr, "Pairing with the simulated lock failed\n");
+      abort();
+    }
+  }
+  //commands are refused without a recent heartbeat of the lock
+  setup->simulatedLock.advertise(setup->scanner);
+  setup->simulatedLock.setReplyDelay(0);
+  return *setup;
+}
+
+void BM_RequestKeyTurnerState(benchmark::State& state) {
+  Nuki::SimulatedLockSetup& setup = pairedSetup();
+  setup.simulatedLock.setReplyDelay(state.range(0));
+  NukiLock::KeyTurnerState received;
+  for (auto _ : state) {
+    if (setup.lock->requestKeyTurnerState(&received) != CmdResult::Success) {
+      state.SkipWithError("request failed");
+      break;
+    }
+  }
+}
+BENCHMARK(BM_RequestKeyTurnerState)->Arg(0)->Arg(1000)->Unit(benchmark::kMicrosecond);
+
+void BM_RequestConfig(benchmark::State& state) {
+  Nuki::SimulatedLockSetup& setup = pairedSetup();
+  NukiLock::Config config;
+  for (auto _ : state) {
+    //challenge, then the config
+    setup.lock->invalidateConfigCache();
+    if (setup.lock->requestConfig(&config) != CmdResult::Success) {
+      state.SkipWithError("request failed");
+      break;
+    }
+  }
+}
+BENCHMARK(BM_RequestConfig)->Unit(benchmark::kMicrosecond);
+
+void BM_RetrieveLogEntries(benchmark::State& state) {
+  Nuki::SimulatedLockSetup& setup = pairedSetup();
+  uint16_t count = state.range(0);
+  std::vector<NukiLock::LogEntry> entries;
+  for (uint32_t index = 1; index <= count; index++) {
+    entries.push_back(SimulatedLock::makeLogEntry(index));
+  }
+  setup.simulatedLock.setLogEntries(entries);
+
+  for (auto _ : state) {
+    if (setup.lock->retrieveLogEntries(0, count, 1, true) != CmdResult::Success
+        || setup.lock->getLogEntryBuffer().size() != count) {
+      state.SkipWithError("retrieval failed");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_RetrieveLogEntries)->Arg(1)->Arg(10)->Arg(LOG_ENTRIES_BUFFER_SIZE)->Unit(benchmark::kMicrosecond);
+
+void BM_RetrieveKeypadEntries(benchmark::State& state) {
+  Nuki::SimulatedLockSetup& setup = pairedSetup();
+  uint16_t count = state.range(0);
+  std::vector<Nuki::KeypadEntry> entries(count);
+  for (uint16_t i = 0; i < count; i++) {
+    memset(&entries[i], 0, sizeof(Nuki::KeypadEntry));
+    entries[i].codeId = i + 1;
+  }
+  setup.simulatedLock.setKeypadEntries(entries);
+
+  for (auto _ : state) {
+    if (setup.lock->retrieveKeypadEntries(0, count) != CmdResult::Success
+        || setup.lock->getKeypadEntryBuffer().size() != count) {
+      state.SkipWithError("retrieval failed");
+      break;
+    }
+    //a Status COMPLETE may follow the last entry, it must not end the list of the next iteration
+    setup.simulatedLock.waitIdle();
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_RetrieveKeypadEntries)->Arg(10)->Arg(KEYPAD_ENTRIES_BUFFER_SIZE)->Unit(benchmark::kMicrosecond);
+
+} // namespace
@@ -0,0 +1,48 @@
+#include "NukiCrc.h"
+#include <benchmark/benchmark.h>
+#include <vector>
+
+/*
+Throughput of the crc over frame sized buffers, the bitwise loop is what the Crc16 library did before
+*/
+
+namespace {
+
+uint16_t crc16Bitwise(const uint8_t* data, const size_t length) {
+  uint16_t crc = CRC16_CCITT_FALSE_INIT;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+std::vector<uint8_t> makeData(const size_t length) {
+  std::vector<uint8_t> data(length);
+  for (size_t i = 0; i < length; i++) {
+    data[i] = i * 31 + 7;
+  }
+  return data;
+}
+
+void BM_CrcTable(benchmark::State& state) {
+  std::vector<uint8_t> data = makeData(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Nuki::crc16CcittFalse(data.data(), data.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_CrcTable)->Arg(9)->Arg(64)->Arg(256)->Arg(1024);
+
+void BM_CrcBitwise(benchmark::State& state) {
+  std::vector<uint8_t> data = makeData(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(crc16Bitwise(data.data(), data.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_CrcBitwise)->Arg(9)->Arg(64)->Arg(256)->Arg(1024);
+
+} // namespace
@@ -0,0 +1,100 @@
+#include "NukiBle.h"
+#include "NukiUtils.h"
+#include "NukiCrypto.h"
+#include "NukiLockConstants.h"
+#include <benchmark/benchmark.h>
+#include <sodium.h>
+
+/*
+The crypto context compared with the encode/decode helpers it replaced, for the lengths of the plain data of frames
+(authorization id, command, payload and crc). A forged message is rejected by the context before anything is decrypted
+*/
+
+namespace {
+
+struct CryptoSetup {
+  explicit CryptoSetup(const uint16_t len)
+    : len(len) {
+    randombytes_buf(secretKey, sizeof(secretKey));
+    randombytes_buf(nonce, sizeof(nonce));
+    randombytes_buf(plainData, sizeof(plainData));
+    crypto.setKey(secretKey);
+    Nuki::encode(encoded, plainData, len, nonce, secretKey);
+    crypto.encrypt(cipherData, mac, plainData, len, nonce);
+  }
+
+  uint16_t len;
+  unsigned char secretKey[crypto_secretbox_KEYBYTES];
+  unsigned char nonce[crypto_secretbox_NONCEBYTES];
+  unsigned char plainData[MAX_FRAME_SIZE];
+  unsigned char encoded[MAX_FRAME_SIZE + crypto_secretbox_MACBYTES];
+  unsigned char cipherData[MAX_FRAME_SIZE];
+  unsigned char mac[crypto_secretbox_MACBYTES];
+  Nuki::CryptoContext crypto;
+};
+
+void BM_EncodeHelper(benchmark::State& state) {
+  CryptoSetup setup(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Nuki::encode(setup.encoded, setup.plainData, setup.len, setup.nonce, setup.secretKey));
+  }
+  state.SetBytesProcessed(state.iterations() * setup.len);
+}
+
+void BM_DecodeHelper(benchmark::State& state) {
+  CryptoSetup setup(state.range(0));
+  for (auto _ : state) {
+    if (Nuki::decode(setup.plainData, setup.encoded, setup.len + crypto_secretbox_MACBYTES, setup.nonce,
+                     setup.secretKey) < 0) {
+      state.SkipWithError("decode failed");
+      break;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * setup.len);
+}
+
+void BM_ContextEncrypt(benchmark::State& state) {
+  CryptoSetup setup(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(setup.crypto.encrypt(setup.cipherData, setup.mac, setup.plainData, setup.len, setup.nonce));
+  }
+  state.SetBytesProcessed(state.iterations() * setup.len);
+}
+
+void BM_ContextDecrypt(benchmark::State& state) {
+  CryptoSetup setup(state.range(0));
+  for (auto _ : state) {
+    if (!setup.crypto.decrypt(setup.plainData, setup.cipherData, setup.mac, setup.len, setup.nonce)) {
+      state.SkipWithError("decrypt failed");
+      break;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * setup.len);
+}
+
+void BM_ContextRejectForged(benchmark::State& state) {
+  CryptoSetup setup(state.range(0));
+  setup.mac[0] ^= 0x01;
+  for (auto _ : state) {
+    if (setup.crypto.decrypt(setup.plainData, setup.cipherData, setup.mac, setup.len, setup.nonce)) {
+      state.SkipWithError("forged message accepted");
+      break;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * setup.len);
+}
+
+//plain data of frames with payloads from none up to a full log entry and the max Action payload
+void plainDataSizes(benchmark::internal::Benchmark* benchmark) {
+  for (int size : {0, 2, 8, 32, (int)sizeof(NukiLock::LogEntry), (int)sizeof(NukiLock::Action::payload)}) {
+    benchmark->Arg(size + 8);
+  }
+}
+
+BENCHMARK(BM_EncodeHelper)->Apply(plainDataSizes);
+BENCHMARK(BM_ContextEncrypt)->Apply(plainDataSizes);
+BENCHMARK(BM_DecodeHelper)->Apply(plainDataSizes);
+BENCHMARK(BM_ContextDecrypt)->Apply(plainDataSizes);
+BENCHMARK(BM_ContextRejectForged)->Apply(plainDataSizes);
+
+} // namespace
@@ -0,0 +1,163 @@
+#include "NukiBle.h"
+#include "NukiUtils.h"
+#include "NukiCrypto.h"
+#include "NukiLockConstants.h"
+#include <benchmark/benchmark.h>
+#include <sodium.h>
+
+/*
+Encrypted frame path without the link: building a frame as sendEncryptedMessage does and opening it as the USDIO
+branch of notifyCallback does. The library functions are compared with the original implementation that used
+intermediate buffers, the bytes copied per frame are reported as a counter
+*/
+
+namespace {
+
+unsigned char authorizationId[4] = {0x01, 0x02, 0x03, 0x04};
+uint32_t bytesCopied = 0;
+
+struct Keys {
+  Keys() {
+    randombytes_buf(secretKey, sizeof(secretKey));
+    crypto.setKey(secretKey);
+  }
+
+  unsigned char secretKey[crypto_secretbox_KEYBYTES];
+  Nuki::CryptoContext crypto;
+};
+
+Keys& keys() {
+  static Keys keys;
+  return keys;
+}
+
+void benchCopy(void* dst, const void* src, size_t len) {
+  memcpy(dst, src, len);
+  bytesCopied += len;
+}
+
+//original implementation of NukiBle::sendEncryptedMessage with intermediate buffers, returns the frame length
+uint16_t encodeFrameLegacy(unsigned char* frame, const unsigned char* payload, const uint8_t payloadLen) {
+  Nuki::Command commandIdentifier = Nuki::Command::RequestData;
+  unsigned char plainData[6 + payloadLen];
+  unsigned char plainDataWithCrc[8 + payloadLen];
+
+  benchCopy(&plainData[0], authorizationId, sizeof(authorizationId));
+  benchCopy(&plainData[4], &commandIdentifier, sizeof(commandIdentifier));
+  benchCopy(&plainData[6], payload, payloadLen);
+  uint16_t dataCrc = Nuki::calculateCrc((uint8_t*)plainData, 0, sizeof(plainData));
+  benchCopy(&plainDataWithCrc[0], plainData, sizeof(plainData));
+  benchCopy(&plainDataWithCrc[sizeof(plainData)], &dataCrc, sizeof(dataCrc));
+
+  unsigned char nonce[crypto_secretbox_NONCEBYTES];
+  randombytes_buf(nonce, sizeof(nonce));
+  unsigned char additionalData[30] = {};
+  benchCopy(&additionalData[0], nonce, sizeof(nonce));
+  benchCopy(&additionalData[24], authorizationId, sizeof(authorizationId));
+
+  unsigned char plainDataEncr[sizeof(plainDataWithCrc) + crypto_secretbox_MACBYTES];
+  Nuki::encode(plainDataEncr, plainDataWithCrc, sizeof(plainDataWithCrc), nonce, keys().secretKey);
+  int16_t length = sizeof(plainDataEncr);
+  benchCopy(&additionalData[28], &length, 2);
+
+  benchCopy(&frame[0], additionalData, sizeof(additionalData));
+  benchCopy(&frame[30], plainDataEncr, sizeof(plainDataEncr));
+  return sizeof(additionalData) + sizeof(plainDataEncr);
+}
+
+//original implementation of the USDIO branch of NukiBle::notifyCallback with intermediate buffers
+bool decodeFrameLegacy(unsigned char* recData) {
+  unsigned char recNonce[crypto_secretbox_NONCEBYTES];
+  unsigned char recAuthorizationId[4];
+  uint16_t encrMsgLen = 0;
+  benchCopy(recNonce, &recData[0], crypto_secretbox_NONCEBYTES);
+  benchCopy(recAuthorizationId, &recData[crypto_secretbox_NONCEBYTES], 4);
+  benchCopy(&encrMsgLen, &recData[crypto_secretbox_NONCEBYTES + 4], 2);
+  unsigned char encrData[encrMsgLen];
+  benchCopy(encrData, &recData[crypto_secretbox_NONCEBYTES + 6], encrMsgLen);
+
+  unsigned char decrData[encrMsgLen - crypto_secretbox_MACBYTES];
+  if (Nuki::decode(decrData, encrData, encrMsgLen, recNonce, keys().secretKey) < 0) {
+    return false;
+  }
+  if (!Nuki::crcValid(decrData, sizeof(decrData))) {
+    return false;
+  }
+  unsigned char payload[sizeof(decrData) - 8];
+  benchCopy(payload, &decrData[6], sizeof(payload));
+  return true;
+}
+
+uint16_t encodeFrame(unsigned char* frame, const unsigned char* payload, const uint8_t payloadLen) {
+  unsigned char nonce[crypto_secretbox_NONCEBYTES];
+  randombytes_buf(nonce, sizeof(nonce));
+  //authorization id, command, payload and crc in the plain data + nonce, authorization id and length in the header
+  bytesCopied += 4 + 2 + payloadLen + 2 + crypto_secretbox_NONCEBYTES + 4 + 2;
+  return Nuki::buildEncryptedFrame(frame, MAX_FRAME_SIZE, authorizationId, Nuki::Command::RequestData,
+                                   payload, payloadLen, nonce, keys().crypto);
+}
+
+bool decodeFrame(unsigned char* recData, const uint16_t frameLen) {
+  unsigned char plainData[MAX_FRAME_SIZE];
+  int16_t plainDataLen = Nuki::openEncryptedFrame(plainData, sizeof(plainData), recData, frameLen, keys().crypto);
+  if (plainDataLen < 8) {
+    return false;
+  }
+  uint16_t returnCode = 0;
+  benchCopy(&returnCode, &plainData[4], 2);
+  benchmark::DoNotOptimize(returnCode);
+  return true;
+}
+
+void setFrameCounters(benchmark::State& state, const uint16_t frameLen) {
+  state.counters["frame"] = frameLen;
+  state.counters["copied"] = benchmark::Counter(bytesCopied, benchmark::Counter::kAvgIterations);
+  state.SetBytesProcessed(state.iterations() * frameLen);
+}
+
+template <bool legacy>
+void BM_EncodeFrame(benchmark::State& state) {
+  unsigned char payload[sizeof(NukiLock::Action::payload)];
+  unsigned char frame[MAX_FRAME_SIZE];
+  randombytes_buf(payload, sizeof(payload));
+  uint8_t payloadLen = state.range(0);
+
+  bytesCopied = 0;
+  uint16_t frameLen = 0;
+  for (auto _ : state) {
+    frameLen = legacy ? encodeFrameLegacy(frame, payload, payloadLen) : encodeFrame(frame, payload, payloadLen);
+    benchmark::DoNotOptimize(frame);
+  }
+  setFrameCounters(state, frameLen);
+}
+
+template <bool legacy>
+void BM_DecodeFrame(benchmark::State& state) {
+  unsigned char payload[sizeof(NukiLock::Action::payload)];
+  unsigned char frame[MAX_FRAME_SIZE];
+  randombytes_buf(payload, sizeof(payload));
+  uint16_t frameLen = encodeFrame(frame, payload, state.range(0));
+
+  bytesCopied = 0;
+  for (auto _ : state) {
+    if (!(legacy ? decodeFrameLegacy(frame) : decodeFrame(frame, frameLen))) {
+      state.SkipWithError("frame not valid");
+      break;
+    }
+  }
+  setFrameCounters(state, frameLen);
+}
+
+//payload sizes from small commands up to a full log entry and the max Action payload
+void payloadSizes(benchmark::internal::Benchmark* benchmark) {
+  for (int size : {0, 2, 8, 32, (int)sizeof(NukiLock::LogEntry), (int)sizeof(NukiLock::Action::payload)}) {
+    benchmark->Arg(size);
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_EncodeFrame, true)->Name("BM_EncodeFrameLegacy")->Apply(payloadSizes);
+BENCHMARK_TEMPLATE(BM_EncodeFrame, false)->Name("BM_EncodeFrame")->Apply(payloadSizes);
+BENCHMARK_TEMPLATE(BM_DecodeFrame, true)->Name("BM_DecodeFrameLegacy")->Apply(payloadSizes);
+BENCHMARK_TEMPLATE(BM_DecodeFrame, false)->Name("BM_DecodeFrame")->Apply(payloadSizes);
+
+} // namespace
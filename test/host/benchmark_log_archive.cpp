@@ -0,0 +1,129 @@
+#include "NukiLogArchive.h"
+#include "NukiLockConstants.h"
+#include <benchmark/benchmark.h>
+#include <vector>
+
+/*
+Append and range query throughput of the log archive on the in-memory file system, the time is spent in the archive
+(segment index, record crc, binary search) and not on flash. The bytes written per entry show the flash wear
+*/
+
+namespace {
+
+#define ARCHIVE_BENCHMARK_ENTRIES 4096
+#define ARCHIVE_BENCHMARK_QUERY_RANGE 50
+
+typedef Nuki::LogArchive<NukiLock::LogEntry> Archive;
+
+//entry number i, one entry every 10 minutes starting 2022-01-01
+NukiLock::LogEntry createEntry(const uint32_t i) {
+  NukiLock::LogEntry entry = {};
+  uint32_t minutes = i * 10;
+  entry.index = i + 1;
+  entry.timeStampYear = 2022;
+  entry.timeStampMonth = 1 + (minutes / (28 * 24 * 60)) % 12;
+  entry.timeStampDay = 1 + (minutes / (24 * 60)) % 28;
+  entry.timeStampHour = (minutes / 60) % 24;
+  entry.timeStampMinute = minutes % 60;
+  entry.authId = i % 8;
+  snprintf((char*)entry.name, sizeof(entry.name), "user %u", entry.authId);
+  entry.loggingType = NukiLock::LoggingType::LockAction;
+  return entry;
+}
+
+void fill(Archive& archive) {
+  std::vector<NukiLock::LogEntry> entries;
+  for (uint32_t i = 0; i < ARCHIVE_BENCHMARK_ENTRIES; i++) {
+    entries.push_back(createEntry(i));
+  }
+  archive.appendAll(entries);
+}
+
+void BM_ArchiveAppend(benchmark::State& state) {
+  uint16_t batchSize = state.range(0);
+  std::vector<NukiLock::LogEntry> batch(batchSize);
+  fs::FS fileSystem;
+  Archive archive(fileSystem, "/nukibench");
+  archive.begin();
+  uint32_t next = 0;
+  size_t bytesWritten = fileSystem.getBytesWritten();
+
+  for (auto _ : state) {
+    for (uint16_t j = 0; j < batchSize; j++) {
+      batch[j] = createEntry(next++);
+    }
+    if (archive.appendAll(batch) != batchSize) {
+      state.SkipWithError("entries not appended");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * batchSize);
+  //bytes written per entry
+  state.counters["written"] = benchmark::Counter((double)(fileSystem.getBytesWritten() - bytesWritten) / batchSize,
+                                                 benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ArchiveAppend)->Arg(1)->Arg(16)->Arg(256);
+
+void BM_ArchiveQueryByIndex(benchmark::State& state) {
+  fs::FS fileSystem;
+  Archive archive(fileSystem, "/nukibench");
+  archive.begin();
+  fill(archive);
+  uint32_t firstIndex = archive.getFirstIndex();
+  uint32_t span = archive.getLastIndex() - firstIndex - ARCHIVE_BENCHMARK_QUERY_RANGE;
+
+  uint32_t query = 0;
+  for (auto _ : state) {
+    uint32_t from = firstIndex + (query++ * 997) % span;
+    uint32_t expected = from;
+    size_t found = archive.queryByIndex(from, from + ARCHIVE_BENCHMARK_QUERY_RANGE - 1, [&](const NukiLock::LogEntry& entry) {
+      return entry.index == expected++;
+    });
+    if (found != ARCHIVE_BENCHMARK_QUERY_RANGE) {
+      state.SkipWithError("wrong result");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * ARCHIVE_BENCHMARK_QUERY_RANGE);
+}
+BENCHMARK(BM_ArchiveQueryByIndex);
+
+void BM_ArchiveQueryByTime(benchmark::State& state) {
+  fs::FS fileSystem;
+  Archive archive(fileSystem, "/nukibench");
+  archive.begin();
+  fill(archive);
+  //one day of entries
+  uint32_t from = Nuki::toLogTimestamp(2022, 1, 3, 0, 0, 0);
+  uint32_t to = Nuki::toLogTimestamp(2022, 1, 3, 23, 59, 59);
+
+  for (auto _ : state) {
+    size_t found = archive.queryByTime(from, to, [](const NukiLock::LogEntry& entry) {
+      return true;
+    });
+    if (found != 24 * 6) {
+      state.SkipWithError("wrong result");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * 24 * 6);
+}
+BENCHMARK(BM_ArchiveQueryByTime);
+
+void BM_ArchiveBegin(benchmark::State& state) {
+  fs::FS fileSystem;
+  Archive archive(fileSystem, "/nukibench");
+  archive.begin();
+  fill(archive);
+  uint32_t records = archive.size();
+
+  for (auto _ : state) {
+    if (!archive.begin() || archive.size() != records) {
+      state.SkipWithError("wrong result");
+      break;
+    }
+  }
+}
+BENCHMARK(BM_ArchiveBegin)->Unit(benchmark::kMicrosecond);
+
+} // namespace
@@ -0,0 +1,97 @@
+#include "Arduino.h"
+#include <chrono>
+#include <cstdarg>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace {
+
+const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+int initialLogLevel() {
+  const char* level = getenv("NUKI_HOST_LOG_LEVEL");
+  return level != nullptr ? atoi(level) : HOST_LOG_WARN;
+}
+
+std::mutex& randomMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+} // namespace
+
+int hostLogLevel = initialLogLevel();
+HostSerial Serial;
+
+unsigned long millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void delay(uint32_t ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void hostLog(const int level, const char* format, ...) {
+  if (level > hostLogLevel) {
+    return;
+  }
+  static const char levels[] = {'N', 'E', 'W', 'I', 'D'};
+  char message[512];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  fprintf(stderr, "[%6lu][%c] %s\n", millis(), levels[level], message);
+}
+
+void HostSerial::print(const char* text) {
+  fputs(text, stdout);
+}
+
+void HostSerial::print(const std::string& text) {
+  fputs(text.c_str(), stdout);
+}
+
+void HostSerial::print(const char c) {
+  fputc(c, stdout);
+}
+
+void HostSerial::print(const int value) {
+  fprintf(stdout, "%d", value);
+}
+
+void HostSerial::println() {
+  fputc('\n', stdout);
+}
+
+void HostSerial::println(const char* text) {
+  fputs(text, stdout);
+  fputc('\n', stdout);
+}
+
+void HostSerial::printf(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  vfprintf(stdout, format, args);
+  va_end(args);
+}
+
+void esp_fill_random(void* buffer, size_t length) {
+  static std::mt19937 generator(std::random_device{}());
+  std::lock_guard<std::mutex> lock(randomMutex());
+  uint8_t* bytes = static_cast<uint8_t*>(buffer);
+  for (size_t i = 0; i < length; i++) {
+    bytes[i] = generator() & 0xff;
+  }
+}
+
+uint32_t esp_random() {
+  uint32_t value;
+  esp_fill_random(&value, sizeof(value));
+  return value;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+/**
+ * @file Arduino.h
+ * Host stand-in for the parts of the Arduino core for ESP32 used by the library, for the host tests and benchmarks.
+ * millis()/micros() run from process start, log_x() prints to stderr when the level is enabled in hostLogLevel
+ *
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <string>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_system.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+
+#define HOST_LOG_NONE 0
+#define HOST_LOG_ERROR 1
+#define HOST_LOG_WARN 2
+#define HOST_LOG_INFO 3
+#define HOST_LOG_DEBUG 4
+
+//highest level printed, HOST_LOG_WARN unless changed by the test or the NUKI_HOST_LOG_LEVEL environment variable
+extern int hostLogLevel;
+void hostLog(const int level, const char* format, ...);
+
+#define log_e(format, ...) hostLog(HOST_LOG_ERROR, format, ##__VA_ARGS__)
+#define log_w(format, ...) hostLog(HOST_LOG_WARN, format, ##__VA_ARGS__)
+#define log_i(format, ...) hostLog(HOST_LOG_INFO, format, ##__VA_ARGS__)
+#define log_d(format, ...) hostLog(HOST_LOG_DEBUG, format, ##__VA_ARGS__)
+#define log_v(format, ...) hostLog(HOST_LOG_DEBUG, format, ##__VA_ARGS__)
+
+class HostSerial {
+  public:
+    void begin(const unsigned long) {}
+    void print(const char* text);
+    void print(const std::string& text);
+    void print(const char c);
+    void print(const int value);
+    void println();
+    void println(const char* text);
+    void printf(const char* format, ...);
+};
+
+extern HostSerial Serial;
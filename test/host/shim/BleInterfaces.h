@@ -0,0 +1,29 @@
+#pragma once
+
+/**
+ * @file BleInterfaces.h
+ * Host copy of the publisher/subscriber interfaces of https://github.com/I-Connect/BleScanner
+ *
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ */
+
+#include "NimBLEDevice.h"
+
+namespace BleScanner {
+
+class Subscriber {
+  public:
+    virtual ~Subscriber() {}
+    virtual void onResult(NimBLEAdvertisedDevice* advertisedDevice) = 0;
+};
+
+class Publisher {
+  public:
+    virtual ~Publisher() {}
+    virtual void subscribe(Subscriber* subscriber) = 0;
+    virtual void unsubscribe(Subscriber* subscriber) = 0;
+    virtual void enableScanning(bool enable) = 0;
+};
+
+} // namespace BleScanner
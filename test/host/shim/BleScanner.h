@@ -0,0 +1,70 @@
+#pragma once
+
+/**
+ * @file BleScanner.h
+ * Host stand-in for the scanner of https://github.com/I-Connect/BleScanner, advertisements are handed to it with
+ * publish() instead of being received by a radio
+ *
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ */
+
+#include "BleInterfaces.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace BleScanner {
+
+class Scanner : public Publisher {
+  public:
+    void initialize(const std::string& deviceName = "", const bool wantDuplicates = false,
+                    const uint16_t interval = 0, const uint16_t window = 0) {}
+
+    void update() {}
+
+    void subscribe(Subscriber* subscriber) override {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (std::find(subscribers.begin(), subscribers.end(), subscriber) == subscribers.end()) {
+        subscribers.push_back(subscriber);
+      }
+    }
+
+    void unsubscribe(Subscriber* subscriber) override {
+      std::lock_guard<std::mutex> lock(mutex);
+      subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), subscriber), subscribers.end());
+    }
+
+    void enableScanning(bool enable) override {
+      scanning = enable;
+    }
+
+    bool isScanning() const {
+      return scanning;
+    }
+
+    /**
+     * @brief Hands the advertisement to all subscribers, dropped while scanning is disabled like on a real radio
+     */
+    void publish(NimBLEAdvertisedDevice* advertisedDevice) {
+      if (!scanning) {
+        return;
+      }
+      std::vector<Subscriber*> targets;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        targets = subscribers;
+      }
+      for (Subscriber* subscriber : targets) {
+        subscriber->onResult(advertisedDevice);
+      }
+    }
+
+  private:
+    std::mutex mutex;
+    std::vector<Subscriber*> subscribers;
+    std::atomic<bool> scanning{true};
+};
+
+} // namespace BleScanner
@@ -0,0 +1,257 @@
+#include "FS.h"
+#include <algorithm>
+#include <cstring>
+
+namespace fs {
+
+namespace {
+
+std::string parentOf(const std::string& path) {
+  size_t separator = path.find_last_of('/');
+  return separator == 0 || separator == std::string::npos ? "/" : path.substr(0, separator);
+}
+
+std::string nameOf(const std::string& path) {
+  return path.substr(path.find_last_of('/') + 1);
+}
+
+} // namespace
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+  if (!storage || directory || !writable) {
+    return 0;
+  }
+  std::lock_guard<std::recursive_mutex> lock(storage->mutex);
+  std::vector<uint8_t>& data = storage->files[filePath];
+  if (append) {
+    filePosition = data.size();
+  }
+  if (filePosition + size > data.size()) {
+    data.resize(filePosition + size);
+  }
+  memcpy(data.data() + filePosition, buffer, size);
+  filePosition += size;
+  storage->bytesWritten += size;
+  return size;
+}
+
+size_t File::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+  if (!storage || directory) {
+    return 0;
+  }
+  std::lock_guard<std::recursive_mutex> lock(storage->mutex);
+  const std::vector<uint8_t>& data = storage->files[filePath];
+  size_t length = filePosition >= data.size() ? 0 : std::min(size, data.size() - filePosition);
+  memcpy(buffer, data.data() + filePosition, length);
+  filePosition += length;
+  return length;
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::available() {
+  size_t fileSize = size();
+  return filePosition < fileSize ? fileSize - filePosition : 0;
+}
+
+bool File::seek(uint32_t position, SeekMode mode) {
+  if (!storage || directory) {
+    return false;
+  }
+  size_t target = position;
+  if (mode == SeekCur) {
+    target = filePosition + position;
+  } else if (mode == SeekEnd) {
+    target = size() - position;
+  }
+  if (target > size()) {
+    return false;
+  }
+  filePosition = target;
+  return true;
+}
+
+size_t File::position() const {
+  return filePosition;
+}
+
+size_t File::size() const {
+  if (!storage || directory) {
+    return 0;
+  }
+  std::lock_guard<std::recursive_mutex> lock(storage->mutex);
+  auto file = storage->files.find(filePath);
+  return file != storage->files.end() ? file->second.size() : 0;
+}
+
+void File::close() {
+  storage.reset();
+}
+
+File::operator bool() const {
+  return (bool)storage;
+}
+
+const char* File::path() const {
+  return filePath.c_str();
+}
+
+const char* File::name() const {
+  return fileName.c_str();
+}
+
+bool File::isDirectory() const {
+  return storage && directory;
+}
+
+File File::openNextFile(const char* mode) {
+  File file;
+  if (storage && directory && nextEntry < entries.size()) {
+    std::string path = (filePath == "/" ? "" : filePath) + "/" + entries[nextEntry++];
+    FS fileSystem;
+    fileSystem.storage = storage;
+    file = fileSystem.open(path.c_str(), mode);
+  }
+  return file;
+}
+
+void File::rewindDirectory() {
+  nextEntry = 0;
+}
+
+FS::FS() : storage(std::make_shared<MemoryStorage>()) {}
+
+File FS::open(const char* path, const char* mode, const bool create) {
+  File file;
+  std::string filePath = path;
+  std::lock_guard<std::recursive_mutex> lock(storage->mutex);
+
+  if (filePath == "/" || storage->directories.count(filePath) > 0) {
+    file.storage = storage;
+    file.filePath = filePath;
+    file.fileName = nameOf(filePath);
+    file.directory = true;
+    //direct children only, files and directories
+    std::string prefix = filePath == "/" ? "/" : filePath + "/";
+    for (const auto& entry : storage->files) {
+      if (entry.first.compare(0, prefix.size(), prefix) == 0 && entry.first.find('/', prefix.size()) == std::string::npos) {
+        file.entries.push_back(entry.first.substr(prefix.size()));
+      }
+    }
+    for (const std::string& directory : storage->directories) {
+      if (directory.compare(0, prefix.size(), prefix) == 0 && directory.size() > prefix.size()
+          && directory.find('/', prefix.size()) == std::string::npos) {
+        file.entries.push_back(directory.substr(prefix.size()));
+      }
+    }
+    return file;
+  }
+
+  bool exists = storage->files.count(filePath) > 0;
+  if (mode[0] == 'r' && !exists) {
+    return file;
+  }
+  if (!exists && parentOf(filePath) != "/" && storage->directories.count(parentOf(filePath)) == 0) {
+    //LittleFS only creates the parent directories when asked to
+    if (!create) {
+      return file;
+    }
+    mkdir(parentOf(filePath));
+  }
+  if (mode[0] == 'w') {
+    storage->files[filePath].clear();
+  } else {
+    storage->files[filePath];
+  }
+  file.storage = storage;
+  file.filePath = filePath;
+  file.fileName = nameOf(filePath);
+  file.writable = mode[0] != 'r' || mode[1] == '+';
+  file.append = mode[0] == 'a';
+  if (file.append) {
+    file.filePosition = storage->files[filePath].size();
+  }
+  return file;
+}
+
+File FS::open(const std::string& path, const char* mode, const bool create) {
+  return open(path.c_str(), mode, create);
+}
+
+bool FS::exists(const char* path) {
+  std::lock_guard<std::recursive_mutex> lock(storage->mutex);
+  return storage->files.count(path) > 0 || storage->directories.count(path) > 0;
+}
+
+bool FS::exists(const std::string& path) {
+  return exists(path.c_str());
+}
+
+bool FS::remove(const char* path) {
+  std::lock_guard<std::recursive_mutex> lock(storage->mutex);
+  return storage->files.erase(path) > 0;
+}
+
+bool FS::remove(const std::string& path) {
+  return remove(path.c_str());
+}
+
+bool FS::rename(const char* pathFrom, const char* pathTo) {
+  std::lock_guard<std::recursive_mutex> lock(storage->mutex);
+  auto file = storage->files.find(pathFrom);
+  if (file == storage->files.end()) {
+    return false;
+  }
+  std::vector<uint8_t> data = std::move(file->second);
+  storage->files.erase(file);
+  storage->files[pathTo] = std::move(data);
+  return true;
+}
+
+bool FS::mkdir(const char* path) {
+  std::lock_guard<std::recursive_mutex> lock(storage->mutex);
+  std::string directory = path;
+  if (storage->files.count(directory) > 0) {
+    return false;
+  }
+  if (parentOf(directory) != "/" && storage->directories.count(parentOf(directory)) == 0) {
+    mkdir(parentOf(directory));
+  }
+  storage->directories.insert(directory);
+  return true;
+}
+
+bool FS::mkdir(const std::string& path) {
+  return mkdir(path.c_str());
+}
+
+bool FS::rmdir(const char* path) {
+  std::lock_guard<std::recursive_mutex> lock(storage->mutex);
+  std::string prefix = std::string(path) + "/";
+  for (const auto& entry : storage->files) {
+    if (entry.first.compare(0, prefix.size(), prefix) == 0) {
+      return false;
+    }
+  }
+  return storage->directories.erase(path) > 0;
+}
+
+size_t FS::getBytesWritten() const {
+  std::lock_guard<std::recursive_mutex> lock(storage->mutex);
+  return storage->bytesWritten;
+}
+
+void FS::format() {
+  std::lock_guard<std::recursive_mutex> lock(storage->mutex);
+  storage->files.clear();
+  storage->directories.clear();
+}
+
+} // namespace fs
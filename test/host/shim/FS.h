@@ -0,0 +1,109 @@
+#pragma once
+
+/**
+ * @file FS.h
+ * Host stand-in for the Arduino fs::FS/fs::File API, the files of an FS object are kept in memory.
+ * Copies of an FS object share the same files. getBytesWritten() counts all bytes written, to compare flash wear
+ *
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode {
+  SeekSet = 0,
+  SeekCur = 1,
+  SeekEnd = 2
+};
+
+struct MemoryStorage {
+  std::recursive_mutex mutex;
+  std::map<std::string, std::vector<uint8_t>> files;
+  std::set<std::string> directories;
+  size_t bytesWritten = 0;
+};
+
+class File {
+  public:
+    File() {}
+
+    size_t write(const uint8_t* buffer, size_t size);
+    size_t write(uint8_t c);
+    size_t read(uint8_t* buffer, size_t size);
+    int read();
+    int available();
+    void flush() {}
+    bool seek(uint32_t position, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void close();
+    operator bool() const;
+    const char* path() const;
+    const char* name() const;
+    bool isDirectory() const;
+    File openNextFile(const char* mode = FILE_READ);
+    void rewindDirectory();
+
+  private:
+    friend class FS;
+
+    std::shared_ptr<MemoryStorage> storage;
+    std::string filePath;
+    std::string fileName;
+    size_t filePosition = 0;
+    bool append = false;
+    bool writable = false;
+    bool directory = false;
+    std::vector<std::string> entries;
+    size_t nextEntry = 0;
+};
+
+class FS {
+  public:
+    FS();
+
+    File open(const char* path, const char* mode = FILE_READ, const bool create = false);
+    File open(const std::string& path, const char* mode = FILE_READ, const bool create = false);
+    bool exists(const char* path);
+    bool exists(const std::string& path);
+    bool remove(const char* path);
+    bool remove(const std::string& path);
+    bool rename(const char* pathFrom, const char* pathTo);
+    bool mkdir(const char* path);
+    bool mkdir(const std::string& path);
+    bool rmdir(const char* path);
+
+    size_t getBytesWritten() const;
+    /**
+     * @brief Removes all files and directories
+     */
+    void format();
+
+  private:
+    friend class File;
+
+    std::shared_ptr<MemoryStorage> storage;
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
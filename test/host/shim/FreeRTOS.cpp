@@ -0,0 +1,225 @@
+#include "freertos/FreeRTOS.h"
+#include "Arduino.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct HostSemaphore {
+  std::mutex mutex;
+  std::condition_variable available;
+  UBaseType_t count;
+  UBaseType_t maxCount;
+  //owner and depth are only used by recursive mutexes
+  std::thread::id owner;
+  UBaseType_t depth = 0;
+};
+
+struct HostTask {
+  std::string name;
+};
+
+struct HostEventGroup {
+  std::mutex mutex;
+  std::condition_variable changed;
+  EventBits_t bits = 0;
+};
+
+namespace {
+
+//thrown by vTaskDelete(NULL) to end the thread of the calling task
+struct TaskDeleted {};
+
+thread_local HostTask ownTask{"host"};
+thread_local HostTask* currentTask = nullptr;
+
+SemaphoreHandle_t createSemaphore(const UBaseType_t maxCount, const UBaseType_t initialCount) {
+  HostSemaphore* semaphore = new HostSemaphore();
+  semaphore->maxCount = maxCount;
+  semaphore->count = initialCount;
+  return semaphore;
+}
+
+template <typename TPredicate>
+bool waitFor(std::condition_variable& condition, std::unique_lock<std::mutex>& lock, const TickType_t ticksToWait,
+             TPredicate predicate) {
+  if (ticksToWait == portMAX_DELAY) {
+    condition.wait(lock, predicate);
+    return true;
+  }
+  return condition.wait_for(lock, std::chrono::milliseconds(ticksToWait * portTICK_PERIOD_MS), predicate);
+}
+
+} // namespace
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return createSemaphore(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+  return createSemaphore(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+  return createSemaphore(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(const UBaseType_t maxCount, const UBaseType_t initialCount) {
+  return createSemaphore(maxCount, initialCount);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, const TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> lock(semaphore->mutex);
+  auto available = [semaphore]() {
+    return semaphore->count > 0;
+  };
+  if (!waitFor(semaphore->available, lock, ticksToWait, available)) {
+    return pdFALSE;
+  }
+  semaphore->count--;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  std::lock_guard<std::mutex> lock(semaphore->mutex);
+  if (semaphore->count >= semaphore->maxCount) {
+    return pdFALSE;
+  }
+  semaphore->count++;
+  semaphore->available.notify_one();
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, const TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> lock(semaphore->mutex);
+  std::thread::id self = std::this_thread::get_id();
+  if (semaphore->depth > 0 && semaphore->owner == self) {
+    semaphore->depth++;
+    return pdTRUE;
+  }
+  auto available = [semaphore]() {
+    return semaphore->count > 0;
+  };
+  if (!waitFor(semaphore->available, lock, ticksToWait, available)) {
+    return pdFALSE;
+  }
+  semaphore->count--;
+  semaphore->owner = self;
+  semaphore->depth = 1;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore) {
+  std::lock_guard<std::mutex> lock(semaphore->mutex);
+  if (semaphore->depth == 0 || semaphore->owner != std::this_thread::get_id()) {
+    return pdFALSE;
+  }
+  if (--semaphore->depth == 0) {
+    semaphore->owner = std::thread::id();
+    semaphore->count++;
+    semaphore->available.notify_one();
+  }
+  return pdTRUE;
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore) {
+  std::lock_guard<std::mutex> lock(semaphore->mutex);
+  return semaphore->count;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+  delete semaphore;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, const uint32_t stackDepth, void* parameters,
+                       UBaseType_t priority, TaskHandle_t* createdTask) {
+  HostTask* task = new HostTask{name != nullptr ? name : ""};
+  if (createdTask != nullptr) {
+    *createdTask = task;
+  }
+  std::thread([task, function, parameters]() {
+    currentTask = task;
+    try {
+      function(parameters);
+    } catch (const TaskDeleted&) {
+    }
+    delete task;
+  }).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, const uint32_t stackDepth,
+                                   void* parameters, UBaseType_t priority, TaskHandle_t* createdTask,
+                                   const BaseType_t coreId) {
+  return xTaskCreate(function, name, stackDepth, parameters, priority, createdTask);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  if (task == nullptr || task == xTaskGetCurrentTaskHandle()) {
+    throw TaskDeleted();
+  }
+  log_e("vTaskDelete of another task is not supported on the host");
+}
+
+void vTaskDelay(const TickType_t ticksToDelay) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticksToDelay * portTICK_PERIOD_MS));
+}
+
+TickType_t xTaskGetTickCount() {
+  return millis() / portTICK_PERIOD_MS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  return currentTask != nullptr ? currentTask : &ownTask;
+}
+
+const char* pcTaskGetTaskName(TaskHandle_t task) {
+  if (task == nullptr) {
+    task = xTaskGetCurrentTaskHandle();
+  }
+  return task->name.c_str();
+}
+
+EventGroupHandle_t xEventGroupCreate() {
+  return new HostEventGroup();
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t eventGroup, const EventBits_t bitsToSet) {
+  std::lock_guard<std::mutex> lock(eventGroup->mutex);
+  eventGroup->bits |= bitsToSet;
+  eventGroup->changed.notify_all();
+  return eventGroup->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t eventGroup, const EventBits_t bitsToClear) {
+  std::lock_guard<std::mutex> lock(eventGroup->mutex);
+  EventBits_t bits = eventGroup->bits;
+  eventGroup->bits &= ~bitsToClear;
+  return bits;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t eventGroup) {
+  std::lock_guard<std::mutex> lock(eventGroup->mutex);
+  return eventGroup->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t eventGroup, const EventBits_t bitsToWaitFor,
+                                const BaseType_t clearOnExit, const BaseType_t waitForAllBits,
+                                TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> lock(eventGroup->mutex);
+  auto satisfied = [eventGroup, bitsToWaitFor, waitForAllBits]() {
+    EventBits_t set = eventGroup->bits & bitsToWaitFor;
+    return waitForAllBits ? set == bitsToWaitFor : set != 0;
+  };
+  bool waited = waitFor(eventGroup->changed, lock, ticksToWait, satisfied);
+  EventBits_t bits = eventGroup->bits;
+  if (waited && clearOnExit) {
+    eventGroup->bits &= ~bitsToWaitFor;
+  }
+  return bits;
+}
+
+void vEventGroupDelete(EventGroupHandle_t eventGroup) {
+  delete eventGroup;
+}
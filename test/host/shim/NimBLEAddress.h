@@ -0,0 +1,82 @@
+#pragma once
+
+/**
+ * @file NimBLEAddress.h
+ * Host stand-in for NimBLEAddress, native byte order (least significant byte first) as in NimBLE
+ *
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+#define BLE_ADDR_PUBLIC 0
+#define BLE_ADDR_RANDOM 1
+
+class NimBLEAddress {
+  public:
+    NimBLEAddress() {}
+
+    /**
+     * @param address 6 bytes, most significant byte first
+     */
+    NimBLEAddress(const uint8_t address[6], const uint8_t type = BLE_ADDR_PUBLIC) : type(type) {
+      std::reverse_copy(address, address + sizeof(native), native);
+    }
+
+    /**
+     * @param address "aa:bb:cc:dd:ee:ff", an empty or invalid string gives the null address
+     */
+    NimBLEAddress(const std::string& address, const uint8_t type = BLE_ADDR_PUBLIC) : type(type) {
+      unsigned int bytes[6];
+      if (address.size() == 17 && sscanf(address.c_str(), "%02x:%02x:%02x:%02x:%02x:%02x",
+                                         &bytes[5], &bytes[4], &bytes[3], &bytes[2], &bytes[1], &bytes[0]) == 6) {
+        for (int i = 0; i < 6; i++) {
+          native[i] = bytes[i];
+        }
+      }
+    }
+
+    NimBLEAddress(const char* address, const uint8_t type = BLE_ADDR_PUBLIC) : NimBLEAddress(std::string(address), type) {}
+
+    const uint8_t* getNative() const {
+      return native;
+    }
+
+    uint8_t getType() const {
+      return type;
+    }
+
+    std::string toString() const {
+      char text[18];
+      snprintf(text, sizeof(text), "%02x:%02x:%02x:%02x:%02x:%02x",
+               native[5], native[4], native[3], native[2], native[1], native[0]);
+      return text;
+    }
+
+    operator std::string() const {
+      return toString();
+    }
+
+    bool equals(const NimBLEAddress& other) const {
+      return memcmp(native, other.native, sizeof(native)) == 0;
+    }
+
+    bool operator==(const NimBLEAddress& other) const {
+      return equals(other);
+    }
+
+    bool operator!=(const NimBLEAddress& other) const {
+      return !equals(other);
+    }
+
+  private:
+    uint8_t native[6] = {0};
+    uint8_t type = BLE_ADDR_PUBLIC;
+};
+
+typedef NimBLEAddress BLEAddress;
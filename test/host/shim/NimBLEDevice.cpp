@@ -0,0 +1,215 @@
+#include "NimBLEDevice.h"
+
+namespace {
+
+std::mutex deviceMutex;
+bool initialized = false;
+
+std::vector<std::unique_ptr<NimBLEClient>>& clients() {
+  static std::vector<std::unique_ptr<NimBLEClient>> list;
+  return list;
+}
+
+std::map<std::string, NimBLEHostPeripheral*>& peripherals() {
+  static std::map<std::string, NimBLEHostPeripheral*> list;
+  return list;
+}
+
+} // namespace
+
+bool NimBLERemoteCharacteristic::subscribe(bool notifications, notify_callback callback, bool response) {
+  std::lock_guard<std::recursive_mutex> lock(client->mutex);
+  if (!client->isConnected()) {
+    return false;
+  }
+  this->callback = callback;
+  return true;
+}
+
+bool NimBLERemoteCharacteristic::unsubscribe(bool response) {
+  std::lock_guard<std::recursive_mutex> lock(client->mutex);
+  callback = nullptr;
+  return client->isConnected();
+}
+
+bool NimBLERemoteCharacteristic::writeValue(const uint8_t* data, size_t length, bool response) {
+  return client->write(uuid, data, length);
+}
+
+NimBLERemoteCharacteristic* NimBLERemoteService::getCharacteristic(const NimBLEUUID& characteristicUUID) {
+  std::lock_guard<std::recursive_mutex> lock(client->mutex);
+  for (auto& characteristic : characteristics) {
+    if (characteristic->getUUID() == characteristicUUID) {
+      return characteristic.get();
+    }
+  }
+  if (!client->hasCharacteristic(uuid, characteristicUUID)) {
+    return nullptr;
+  }
+  characteristics.emplace_back(new NimBLERemoteCharacteristic(client, characteristicUUID));
+  return characteristics.back().get();
+}
+
+bool NimBLEClient::connect(const NimBLEAddress& address, bool deleteAttributes) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  if (connected) {
+    return address == peerAddress;
+  }
+  if (deleteAttributes) {
+    deleteServices();
+  }
+  NimBLEHostPeripheral* target = NimBLEDevice::hostFindPeripheral(address);
+  if (target == nullptr || !target->onConnect(this)) {
+    return false;
+  }
+  peripheral = target;
+  peerAddress = address;
+  connected = true;
+  if (callbacks != nullptr) {
+    callbacks->onConnect(this);
+  }
+  return true;
+}
+
+int NimBLEClient::disconnect(uint8_t reason) {
+  NimBLEHostPeripheral* target = nullptr;
+  {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    if (!connected) {
+      return 0;
+    }
+    connected = false;
+    target = peripheral;
+    peripheral = nullptr;
+  }
+  target->onDisconnect(this);
+  if (callbacks != nullptr) {
+    callbacks->onDisconnect(this);
+  }
+  return 0;
+}
+
+void NimBLEClient::hostPeerDisconnected() {
+  {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    if (!connected) {
+      return;
+    }
+    connected = false;
+    peripheral = nullptr;
+  }
+  if (callbacks != nullptr) {
+    callbacks->onDisconnect(this);
+  }
+}
+
+bool NimBLEClient::isConnected() const {
+  return connected;
+}
+
+void NimBLEClient::setClientCallbacks(NimBLEClientCallbacks* callbacks, bool deleteCallbacks) {
+  this->callbacks = callbacks;
+}
+
+void NimBLEClient::setConnectTimeout(uint8_t timeout) {}
+
+NimBLERemoteService* NimBLEClient::getService(const NimBLEUUID& uuid) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  if (!connected) {
+    return nullptr;
+  }
+  for (auto& service : services) {
+    if (service->getUUID() == uuid) {
+      return service.get();
+    }
+  }
+  services.emplace_back(new NimBLERemoteService(this, uuid));
+  return services.back().get();
+}
+
+void NimBLEClient::deleteServices() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  services.clear();
+}
+
+NimBLEAddress NimBLEClient::getPeerAddress() const {
+  return peerAddress;
+}
+
+bool NimBLEClient::hasCharacteristic(const NimBLEUUID& serviceUUID, const NimBLEUUID& characteristicUUID) {
+  return connected && peripheral->hasCharacteristic(serviceUUID, characteristicUUID);
+}
+
+bool NimBLEClient::write(const NimBLEUUID& characteristicUUID, const uint8_t* data, const size_t length) {
+  NimBLEHostPeripheral* target = nullptr;
+  {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    if (!connected) {
+      return false;
+    }
+    target = peripheral;
+  }
+  return target->onWrite(this, characteristicUUID, data, length);
+}
+
+bool NimBLEClient::hostNotify(const NimBLEUUID& characteristicUUID, const uint8_t* data, const size_t length) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  if (!connected) {
+    return false;
+  }
+  for (auto& service : services) {
+    for (auto& characteristic : service->characteristics) {
+      if (characteristic->getUUID() == characteristicUUID && characteristic->callback) {
+        //NimBLE hands over a buffer the callback may read until it returns
+        std::vector<uint8_t> received(data, data + length);
+        characteristic->callback(characteristic.get(), received.data(), received.size(), true);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void NimBLEDevice::init(const std::string& deviceName) {
+  std::lock_guard<std::mutex> lock(deviceMutex);
+  initialized = true;
+}
+
+bool NimBLEDevice::getInitialized() {
+  std::lock_guard<std::mutex> lock(deviceMutex);
+  return initialized;
+}
+
+NimBLEClient* NimBLEDevice::createClient() {
+  std::lock_guard<std::mutex> lock(deviceMutex);
+  clients().emplace_back(new NimBLEClient());
+  return clients().back().get();
+}
+
+bool NimBLEDevice::deleteClient(NimBLEClient* client) {
+  client->disconnect();
+  std::lock_guard<std::mutex> lock(deviceMutex);
+  for (auto it = clients().begin(); it != clients().end(); it++) {
+    if (it->get() == client) {
+      clients().erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+void NimBLEDevice::hostAddPeripheral(const NimBLEAddress& address, NimBLEHostPeripheral* peripheral) {
+  std::lock_guard<std::mutex> lock(deviceMutex);
+  peripherals()[address.toString()] = peripheral;
+}
+
+void NimBLEDevice::hostRemovePeripheral(const NimBLEAddress& address) {
+  std::lock_guard<std::mutex> lock(deviceMutex);
+  peripherals().erase(address.toString());
+}
+
+NimBLEHostPeripheral* NimBLEDevice::hostFindPeripheral(const NimBLEAddress& address) {
+  std::lock_guard<std::mutex> lock(deviceMutex);
+  auto peripheral = peripherals().find(address.toString());
+  return peripheral != peripherals().end() ? peripheral->second : nullptr;
+}
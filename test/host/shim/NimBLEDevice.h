@@ -0,0 +1,222 @@
+#pragma once
+
+/**
+ * @file NimBLEDevice.h
+ * Host stand-in for the NimBLE-Arduino client API used by the library. There is no radio: a client connects to a
+ * NimBLEHostPeripheral registered for the address with NimBLEDevice::hostAddPeripheral(), writes to a remote
+ * characteristic are handed to that peripheral and the peripheral notifies the client with hostNotify()
+ *
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ */
+
+#include "NimBLEAddress.h"
+#include "NimBLEUUID.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class NimBLEClient;
+class NimBLERemoteCharacteristic;
+
+typedef std::function<void(NimBLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length,
+                           bool isNotify)> notify_callback;
+
+/**
+ * @brief Peripheral side of the simulated link, e.g. a simulated lock
+ */
+class NimBLEHostPeripheral {
+  public:
+    virtual ~NimBLEHostPeripheral() {}
+
+    virtual bool hasCharacteristic(const NimBLEUUID& serviceUUID, const NimBLEUUID& characteristicUUID) = 0;
+
+    /**
+     * @return false to refuse the connection
+     */
+    virtual bool onConnect(NimBLEClient* client) = 0;
+    virtual void onDisconnect(NimBLEClient* client) = 0;
+
+    /**
+     * @brief Called for every write of the client, in the thread of the client
+     *
+     * @return false if the write is not acknowledged
+     */
+    virtual bool onWrite(NimBLEClient* client, const NimBLEUUID& characteristicUUID, const uint8_t* data,
+                         const size_t length) = 0;
+};
+
+class NimBLERemoteCharacteristic {
+  public:
+    NimBLERemoteCharacteristic(NimBLEClient* client, const NimBLEUUID& uuid) : client(client), uuid(uuid) {}
+
+    NimBLEUUID getUUID() const {
+      return uuid;
+    }
+
+    bool canNotify() const {
+      return true;
+    }
+
+    bool canIndicate() const {
+      return true;
+    }
+
+    bool subscribe(bool notifications = true, notify_callback callback = nullptr, bool response = false);
+    bool unsubscribe(bool response = false);
+    bool writeValue(const uint8_t* data, size_t length, bool response = false);
+
+  private:
+    friend class NimBLEClient;
+
+    NimBLEClient* client;
+    NimBLEUUID uuid;
+    notify_callback callback;
+};
+
+typedef NimBLERemoteCharacteristic BLERemoteCharacteristic;
+
+class NimBLERemoteService {
+  public:
+    NimBLERemoteService(NimBLEClient* client, const NimBLEUUID& uuid) : client(client), uuid(uuid) {}
+
+    NimBLEUUID getUUID() const {
+      return uuid;
+    }
+
+    NimBLERemoteCharacteristic* getCharacteristic(const NimBLEUUID& characteristicUUID);
+
+  private:
+    friend class NimBLEClient;
+
+    NimBLEClient* client;
+    NimBLEUUID uuid;
+    std::vector<std::unique_ptr<NimBLERemoteCharacteristic>> characteristics;
+};
+
+typedef NimBLERemoteService BLERemoteService;
+
+class NimBLEClientCallbacks {
+  public:
+    virtual ~NimBLEClientCallbacks() {}
+    virtual void onConnect(NimBLEClient* client) {}
+    virtual void onDisconnect(NimBLEClient* client) {}
+};
+
+typedef NimBLEClientCallbacks BLEClientCallbacks;
+
+class NimBLEClient {
+  public:
+    bool connect(const NimBLEAddress& address, bool deleteAttributes = true);
+    int disconnect(uint8_t reason = 0);
+    bool isConnected() const;
+    void setClientCallbacks(NimBLEClientCallbacks* callbacks, bool deleteCallbacks = true);
+    void setConnectTimeout(uint8_t timeout);
+    NimBLERemoteService* getService(const NimBLEUUID& uuid);
+    void deleteServices();
+    NimBLEAddress getPeerAddress() const;
+
+    /**
+     * @brief Called by the peripheral to send a notification, the subscribed callback runs in the calling thread
+     *
+     * @return false if the client is not connected or did not subscribe to the characteristic
+     */
+    bool hostNotify(const NimBLEUUID& characteristicUUID, const uint8_t* data, const size_t length);
+
+    /**
+     * @brief Called by the peripheral when it drops the connection
+     */
+    void hostPeerDisconnected();
+
+  private:
+    friend class NimBLERemoteService;
+    friend class NimBLERemoteCharacteristic;
+
+    bool write(const NimBLEUUID& characteristicUUID, const uint8_t* data, const size_t length);
+    bool hasCharacteristic(const NimBLEUUID& serviceUUID, const NimBLEUUID& characteristicUUID);
+
+    std::recursive_mutex mutex;
+    std::atomic<bool> connected{false};
+    NimBLEAddress peerAddress;
+    NimBLEHostPeripheral* peripheral = nullptr;
+    NimBLEClientCallbacks* callbacks = nullptr;
+    std::vector<std::unique_ptr<NimBLERemoteService>> services;
+};
+
+typedef NimBLEClient BLEClient;
+
+class NimBLEAdvertisedDevice {
+  public:
+    NimBLEAdvertisedDevice(const NimBLEAddress& address) : address(address) {}
+
+    NimBLEAddress getAddress() const {
+      return address;
+    }
+
+    int getRSSI() const {
+      return rssi;
+    }
+
+    std::string getName() const {
+      return name;
+    }
+
+    bool haveServiceData() const {
+      return !serviceData.empty();
+    }
+
+    std::string getServiceData(const NimBLEUUID& uuid) const {
+      auto data = serviceData.find(uuid);
+      return data != serviceData.end() ? data->second : "";
+    }
+
+    std::vector<uint8_t> getPayload() const {
+      return payload;
+    }
+
+    size_t getPayloadLength() const {
+      return payload.size();
+    }
+
+    std::vector<uint8_t>::const_iterator begin() const {
+      return payload.cbegin();
+    }
+
+    std::vector<uint8_t>::const_iterator end() const {
+      return payload.cend();
+    }
+
+    // set by the simulated peripheral
+    int rssi = -60;
+    std::string name;
+    std::vector<uint8_t> payload;
+    std::map<NimBLEUUID, std::string> serviceData;
+
+  private:
+    NimBLEAddress address;
+};
+
+typedef NimBLEAdvertisedDevice BLEAdvertisedDevice;
+
+class NimBLEDevice {
+  public:
+    static void init(const std::string& deviceName);
+    static bool getInitialized();
+    static NimBLEClient* createClient();
+    static bool deleteClient(NimBLEClient* client);
+
+    /**
+     * @brief Makes the peripheral reachable for connect() to address
+     */
+    static void hostAddPeripheral(const NimBLEAddress& address, NimBLEHostPeripheral* peripheral);
+    static void hostRemovePeripheral(const NimBLEAddress& address);
+    static NimBLEHostPeripheral* hostFindPeripheral(const NimBLEAddress& address);
+};
+
+typedef NimBLEDevice BLEDevice;
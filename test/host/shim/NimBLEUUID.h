@@ -0,0 +1,49 @@
+#pragma once
+
+/**
+ * @file NimBLEUUID.h
+ * Host stand-in for NimBLEUUID, the uuid is kept as its lower case string
+ *
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+
+class NimBLEUUID {
+  public:
+    NimBLEUUID() {}
+
+    NimBLEUUID(const std::string& uuid) : uuid(uuid) {
+      std::transform(this->uuid.begin(), this->uuid.end(), this->uuid.begin(), ::tolower);
+    }
+
+    NimBLEUUID(const char* uuid) : NimBLEUUID(std::string(uuid)) {}
+
+    std::string toString() const {
+      return uuid;
+    }
+
+    bool equals(const NimBLEUUID& other) const {
+      return uuid == other.uuid;
+    }
+
+    bool operator==(const NimBLEUUID& other) const {
+      return equals(other);
+    }
+
+    bool operator!=(const NimBLEUUID& other) const {
+      return !equals(other);
+    }
+
+    bool operator<(const NimBLEUUID& other) const {
+      return uuid < other.uuid;
+    }
+
+  private:
+    std::string uuid;
+};
+
+typedef NimBLEUUID BLEUUID;
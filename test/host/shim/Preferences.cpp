@@ -0,0 +1,174 @@
+#include "Preferences.h"
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct StoredValue {
+  uint8_t type;
+  std::vector<uint8_t> data;
+};
+
+typedef std::map<std::string, StoredValue> Namespace;
+
+std::mutex storageMutex;
+
+std::map<std::string, Namespace>& storage() {
+  static std::map<std::string, Namespace> namespaces;
+  return namespaces;
+}
+
+} // namespace
+
+bool Preferences::begin(const char* name, bool readOnly) {
+  if (started || name == nullptr || strlen(name) > 15) {
+    return false;
+  }
+  this->name = name;
+  this->readOnly = readOnly;
+  started = true;
+  return true;
+}
+
+void Preferences::end() {
+  started = false;
+}
+
+bool Preferences::clear() {
+  if (!started || readOnly) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(storageMutex);
+  storage()[name].clear();
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  if (!started || readOnly) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(storageMutex);
+  return storage()[name].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+  if (!started) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(storageMutex);
+  return storage()[name].count(key) > 0;
+}
+
+size_t Preferences::put(const char* key, const Type type, const void* value, const size_t length) {
+  if (!started || readOnly || key == nullptr || strlen(key) > 15) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(storageMutex);
+  StoredValue& stored = storage()[name][key];
+  stored.type = (uint8_t)type;
+  stored.data.assign((const uint8_t*)value, (const uint8_t*)value + length);
+  return length;
+}
+
+bool Preferences::get(const char* key, const Type type, void* value, const size_t length) {
+  if (!started || key == nullptr) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(storageMutex);
+  Namespace& values = storage()[name];
+  auto stored = values.find(key);
+  if (stored == values.end() || stored->second.type != (uint8_t)type || stored->second.data.size() != length) {
+    return false;
+  }
+  memcpy(value, stored->second.data.data(), length);
+  return true;
+}
+
+size_t Preferences::putUChar(const char* key, uint8_t value) {
+  return put(key, Type::U8, &value, sizeof(value));
+}
+
+size_t Preferences::putUShort(const char* key, uint16_t value) {
+  return put(key, Type::U16, &value, sizeof(value));
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+  return put(key, Type::U32, &value, sizeof(value));
+}
+
+size_t Preferences::putULong64(const char* key, uint64_t value) {
+  return put(key, Type::U64, &value, sizeof(value));
+}
+
+size_t Preferences::putBool(const char* key, bool value) {
+  uint8_t byteValue = value;
+  return put(key, Type::U8, &byteValue, sizeof(byteValue));
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+  if (value == nullptr || length == 0) {
+    return 0;
+  }
+  return put(key, Type::Blob, value, length);
+}
+
+uint8_t Preferences::getUChar(const char* key, uint8_t defaultValue) {
+  uint8_t value = defaultValue;
+  get(key, Type::U8, &value, sizeof(value));
+  return value;
+}
+
+uint16_t Preferences::getUShort(const char* key, uint16_t defaultValue) {
+  uint16_t value = defaultValue;
+  get(key, Type::U16, &value, sizeof(value));
+  return value;
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+  uint32_t value = defaultValue;
+  get(key, Type::U32, &value, sizeof(value));
+  return value;
+}
+
+uint64_t Preferences::getULong64(const char* key, uint64_t defaultValue) {
+  uint64_t value = defaultValue;
+  get(key, Type::U64, &value, sizeof(value));
+  return value;
+}
+
+bool Preferences::getBool(const char* key, bool defaultValue) {
+  uint8_t value = defaultValue;
+  get(key, Type::U8, &value, sizeof(value));
+  return value != 0;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  if (!started || key == nullptr) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(storageMutex);
+  Namespace& values = storage()[name];
+  auto stored = values.find(key);
+  if (stored == values.end() || stored->second.type != (uint8_t)Type::Blob) {
+    return 0;
+  }
+  return stored->second.data.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength) {
+  size_t length = getBytesLength(key);
+  //as on the ESP32 nothing is copied when the value does not fit
+  if (length == 0 || buffer == nullptr || length > maxLength) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(storageMutex);
+  memcpy(buffer, storage()[name][key].data.data(), length);
+  return length;
+}
+
+void hostErasePreferences() {
+  std::lock_guard<std::mutex> lock(storageMutex);
+  storage().clear();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+/**
+ * @file Preferences.h
+ * Host stand-in for the ESP32 Preferences library. Values are kept in memory per namespace for the lifetime of the
+ * process, so a second Preferences object on the same namespace sees them like after a reboot.
+ * As in NVS every value has a type, reading it as another type returns the default
+ *
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+class Preferences {
+  public:
+    bool begin(const char* name, bool readOnly = false);
+    void end();
+
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key);
+
+    size_t putUChar(const char* key, uint8_t value);
+    size_t putUShort(const char* key, uint16_t value);
+    size_t putUInt(const char* key, uint32_t value);
+    size_t putULong64(const char* key, uint64_t value);
+    size_t putBool(const char* key, bool value);
+    size_t putBytes(const char* key, const void* value, size_t length);
+
+    uint8_t getUChar(const char* key, uint8_t defaultValue = 0);
+    uint16_t getUShort(const char* key, uint16_t defaultValue = 0);
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+    uint64_t getULong64(const char* key, uint64_t defaultValue = 0);
+    bool getBool(const char* key, bool defaultValue = false);
+    size_t getBytesLength(const char* key);
+    size_t getBytes(const char* key, void* buffer, size_t maxLength);
+
+  private:
+    enum class Type : uint8_t { U8, U16, U32, U64, Blob };
+
+    size_t put(const char* key, const Type type, const void* value, const size_t length);
+    bool get(const char* key, const Type type, void* value, const size_t length);
+
+    std::string name;
+    bool started = false;
+    bool readOnly = false;
+};
+
+/**
+ * @brief Erases every namespace, like erasing the NVS partition
+ */
+void hostErasePreferences();
@@ -0,0 +1,15 @@
+#pragma once
+
+/**
+ * @file esp_system.h
+ * Host stand-in for the ESP-IDF random number functions used by the library
+ *
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+void esp_fill_random(void* buffer, size_t length);
+uint32_t esp_random();
@@ -0,0 +1,11 @@
+#pragma once
+
+/**
+ * @file esp_task_wdt.h
+ * Host stand-in for the ESP-IDF task watchdog, there is no watchdog on the host
+ *
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ */
+
+inline void esp_task_wdt_reset() {}
@@ -0,0 +1,65 @@
+#pragma once
+
+/**
+ * @file FreeRTOS.h
+ * Host stand-in for the FreeRTOS API used by the library, for the host tests and benchmarks.
+ * Semaphores and event groups are built on std::mutex/std::condition_variable, tasks run on a std::thread.
+ * One tick is one ms
+ *
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ */
+
+#include <stdint.h>
+
+typedef struct HostSemaphore* SemaphoreHandle_t;
+typedef struct HostTask* TaskHandle_t;
+typedef struct HostEventGroup* EventGroupHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t EventBits_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS ((TickType_t)1)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7fffffff
+
+// semaphores
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateCounting(const UBaseType_t maxCount, const UBaseType_t initialCount);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, const TickType_t ticksToWait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, const TickType_t ticksToWait);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore);
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore);
+void vSemaphoreDelete(SemaphoreHandle_t semaphore);
+
+// tasks
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, const uint32_t stackDepth, void* parameters,
+                       UBaseType_t priority, TaskHandle_t* createdTask);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, const uint32_t stackDepth,
+                                   void* parameters, UBaseType_t priority, TaskHandle_t* createdTask,
+                                   const BaseType_t coreId);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(const TickType_t ticksToDelay);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+const char* pcTaskGetTaskName(TaskHandle_t task);
+
+// event groups
+EventGroupHandle_t xEventGroupCreate();
+EventBits_t xEventGroupSetBits(EventGroupHandle_t eventGroup, const EventBits_t bitsToSet);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t eventGroup, const EventBits_t bitsToClear);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t eventGroup);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t eventGroup, const EventBits_t bitsToWaitFor,
+                                const BaseType_t clearOnExit, const BaseType_t waitForAllBits,
+                                TickType_t ticksToWait);
+void vEventGroupDelete(EventGroupHandle_t eventGroup);
@@ -0,0 +1,19 @@
+#pragma once
+
+/**
+ * @file sodium.h
+ * Declarations of the libsodium functions used by the library and the host tests, for host builds against a
+ * libsodium without development headers (only the shared library). Matches the ABI of libsodium 1.0.x
+ *
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ */
+
+#include "sodium/core.h"
+#include "sodium/crypto_auth_hmacsha256.h"
+#include "sodium/crypto_box.h"
+#include "sodium/crypto_core_hsalsa20.h"
+#include "sodium/crypto_scalarmult.h"
+#include "sodium/crypto_secretbox.h"
+#include "sodium/randombytes.h"
+#include "sodium/utils.h"
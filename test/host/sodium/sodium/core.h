@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int sodium_init(void);
+
+#ifdef __cplusplus
+}
+#endif
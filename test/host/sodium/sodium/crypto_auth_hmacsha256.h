@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define crypto_auth_hmacsha256_BYTES 32U
+#define crypto_auth_hmacsha256_KEYBYTES 32U
+
+int crypto_auth_hmacsha256(unsigned char* out, const unsigned char* in, unsigned long long inlen,
+                           const unsigned char* k);
+int crypto_auth_hmacsha256_verify(const unsigned char* h, const unsigned char* in, unsigned long long inlen,
+                                  const unsigned char* k);
+
+#ifdef __cplusplus
+}
+#endif
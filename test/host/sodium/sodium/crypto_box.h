@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define crypto_box_PUBLICKEYBYTES 32U
+#define crypto_box_SECRETKEYBYTES 32U
+
+int crypto_box_keypair(unsigned char* pk, unsigned char* sk);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define crypto_core_hsalsa20_OUTPUTBYTES 32U
+#define crypto_core_hsalsa20_INPUTBYTES 16U
+#define crypto_core_hsalsa20_KEYBYTES 32U
+#define crypto_core_hsalsa20_CONSTBYTES 16U
+
+int crypto_core_hsalsa20(unsigned char* out, const unsigned char* in, const unsigned char* k, const unsigned char* c);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define crypto_scalarmult_curve25519_BYTES 32U
+#define crypto_scalarmult_BYTES 32U
+
+int crypto_scalarmult_curve25519(unsigned char* q, const unsigned char* n, const unsigned char* p);
+int crypto_scalarmult_base(unsigned char* q, const unsigned char* n);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define crypto_secretbox_KEYBYTES 32U
+#define crypto_secretbox_NONCEBYTES 24U
+#define crypto_secretbox_MACBYTES 16U
+
+int crypto_secretbox_easy(unsigned char* c, const unsigned char* m, unsigned long long mlen, const unsigned char* n,
+                          const unsigned char* k);
+int crypto_secretbox_open_easy(unsigned char* m, const unsigned char* c, unsigned long long clen,
+                               const unsigned char* n, const unsigned char* k);
+int crypto_secretbox_detached(unsigned char* c, unsigned char* mac, const unsigned char* m, unsigned long long mlen,
+                              const unsigned char* n, const unsigned char* k);
+int crypto_secretbox_open_detached(unsigned char* m, const unsigned char* c, const unsigned char* mac,
+                                   unsigned long long clen, const unsigned char* n, const unsigned char* k);
+
+#ifdef __cplusplus
+}
+#endif
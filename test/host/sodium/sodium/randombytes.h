@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void randombytes_buf(void* const buf, const size_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void sodium_memzero(void* const pnt, const size_t len);
+int sodium_memcmp(const void* const b1_, const void* const b2_, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
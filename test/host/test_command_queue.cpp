@@ -0,0 +1,124 @@
+#include "NukiCommandQueue.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using Nuki::CommandPriority;
+using Nuki::CommandQueue;
+
+namespace {
+
+//waits until count commands are waiting in the queue
+bool waitForDepth(CommandQueue& queue, const uint8_t count) {
+  for (int i = 0; i < 200 && queue.getDepth() < count; i++) {
+    delay(5);
+  }
+  return queue.getDepth() == count;
+}
+
+} // namespace
+
+TEST(CommandQueue, LockActionsArePrioritized) {
+  EXPECT_EQ(Nuki::getCommandPriority(Nuki::Command::LockAction), CommandPriority::High);
+  EXPECT_EQ(Nuki::getCommandPriority(Nuki::Command::KeypadAction), CommandPriority::High);
+  EXPECT_EQ(Nuki::getCommandPriority(Nuki::Command::RequestData), CommandPriority::Low);
+  EXPECT_EQ(Nuki::getCommandPriority(Nuki::Command::RequestLogEntries), CommandPriority::Low);
+}
+
+TEST(CommandQueue, EntersImmediatelyWhenIdle) {
+  CommandQueue queue;
+  ASSERT_TRUE(queue.enter(CommandPriority::Low, 0));
+  queue.leave();
+  ASSERT_TRUE(queue.enter(CommandPriority::High, 0));
+  queue.leave();
+  EXPECT_EQ(queue.getDepth(), 0);
+  EXPECT_EQ(queue.getStats(CommandPriority::Low).enqueued, 0u);
+}
+
+TEST(CommandQueue, HighPriorityIsLetInFirst) {
+  CommandQueue queue;
+  ASSERT_TRUE(queue.enter(CommandPriority::Low));
+
+  std::mutex orderMutex;
+  std::vector<int> order;
+  auto command = [&](const CommandPriority priority, const int id) {
+    if (queue.enter(priority, 2000)) {
+      {
+        std::lock_guard<std::mutex> lock(orderMutex);
+        order.push_back(id);
+      }
+      queue.leave();
+    }
+  };
+
+  std::thread low1(command, CommandPriority::Low, 1);
+  ASSERT_TRUE(waitForDepth(queue, 1));
+  std::thread low2(command, CommandPriority::Low, 2);
+  ASSERT_TRUE(waitForDepth(queue, 2));
+  std::thread high(command, CommandPriority::High, 3);
+  ASSERT_TRUE(waitForDepth(queue, 3));
+
+  queue.leave();
+  low1.join();
+  low2.join();
+  high.join();
+
+  EXPECT_EQ(order, std::vector<int>({3, 1, 2}));
+  EXPECT_EQ(queue.getDepth(), 0);
+  Nuki::CommandQueueLaneStats lowStats = queue.getStats(CommandPriority::Low);
+  EXPECT_EQ(lowStats.enqueued, 2u);
+  EXPECT_EQ(lowStats.timedOut, 0u);
+  EXPECT_EQ(queue.getStats(CommandPriority::High).enqueued, 1u);
+}
+
+TEST(CommandQueue, WaitTimesOut) {
+  CommandQueue queue;
+  ASSERT_TRUE(queue.enter(CommandPriority::Low));
+
+  uint32_t start = millis();
+  EXPECT_FALSE(queue.enter(CommandPriority::Low, 50));
+  EXPECT_GE(millis() - start, 50u);
+  EXPECT_EQ(queue.getDepth(), 0);
+  EXPECT_EQ(queue.getStats(CommandPriority::Low).timedOut, 1u);
+
+  queue.leave();
+  EXPECT_TRUE(queue.enter(CommandPriority::Low, 0));
+  queue.leave();
+}
+
+TEST(CommandQueue, FullLaneRejects) {
+  CommandQueue queue;
+  ASSERT_TRUE(queue.enter(CommandPriority::Low));
+
+  std::atomic<int> entered{0};
+  std::vector<std::thread> waiters;
+  for (int i = 0; i < CMD_QUEUE_LANE_SIZE; i++) {
+    waiters.emplace_back([&]() {
+      if (queue.enter(CommandPriority::Low, 2000)) {
+        entered++;
+        queue.leave();
+      }
+    });
+    ASSERT_TRUE(waitForDepth(queue, i + 1));
+  }
+
+  EXPECT_FALSE(queue.enter(CommandPriority::Low, 1000));
+  EXPECT_EQ(queue.getStats(CommandPriority::Low).rejected, 1u);
+  //the high priority lane has its own room
+  std::thread high([&]() {
+    if (queue.enter(CommandPriority::High, 2000)) {
+      entered++;
+      queue.leave();
+    }
+  });
+  ASSERT_TRUE(waitForDepth(queue, CMD_QUEUE_LANE_SIZE + 1));
+
+  queue.leave();
+  for (std::thread& waiter : waiters) {
+    waiter.join();
+  }
+  high.join();
+  EXPECT_EQ(entered, CMD_QUEUE_LANE_SIZE + 1);
+}
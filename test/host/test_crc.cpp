@@ -0,0 +1,63 @@
+#include "NukiCrc.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+namespace {
+
+const uint8_t checkInput[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+
+//reference implementation, one bit at a time
+uint16_t crc16Bitwise(const uint8_t* data, const size_t length, uint16_t crc = CRC16_CCITT_FALSE_INIT) {
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+std::vector<uint8_t> randomBytes(std::mt19937& random, const size_t length) {
+  std::uniform_int_distribution<int> byte(0, 0xff);
+  std::vector<uint8_t> data(length);
+  for (uint8_t& value : data) {
+    value = byte(random);
+  }
+  return data;
+}
+
+} // namespace
+
+TEST(Crc, CheckValue) {
+  EXPECT_EQ(crc16Bitwise(checkInput, sizeof(checkInput)), CRC16_CCITT_FALSE_CHECK);
+  EXPECT_EQ(Nuki::crc16CcittFalseTable(checkInput, sizeof(checkInput)), CRC16_CCITT_FALSE_CHECK);
+  EXPECT_EQ(Nuki::crc16CcittFalse(checkInput, sizeof(checkInput)), CRC16_CCITT_FALSE_CHECK);
+  EXPECT_TRUE(Nuki::crc16SelfTest());
+}
+
+TEST(Crc, EmptyDataKeepsTheCrc) {
+  EXPECT_EQ(Nuki::crc16CcittFalse(checkInput, 0), CRC16_CCITT_FALSE_INIT);
+  EXPECT_EQ(Nuki::crc16CcittFalseTable(checkInput, 0, 0x1234), 0x1234);
+}
+
+TEST(Crc, TableMatchesBitwiseOnRandomData) {
+  std::mt19937 random(0x29b1);
+  //every length modulo 4 hits the tail after the 4 byte slices
+  for (size_t length = 1; length <= 300; length++) {
+    std::vector<uint8_t> data = randomBytes(random, length);
+    uint16_t expected = crc16Bitwise(data.data(), length);
+    ASSERT_EQ(Nuki::crc16CcittFalseTable(data.data(), length), expected) << "length " << length;
+    ASSERT_EQ(Nuki::crc16CcittFalse(data.data(), length), expected) << "length " << length;
+  }
+}
+
+TEST(Crc, ContinuesOverBuffers) {
+  std::mt19937 random(1);
+  std::vector<uint8_t> data = randomBytes(random, 103);
+  uint16_t whole = crc16Bitwise(data.data(), data.size());
+  for (size_t split : {0, 1, 3, 4, 7, 50, 103}) {
+    uint16_t first = Nuki::crc16CcittFalse(data.data(), split);
+    EXPECT_EQ(Nuki::crc16CcittFalse(data.data() + split, data.size() - split, first), whole) << "split " << split;
+  }
+}
@@ -0,0 +1,74 @@
+#include "NukiUtils.h"
+#include "NukiCrypto.h"
+#include <gtest/gtest.h>
+#include <sodium.h>
+
+namespace {
+
+class CryptoContextTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+      randombytes_buf(secretKey, sizeof(secretKey));
+      randombytes_buf(nonce, sizeof(nonce));
+      randombytes_buf(plainData, sizeof(plainData));
+      crypto.setKey(secretKey);
+    }
+
+    unsigned char secretKey[crypto_secretbox_KEYBYTES];
+    unsigned char nonce[crypto_secretbox_NONCEBYTES];
+    unsigned char plainData[100];
+    Nuki::CryptoContext crypto;
+};
+
+} // namespace
+
+TEST_F(CryptoContextTest, MatchesTheEncodeHelpers) {
+  unsigned char encoded[crypto_secretbox_MACBYTES + sizeof(plainData)];
+  ASSERT_EQ(Nuki::encode(encoded, plainData, sizeof(plainData), nonce, secretKey), (int)sizeof(plainData));
+
+  unsigned char cipherData[sizeof(plainData)];
+  unsigned char mac[crypto_secretbox_MACBYTES];
+  ASSERT_TRUE(crypto.encrypt(cipherData, mac, plainData, sizeof(plainData), nonce));
+  EXPECT_EQ(memcmp(mac, encoded, sizeof(mac)), 0);
+  EXPECT_EQ(memcmp(cipherData, &encoded[sizeof(mac)], sizeof(cipherData)), 0);
+
+  unsigned char decrypted[sizeof(plainData)];
+  ASSERT_TRUE(crypto.decrypt(decrypted, cipherData, mac, sizeof(cipherData), nonce));
+  EXPECT_EQ(memcmp(decrypted, plainData, sizeof(plainData)), 0);
+}
+
+TEST_F(CryptoContextTest, EncryptsAndDecryptsInPlace) {
+  unsigned char buffer[sizeof(plainData)];
+  unsigned char mac[crypto_secretbox_MACBYTES];
+  memcpy(buffer, plainData, sizeof(buffer));
+  ASSERT_TRUE(crypto.encrypt(buffer, mac, buffer, sizeof(buffer), nonce));
+  EXPECT_NE(memcmp(buffer, plainData, sizeof(buffer)), 0);
+  ASSERT_TRUE(crypto.decrypt(buffer, buffer, mac, sizeof(buffer), nonce));
+  EXPECT_EQ(memcmp(buffer, plainData, sizeof(buffer)), 0);
+}
+
+TEST_F(CryptoContextTest, ForgedTagLeavesThePlainDataUntouched) {
+  unsigned char cipherData[sizeof(plainData)];
+  unsigned char mac[crypto_secretbox_MACBYTES];
+  ASSERT_TRUE(crypto.encrypt(cipherData, mac, plainData, sizeof(plainData), nonce));
+
+  unsigned char decrypted[sizeof(plainData)];
+  memset(decrypted, 0xaa, sizeof(decrypted));
+  mac[0] ^= 0x01;
+  EXPECT_FALSE(crypto.decrypt(decrypted, cipherData, mac, sizeof(cipherData), nonce));
+  mac[0] ^= 0x01;
+  cipherData[sizeof(cipherData) - 1] ^= 0x80;
+  EXPECT_FALSE(crypto.decrypt(decrypted, cipherData, mac, sizeof(cipherData), nonce));
+  for (unsigned char value : decrypted) {
+    ASSERT_EQ(value, 0xaa);
+  }
+}
+
+TEST_F(CryptoContextTest, FailsWithoutKey) {
+  unsigned char cipherData[sizeof(plainData)];
+  unsigned char mac[crypto_secretbox_MACBYTES];
+  crypto.clear();
+  EXPECT_FALSE(crypto.hasKey());
+  EXPECT_FALSE(crypto.encrypt(cipherData, mac, plainData, sizeof(plainData), nonce));
+  EXPECT_FALSE(crypto.decrypt(cipherData, plainData, mac, sizeof(plainData), nonce));
+}
@@ -0,0 +1,80 @@
+#include "NukiBle.h"
+#include "NukiUtils.h"
+#include "NukiCrypto.h"
+#include <gtest/gtest.h>
+#include <sodium.h>
+
+namespace {
+
+class FrameTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+      randombytes_buf(secretKey, sizeof(secretKey));
+      randombytes_buf(nonce, sizeof(nonce));
+      crypto.setKey(secretKey);
+    }
+
+    unsigned char secretKey[crypto_secretbox_KEYBYTES];
+    unsigned char nonce[crypto_secretbox_NONCEBYTES];
+    unsigned char authorizationId[4] = {0x01, 0x02, 0x03, 0x04};
+    Nuki::CryptoContext crypto;
+};
+
+} // namespace
+
+TEST_F(FrameTest, OpensTheBuiltFrame) {
+  unsigned char payload[40];
+  randombytes_buf(payload, sizeof(payload));
+  unsigned char frame[MAX_FRAME_SIZE];
+  uint16_t frameLen = Nuki::buildEncryptedFrame(frame, sizeof(frame), authorizationId, Nuki::Command::RequestData,
+                                                payload, sizeof(payload), nonce, crypto);
+  ASSERT_EQ(frameLen, ENCRYPTED_FRAME_OVERHEAD + sizeof(payload));
+  EXPECT_EQ(memcmp(frame, nonce, sizeof(nonce)), 0);
+  EXPECT_EQ(memcmp(&frame[24], authorizationId, 4), 0);
+
+  unsigned char plainData[MAX_FRAME_SIZE];
+  ASSERT_EQ(Nuki::openEncryptedFrame(plainData, sizeof(plainData), frame, frameLen, crypto), 8 + (int)sizeof(payload));
+  EXPECT_EQ(memcmp(plainData, authorizationId, 4), 0);
+  Nuki::Command command;
+  memcpy(&command, &plainData[4], sizeof(command));
+  EXPECT_EQ(command, Nuki::Command::RequestData);
+  EXPECT_EQ(memcmp(&plainData[6], payload, sizeof(payload)), 0);
+}
+
+TEST_F(FrameTest, SameLayoutAsTheEncodeHelper) {
+  unsigned char payload[2] = {0x0c, 0x00};
+  unsigned char frame[MAX_FRAME_SIZE];
+  uint16_t frameLen = Nuki::buildEncryptedFrame(frame, sizeof(frame), authorizationId, Nuki::Command::RequestData,
+                                                payload, sizeof(payload), nonce, crypto);
+  ASSERT_GT(frameLen, 0);
+
+  //the frame of the original implementation: crypto_secretbox_easy of authorization id, command, payload and crc
+  unsigned char plainData[10];
+  memcpy(&plainData[0], authorizationId, 4);
+  Nuki::Command command = Nuki::Command::RequestData;
+  memcpy(&plainData[4], &command, 2);
+  memcpy(&plainData[6], payload, sizeof(payload));
+  uint16_t crc = Nuki::calculateCrc(plainData, 0, 8);
+  memcpy(&plainData[8], &crc, 2);
+  unsigned char encrypted[sizeof(plainData) + crypto_secretbox_MACBYTES];
+  ASSERT_EQ(Nuki::encode(encrypted, plainData, sizeof(plainData), nonce, secretKey), (int)sizeof(plainData));
+  EXPECT_EQ(frameLen, ENCRYPTED_FRAME_HEADER_SIZE + sizeof(encrypted));
+  EXPECT_EQ(memcmp(&frame[ENCRYPTED_FRAME_HEADER_SIZE], encrypted, sizeof(encrypted)), 0);
+}
+
+TEST_F(FrameTest, RejectsInvalidFrames) {
+  unsigned char payload[8] = {};
+  unsigned char frame[MAX_FRAME_SIZE];
+  EXPECT_EQ(Nuki::buildEncryptedFrame(frame, ENCRYPTED_FRAME_OVERHEAD + sizeof(payload) - 1, authorizationId,
+                                      Nuki::Command::RequestData, payload, sizeof(payload), nonce, crypto), 0);
+  uint16_t frameLen = Nuki::buildEncryptedFrame(frame, sizeof(frame), authorizationId, Nuki::Command::RequestData,
+                                                payload, sizeof(payload), nonce, crypto);
+  ASSERT_GT(frameLen, 0);
+
+  unsigned char plainData[MAX_FRAME_SIZE];
+  EXPECT_EQ(Nuki::openEncryptedFrame(plainData, sizeof(plainData), frame, ENCRYPTED_FRAME_OVERHEAD - 1, crypto), -1);
+  EXPECT_EQ(Nuki::openEncryptedFrame(plainData, 8, frame, frameLen, crypto), -1);
+  //a flipped bit of the cipher text fails the authentication
+  frame[frameLen - 1] ^= 0x01;
+  EXPECT_EQ(Nuki::openEncryptedFrame(plainData, sizeof(plainData), frame, frameLen, crypto), -1);
+}
@@ -0,0 +1,179 @@
+#include "SimulatedLockSetup.h"
+#include "NukiLogArchive.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using Nuki::CmdResult;
+using Nuki::SimulatedLock;
+
+namespace {
+
+typedef Nuki::LogArchive<NukiLock::LogEntry> Archive;
+
+std::vector<NukiLock::LogEntry> makeLogEntries(const uint32_t first, const uint32_t last, const uint32_t authId = 1,
+                                               const uint16_t year = 2024) {
+  std::vector<NukiLock::LogEntry> entries;
+  for (uint32_t index = first; index <= last; index++) {
+    entries.push_back(SimulatedLock::makeLogEntry(index, authId, year));
+  }
+  return entries;
+}
+
+std::vector<NukiLock::LogEntry> queryIndexes(Archive& archive, const uint32_t from, const uint32_t to) {
+  std::vector<NukiLock::LogEntry> entries;
+  archive.queryByIndex(from, to, [&entries](const NukiLock::LogEntry& entry) {
+    entries.push_back(entry);
+    return true;
+  });
+  return entries;
+}
+
+class LogArchiveSyncTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+      ASSERT_TRUE(setup.pair());
+      ASSERT_TRUE(archive.begin());
+    }
+
+    //the archive of the entries 1 .. 30 of 2024
+    void archiveFirstLog() {
+      simulatedLock.setLogEntries(makeLogEntries(1, 30));
+      ASSERT_EQ(archive.syncFrom(lock), CmdResult::Success);
+      ASSERT_EQ(archive.getLastIndex(), 30u);
+      ASSERT_EQ(archive.size(), 30u);
+    }
+
+    Nuki::SimulatedLockSetup setup;
+    SimulatedLock& simulatedLock = setup.simulatedLock;
+    NukiLock::NukiLock& lock = *setup.lock;
+    fs::FS fileSystem;
+    Archive archive{fileSystem, "/nukilog"};
+};
+
+} // namespace
+
+TEST(LogArchive, AppendsOnlyNewerIndexes) {
+  fs::FS fileSystem;
+  Archive archive(fileSystem, "/nukilog", 100, 4);
+  ASSERT_TRUE(archive.begin());
+  std::vector<NukiLock::LogEntry> entries = makeLogEntries(1, 250);
+
+  EXPECT_EQ(archive.appendAll(entries), 250u);
+  EXPECT_EQ(archive.appendAll(entries), 0u);
+  EXPECT_FALSE(archive.append(SimulatedLock::makeLogEntry(100)));
+  EXPECT_EQ(archive.getFirstIndex(), 1u);
+  EXPECT_EQ(archive.getLastIndex(), 250u);
+  EXPECT_EQ(archive.size(), 250u);
+
+  std::vector<NukiLock::LogEntry> range = queryIndexes(archive, 101, 150);
+  ASSERT_EQ(range.size(), 50u);
+  EXPECT_EQ(range.front().index, 101u);
+  EXPECT_EQ(range.back().index, 150u);
+}
+
+TEST(LogArchive, RotatesTheOldestSegment) {
+  fs::FS fileSystem;
+  Archive archive(fileSystem, "/nukilog", 100, 4);
+  ASSERT_TRUE(archive.begin());
+  EXPECT_EQ(archive.appendAll(makeLogEntries(1, 500)), 500u);
+
+  Nuki::LogArchiveStats stats = archive.getStats();
+  EXPECT_EQ(stats.segments, 4u);
+  EXPECT_EQ(stats.segmentsRotated, 1u);
+  EXPECT_EQ(archive.size(), 400u);
+  EXPECT_EQ(archive.getFirstIndex(), 101u);
+  EXPECT_EQ(queryIndexes(archive, 1, 100).size(), 0u);
+}
+
+TEST(LogArchive, ReloadsFromTheFileSystem) {
+  fs::FS fileSystem;
+  {
+    Archive archive(fileSystem, "/nukilog", 100, 4);
+    ASSERT_TRUE(archive.begin());
+    archive.appendAll(makeLogEntries(1, 150));
+  }
+  Archive archive(fileSystem, "/nukilog", 100, 4);
+  ASSERT_TRUE(archive.begin());
+  EXPECT_EQ(archive.getFirstIndex(), 1u);
+  EXPECT_EQ(archive.getLastIndex(), 150u);
+  EXPECT_TRUE(archive.append(SimulatedLock::makeLogEntry(151)));
+}
+
+TEST(LogArchive, QueriesByTime) {
+  fs::FS fileSystem;
+  Archive archive(fileSystem, "/nukilog");
+  ASSERT_TRUE(archive.begin());
+  archive.appendAll(makeLogEntries(1, 100));
+
+  NukiLock::LogEntry entry = SimulatedLock::makeLogEntry(42);
+  uint32_t timestamp = Nuki::toLogTimestamp(entry.timeStampYear, entry.timeStampMonth, entry.timeStampDay,
+                                            entry.timeStampHour, entry.timeStampMinute, entry.timeStampSecond);
+  std::vector<uint32_t> found;
+  archive.queryByTime(timestamp, timestamp, [&found](const NukiLock::LogEntry& entry) {
+    found.push_back(entry.index);
+    return true;
+  });
+  EXPECT_EQ(found, std::vector<uint32_t>({42}));
+  EXPECT_EQ(archive.queryByTime(0, 0xffffffff, [](const NukiLock::LogEntry&) {
+    return true;
+  }), 100u);
+}
+
+TEST_F(LogArchiveSyncTest, RetrievesOnlyNewEntries) {
+  archiveFirstLog();
+  uint32_t framesSent = simulatedLock.getSentFrameCount();
+
+  simulatedLock.setLogEntries(makeLogEntries(1, 35));
+  ASSERT_EQ(archive.syncFrom(lock), CmdResult::Success);
+  EXPECT_EQ(archive.getLastIndex(), 35u);
+  EXPECT_EQ(archive.size(), 35u);
+  //the entry at the newest archived index to check for a reset and the 5 new entries, with the challenges
+  //and status frames but none of the entries 1 .. 29
+  EXPECT_LT(simulatedLock.getSentFrameCount() - framesSent, 20u);
+}
+
+TEST_F(LogArchiveSyncTest, ResetLockWithFewerEntriesStartsAnEpoch) {
+  archiveFirstLog();
+
+  simulatedLock.setLogEntries(makeLogEntries(1, 10, 1, 2025));
+  ASSERT_EQ(archive.syncFrom(lock), CmdResult::Success);
+  EXPECT_EQ(archive.getLastIndex(), 10u);
+  EXPECT_EQ(archive.size(), 40u);
+  std::vector<NukiLock::LogEntry> epoch = queryIndexes(archive, 1, 100);
+  ASSERT_EQ(epoch.size(), 10u);
+  EXPECT_EQ(epoch.front().timeStampYear, 2025);
+}
+
+TEST_F(LogArchiveSyncTest, ResetLockWithMoreEntriesStartsAnEpoch) {
+  archiveFirstLog();
+
+  //the newest index of the lock is higher than the archived one, only the entry at index 30 tells the reset
+  simulatedLock.setLogEntries(makeLogEntries(1, 40, 1, 2025));
+  ASSERT_EQ(archive.syncFrom(lock), CmdResult::Success);
+  EXPECT_EQ(archive.getLastIndex(), 40u);
+  EXPECT_EQ(archive.size(), 70u);
+  std::vector<NukiLock::LogEntry> epoch = queryIndexes(archive, 1, 100);
+  ASSERT_EQ(epoch.size(), 40u);
+  EXPECT_EQ(epoch.front().timeStampYear, 2025);
+}
+
+TEST_F(LogArchiveSyncTest, OtherAuthorizationAtTheArchivedIndexStartsAnEpoch) {
+  archiveFirstLog();
+
+  simulatedLock.setLogEntries(makeLogEntries(1, 35, 2));
+  ASSERT_EQ(archive.syncFrom(lock), CmdResult::Success);
+  EXPECT_EQ(archive.getLastIndex(), 35u);
+  EXPECT_EQ(archive.size(), 65u);
+  EXPECT_EQ(queryIndexes(archive, 30, 30).front().authId, 2u);
+}
+
+TEST_F(LogArchiveSyncTest, ContinuesAfterTheLockDroppedOldEntries) {
+  archiveFirstLog();
+
+  //the lock only keeps its newest entries, the archived index 30 is no longer on the lock
+  simulatedLock.setLogEntries(makeLogEntries(31, 40));
+  ASSERT_EQ(archive.syncFrom(lock), CmdResult::Success);
+  EXPECT_EQ(archive.getFirstIndex(), 1u);
+  EXPECT_EQ(archive.getLastIndex(), 40u);
+  EXPECT_EQ(archive.size(), 40u);
+}
@@ -0,0 +1,76 @@
+#include "NukiRingBuffer.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace {
+
+typedef Nuki::RingBuffer<int, 4> Buffer;
+
+std::vector<int> contents(const Buffer& buffer) {
+  std::vector<int> elements;
+  for (int element : buffer) {
+    elements.push_back(element);
+  }
+  return elements;
+}
+
+} // namespace
+
+TEST(RingBuffer, StartsEmpty) {
+  Buffer buffer;
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_FALSE(buffer.full());
+  EXPECT_EQ(buffer.size(), 0u);
+  EXPECT_EQ(buffer.capacity(), 4u);
+  EXPECT_EQ(buffer.dropped(), 0u);
+  EXPECT_FALSE(buffer.pop());
+  EXPECT_TRUE(contents(buffer).empty());
+}
+
+TEST(RingBuffer, PushOverwritesOldest) {
+  Buffer buffer;
+  for (int i = 1; i <= 4; i++) {
+    EXPECT_FALSE(buffer.push(i));
+  }
+  EXPECT_TRUE(buffer.full());
+  EXPECT_TRUE(buffer.push(5));
+  EXPECT_TRUE(buffer.push(6));
+  EXPECT_EQ(contents(buffer), std::vector<int>({3, 4, 5, 6}));
+  EXPECT_EQ(buffer.front(), 3);
+  EXPECT_EQ(buffer.back(), 6);
+  //overwriting is not dropping
+  EXPECT_EQ(buffer.dropped(), 0u);
+}
+
+TEST(RingBuffer, TryPushKeepsOldestAndCountsDropped) {
+  Buffer buffer;
+  for (int i = 1; i <= 6; i++) {
+    EXPECT_EQ(buffer.tryPush(i), i <= 4);
+  }
+  EXPECT_EQ(contents(buffer), std::vector<int>({1, 2, 3, 4}));
+  EXPECT_EQ(buffer.dropped(), 2u);
+
+  buffer.clear();
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_EQ(buffer.dropped(), 0u);
+}
+
+TEST(RingBuffer, PopWrapsAround) {
+  Buffer buffer;
+  for (int i = 1; i <= 10; i++) {
+    buffer.push(i);
+    if (i % 3 == 0) {
+      EXPECT_TRUE(buffer.pop());
+    }
+  }
+  EXPECT_EQ(contents(buffer), std::vector<int>({7, 8, 9, 10}));
+  EXPECT_TRUE(buffer.pop());
+  EXPECT_EQ(buffer.at(0), 8);
+  EXPECT_EQ(buffer.size(), 3u);
+
+  std::vector<int> visited;
+  buffer.forEach([&visited](int element) {
+    visited.push_back(element);
+  });
+  EXPECT_EQ(visited, std::vector<int>({8, 9, 10}));
+}
@@ -0,0 +1,238 @@
+#include "SimulatedLockSetup.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <list>
+
+using Nuki::CmdResult;
+using Nuki::SimulatedLock;
+
+namespace {
+
+class SimulatedLockTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+      ASSERT_TRUE(setup.pair());
+    }
+
+    Nuki::SimulatedLockSetup setup;
+    SimulatedLock& simulatedLock = setup.simulatedLock;
+    NukiLock::NukiLock& lock = *setup.lock;
+};
+
+class EventCounter : public Nuki::SmartlockEventHandler {
+  public:
+    void notify(Nuki::EventType eventType) override {
+      count++;
+    }
+
+    std::atomic<int> count{0};
+};
+
+std::vector<NukiLock::LogEntry> makeLogEntries(const uint32_t first, const uint32_t last) {
+  std::vector<NukiLock::LogEntry> entries;
+  for (uint32_t index = first; index <= last; index++) {
+    entries.push_back(SimulatedLock::makeLogEntry(index));
+  }
+  return entries;
+}
+
+std::vector<Nuki::KeypadEntry> makeKeypadEntries(const uint16_t count) {
+  std::vector<Nuki::KeypadEntry> entries(count);
+  for (uint16_t i = 0; i < count; i++) {
+    memset(&entries[i], 0, sizeof(Nuki::KeypadEntry));
+    entries[i].codeId = i + 1;
+    entries[i].code = 111111 * (i % 9 + 1);
+    entries[i].enabled = 1;
+  }
+  return entries;
+}
+
+} // namespace
+
+TEST(SimulatedLockPairing, PairsOnlyInPairingMode) {
+  Nuki::SimulatedLockSetup setup;
+  //iBeacon of a lock that is not in pairing mode
+  setup.simulatedLock.advertise(setup.scanner);
+  EXPECT_EQ(setup.lock->pairNuki(Nuki::AuthorizationIdType::Bridge), Nuki::PairingResult::Pairing);
+  EXPECT_FALSE(setup.lock->isPairedWithLock());
+
+  ASSERT_TRUE(setup.pair());
+  EXPECT_TRUE(setup.lock->isPairedWithLock());
+  EXPECT_TRUE(setup.simulatedLock.isPaired());
+  EXPECT_EQ(setup.lock->getBleAddress(), setup.simulatedLock.getAddress());
+  EXPECT_EQ(setup.simulatedLock.getErrorCount(), 0u);
+}
+
+TEST_F(SimulatedLockTest, RequestKeyTurnerState) {
+  NukiLock::KeyTurnerState state = simulatedLock.getKeyTurnerState();
+  state.lockState = NukiLock::LockState::Unlocked;
+  state.doorSensorState = NukiLock::DoorSensorState::DoorClosed;
+  simulatedLock.setKeyTurnerState(state);
+
+  NukiLock::KeyTurnerState received;
+  ASSERT_EQ(lock.requestKeyTurnerState(&received), CmdResult::Success);
+  EXPECT_EQ(received.lockState, NukiLock::LockState::Unlocked);
+  EXPECT_EQ(received.doorSensorState, NukiLock::DoorSensorState::DoorClosed);
+  EXPECT_EQ(received.currentTimeYear, state.currentTimeYear);
+}
+
+TEST_F(SimulatedLockTest, RequestBatteryReportAndConfig) {
+  NukiLock::BatteryReport report;
+  ASSERT_EQ(lock.requestBatteryReport(&report), CmdResult::Success);
+  EXPECT_EQ(report.batteryVoltage, 6000);
+
+  NukiLock::Config config;
+  ASSERT_EQ(lock.requestConfig(&config), CmdResult::Success);
+  EXPECT_EQ(config.nukiId, 0x1234u);
+  EXPECT_STREQ((const char*)config.name, "Simulated lock");
+  EXPECT_EQ(simulatedLock.getErrorCount(), 0u);
+}
+
+TEST_F(SimulatedLockTest, LockAction) {
+  ASSERT_EQ(lock.lockAction(NukiLock::LockAction::Unlock), CmdResult::Success);
+  //the lock reports COMPLETE when the motor stopped, before that the next command would get it as its reply
+  ASSERT_TRUE(simulatedLock.waitIdle());
+  EXPECT_EQ(simulatedLock.getKeyTurnerState().lockState, NukiLock::LockState::Unlocked);
+
+  NukiLock::KeyTurnerState received;
+  ASSERT_EQ(lock.requestKeyTurnerState(&received), CmdResult::Success);
+  EXPECT_EQ(received.lockState, NukiLock::LockState::Unlocked);
+  EXPECT_EQ(received.lastLockAction, NukiLock::LockAction::Unlock);
+}
+
+TEST_F(SimulatedLockTest, BusyLockIsReported) {
+  simulatedLock.injectBusy(1);
+  NukiLock::Config config;
+  EXPECT_EQ(lock.requestConfig(&config), CmdResult::Lock_Busy);
+  EXPECT_EQ(lock.requestConfig(&config), CmdResult::Success);
+}
+
+TEST_F(SimulatedLockTest, WrongSecurityPinFails) {
+  simulatedLock.setSecurityPin(4321);
+  EXPECT_EQ(lock.verifySecurityPin(), CmdResult::Failed);
+
+  ASSERT_TRUE(lock.saveSecurityPincode(4321));
+  EXPECT_EQ(lock.verifySecurityPin(), CmdResult::Success);
+}
+
+TEST_F(SimulatedLockTest, ReconnectsAfterTheLockDisconnected) {
+  NukiLock::KeyTurnerState received;
+  ASSERT_EQ(lock.requestKeyTurnerState(&received), CmdResult::Success);
+  uint32_t connects = simulatedLock.getConnectCount();
+
+  simulatedLock.disconnectClients();
+  ASSERT_EQ(lock.requestKeyTurnerState(&received), CmdResult::Success);
+  EXPECT_EQ(simulatedLock.getConnectCount(), connects + 1);
+}
+
+TEST_F(SimulatedLockTest, HeartbeatWithStateChangeNotifies) {
+  EventCounter events;
+  lock.setEventHandler(&events);
+  simulatedLock.advertise(setup.scanner);
+  EXPECT_EQ(events.count, 0);
+  simulatedLock.advertise(setup.scanner, true);
+  EXPECT_EQ(events.count, 1);
+  lock.setEventHandler(nullptr);
+}
+
+TEST_F(SimulatedLockTest, RetrieveLogEntries) {
+  simulatedLock.setLogEntries(makeLogEntries(1, 20));
+
+  //most recent first
+  ASSERT_EQ(lock.retrieveLogEntries(0, 5, 1, true), CmdResult::Success);
+  EXPECT_EQ(lock.getLogEntryCount(), 20);
+  const NukiLock::LogEntryBuffer& received = lock.getLogEntryBuffer();
+  ASSERT_EQ(received.size(), 5u);
+  EXPECT_EQ(received.front().index, 20u);
+  EXPECT_EQ(received.back().index, 16u);
+  EXPECT_EQ(received.dropped(), 0u);
+}
+
+TEST_F(SimulatedLockTest, ShortLastLogPageEndsWithTheStatus) {
+  simulatedLock.setLogEntries(makeLogEntries(1, 35));
+
+  //only 5 of the 10 requested entries are left after index 31, the status complete ends the list
+  uint32_t start = millis();
+  ASSERT_EQ(lock.retrieveLogEntries(31, 10, 0, true), CmdResult::Success);
+  EXPECT_LT(millis() - start, (unsigned long)GENERAL_TIMEOUT);
+  const NukiLock::LogEntryBuffer& received = lock.getLogEntryBuffer();
+  ASSERT_EQ(received.size(), 5u);
+  EXPECT_EQ(received.front().index, 31u);
+  EXPECT_EQ(received.back().index, 35u);
+}
+
+TEST_F(SimulatedLockTest, FullLogPageKeepsItsStatus) {
+  simulatedLock.setLogEntries(makeLogEntries(1, 35));
+
+  //the status complete after a full page belongs to that page, not to the next request, which is already
+  //waiting for its list when a slow link delivers the status
+  simulatedLock.setReplyDelay(2000);
+  ASSERT_EQ(lock.retrieveLogEntries(1, 10, 0, false), CmdResult::Success);
+  ASSERT_EQ(lock.getLogEntryBuffer().size(), 10u);
+  ASSERT_EQ(lock.retrieveLogEntries(11, 10, 0, false), CmdResult::Success);
+  ASSERT_EQ(lock.getLogEntryBuffer().size(), 10u);
+  EXPECT_EQ(lock.getLogEntryBuffer().front().index, 11u);
+}
+
+TEST_F(SimulatedLockTest, SyncLogEntries) {
+  simulatedLock.setLogEntries(makeLogEntries(1, 30));
+  ASSERT_EQ(lock.syncLogEntries(100), CmdResult::Success);
+  EXPECT_EQ(lock.getLastSyncedLogIndex(), 30u);
+
+  simulatedLock.setLogEntries(makeLogEntries(1, 35));
+  ASSERT_EQ(lock.syncLogEntries(100), CmdResult::Success);
+  EXPECT_EQ(lock.getLastSyncedLogIndex(), 35u);
+  std::list<NukiLock::LogEntry> synced;
+  lock.getSyncedLogEntries(&synced);
+  ASSERT_FALSE(synced.empty());
+  EXPECT_EQ(synced.back().index, 35u);
+}
+
+TEST_F(SimulatedLockTest, RetrieveKeypadEntries) {
+  simulatedLock.setKeypadEntries(makeKeypadEntries(5));
+
+  ASSERT_EQ(lock.retrieveKeypadEntries(0, 10), CmdResult::Success);
+  EXPECT_EQ(lock.getKeypadEntryCount(), 5);
+  std::list<Nuki::KeypadEntry> entries;
+  lock.getKeypadEntries(&entries);
+  ASSERT_EQ(entries.size(), 5u);
+  EXPECT_EQ(entries.front().codeId, 1);
+  EXPECT_EQ(entries.back().code, 555555u);
+}
+
+TEST_F(SimulatedLockTest, ListEndsWithTheReportedCount) {
+  //without the trailing Status COMPLETE the list ends when all entries after the offset are received
+  simulatedLock.setListStatusComplete(false);
+  simulatedLock.setKeypadEntries(makeKeypadEntries(5));
+
+  uint32_t start = millis();
+  ASSERT_EQ(lock.retrieveKeypadEntries(2, 10), CmdResult::Success);
+  EXPECT_LT(millis() - start, (unsigned long)GENERAL_TIMEOUT);
+  EXPECT_EQ(lock.getKeypadEntryBuffer().size(), 3u);
+}
+
+TEST_F(SimulatedLockTest, RetrieveAuthorizationAndTimeControlEntries) {
+  std::vector<Nuki::AuthorizationEntry> authorizations(3);
+  for (size_t i = 0; i < authorizations.size(); i++) {
+    memset(&authorizations[i], 0, sizeof(Nuki::AuthorizationEntry));
+    authorizations[i].authId = 100 + i;
+  }
+  simulatedLock.setAuthorizationEntries(authorizations);
+  std::vector<NukiLock::TimeControlEntry> timeControls(2);
+  for (size_t i = 0; i < timeControls.size(); i++) {
+    memset(&timeControls[i], 0, sizeof(NukiLock::TimeControlEntry));
+    timeControls[i].entryId = i + 1;
+    timeControls[i].lockAction = NukiLock::LockAction::Lock;
+  }
+  simulatedLock.setTimeControlEntries(timeControls);
+
+  ASSERT_EQ(lock.retrieveAuthorizationEntries(0, 10), CmdResult::Success);
+  ASSERT_EQ(lock.getAuthorizationEntryBuffer().size(), 3u);
+  EXPECT_EQ(lock.getAuthorizationEntryBuffer().back().authId, 102u);
+  //the list ended with the reported count, the Status COMPLETE sent after it must not end the next list
+  ASSERT_TRUE(simulatedLock.waitIdle());
+
+  ASSERT_EQ(lock.retrieveTimeControlEntries(), CmdResult::Success);
+  ASSERT_EQ(lock.getTimeControlEntryBuffer().size(), 2u);
+  EXPECT_EQ(lock.getTimeControlEntryBuffer().back().entryId, 2);
+}